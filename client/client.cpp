@@ -147,6 +147,7 @@ void Client::messageReceived(const Message &msg)
             disconnectFromHost();
         }
         m_initState |= VersionChecked;
+        requestMessageCompression();
         return;
     }
 
@@ -197,6 +198,9 @@ void Client::messageReceived(const Message &msg)
             m_initState |= ServerInfoReceived;
             break;
         }
+        case Protocol::MessageCompressionReply:
+            enableMessageCompression();
+            break;
         default:
             qWarning() << Q_FUNC_INFO << "Got unhandled message:" << msg.type();
             return;
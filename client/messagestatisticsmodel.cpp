@@ -73,7 +73,9 @@ static const MetaEnum::Value<Protocol::MessageType> message_type_table[] = {
     M(PropertyValuesChanged),
     M(ServerInfo),
     M(ProbeSettings),
-    M(ServerAddress)
+    M(ServerAddress),
+    M(MessageCompressionRequest),
+    M(MessageCompressionReply)
 };
 #undef M
 
@@ -342,51 +342,55 @@ void RemoteModel::newMessage(const GammaRay::Message &msg)
 
     case Protocol::ModelContentReply:
     {
-        quint32 size;
-        msg.payload() >> size;
-        Q_ASSERT(size > 0);
-
-        QHash<QModelIndex, QVector<QModelIndex> > dataChangedIndexes;
-        for (quint32 i = 0; i < size; ++i) {
-            Protocol::ModelIndex index;
-            msg.payload() >> index;
-            Node *node = nodeForIndex(index);
-            const auto column = index.last().second;
-            const NodeStates state = node ? stateForColumn(node, column) : NoState;
-            typedef QHash<int, QVariant> ItemData;
-            ItemData itemData;
-            qint32 flags;
-            msg.payload() >> itemData >> flags;
-            if ((state & Loading) == 0)
-                continue; // we didn't ask for this, probably outdated response for a moved cell
-
-            if (node) {
-                node->allocateColumns();
-                Q_ASSERT(node->data.size() > column);
-                node->data[column] = itemData;
-                node->flags[column] = static_cast<Qt::ItemFlags>(flags);
-                node->state[column] = state & ~(Loading | Empty | Outdated);
-
-                // group by parent, and emit dataChange for the bounding rect per hierarchy level
-                // as an approximiation of perfect range batching
-                const QModelIndex qmi = modelIndexForNode(node, column);
-                dataChangedIndexes[qmi.parent()].push_back(qmi);
+        quint32 blockCount;
+        msg.payload() >> blockCount;
+        Q_ASSERT(blockCount > 0);
+
+        for (quint32 block = 0; block < blockCount; ++block) {
+            Protocol::ModelIndex parentIndex;
+            qint32 firstRow, lastRow, firstColumn, lastColumn;
+            msg.payload() >> parentIndex >> firstRow >> lastRow >> firstColumn >> lastColumn;
+            Node *parentNode = nodeForIndex(parentIndex);
+
+            int r1 = std::numeric_limits<int>::max(), r2 = -1, c1 = std::numeric_limits<int>::max(),
+                c2 = -1;
+            QVector<int> roles;
+            for (int column = firstColumn; column <= lastColumn; ++column) {
+                msg.payload() >> roles;
+                for (int row = firstRow; row <= lastRow; ++row) {
+                    qint32 flags;
+                    msg.payload() >> flags;
+                    QHash<int, QVariant> itemData;
+                    foreach (int role, roles) {
+                        QVariant value;
+                        msg.payload() >> value;
+                        if (value.isValid())
+                            itemData.insert(role, value);
+                    }
+
+                    Node *node = parentNode && row < parentNode->children.size()
+                                 ? parentNode->children.at(row) : 0;
+                    const NodeStates state = node ? stateForColumn(node, column) : NoState;
+                    // we didn't ask for this, probably outdated response for a moved cell
+                    if ((state & Loading) == 0)
+                        continue;
+
+                    node->allocateColumns();
+                    Q_ASSERT(node->data.size() > column);
+                    node->data[column] = itemData;
+                    node->flags[column] = static_cast<Qt::ItemFlags>(flags);
+                    node->state[column] = state & ~(Loading | Empty | Outdated);
+
+                    r1 = std::min(r1, row);
+                    r2 = std::max(r2, row);
+                    c1 = std::min(c1, column);
+                    c2 = std::max(c2, column);
+                }
             }
-        }
 
-        for (auto it = dataChangedIndexes.constBegin(); it != dataChangedIndexes.constEnd(); ++it) {
-            const auto &indexes = it.value();
-            Q_ASSERT(!indexes.isEmpty());
-            int r1 = std::numeric_limits<int>::max(), r2 = 0, c1 = std::numeric_limits<int>::max(),
-                c2 = 0;
-            foreach (const auto &index, indexes) {
-                r1 = std::min(r1, index.row());
-                r2 = std::max(r2, index.row());
-                c1 = std::min(c1, index.column());
-                c2 = std::max(c2, index.column());
-            }
-            const auto qmi = indexes.at(0);
-            emit dataChanged(qmi.sibling(r1, c1), qmi.sibling(r2, c2));
+            if (r2 >= 0)
+                emit dataChanged(createIndex(r1, c1, parentNode->children.at(r1)),
+                                 createIndex(r2, c2, parentNode->children.at(r2)));
         }
         break;
     }
@@ -722,14 +726,69 @@ void RemoteModel::requestDataAndFlags(const QModelIndex &index) const
     }
 }
 
+namespace {
+struct ContentBlock
+{
+    Protocol::ModelIndex parent;
+    qint32 firstRow, lastRow, firstColumn, lastColumn;
+};
+}
+
+// orders cells by parent, then row, then column
+static bool cellLessThan(const Protocol::ModelIndex &lhs, const Protocol::ModelIndex &rhs)
+{
+    if (lhs.size() != rhs.size())
+        return lhs.size() < rhs.size();
+    return std::lexicographical_compare(lhs.constBegin(), lhs.constEnd(),
+                                        rhs.constBegin(), rhs.constEnd());
+}
+
+static bool isChildOf(const Protocol::ModelIndex &cell, const Protocol::ModelIndex &parent)
+{
+    return cell.size() == parent.size() + 1
+           && std::equal(parent.constBegin(), parent.constEnd(), cell.constBegin());
+}
+
 void RemoteModel::doRequestDataAndFlags() const
 {
     Q_ASSERT(!m_pendingDataRequests.isEmpty());
-    Message msg(m_myAddress, Protocol::ModelContentRequest);
-    msg.payload() << quint32(m_pendingDataRequests.size());
-    foreach (const auto &index, m_pendingDataRequests)
-        msg.payload() << index;
+    std::sort(m_pendingDataRequests.begin(), m_pendingDataRequests.end(), cellLessThan);
+
+    // merge the cells into rectangular blocks, consecutive columns of a row first,
+    // then consecutive rows with the same column range
+    QVector<ContentBlock> blocks;
+    for (int i = 0; i < m_pendingDataRequests.size();) {
+        ContentBlock block;
+        block.parent = m_pendingDataRequests.at(i);
+        block.firstRow = block.lastRow = block.parent.last().first;
+        block.firstColumn = block.lastColumn = block.parent.last().second;
+        block.parent.pop_back();
+
+        for (++i; i < m_pendingDataRequests.size(); ++i) {
+            const Protocol::ModelIndex &cell = m_pendingDataRequests.at(i);
+            if (!isChildOf(cell, block.parent) || cell.last().first != block.firstRow
+                || cell.last().second > block.lastColumn + 1)
+                break;
+            block.lastColumn = cell.last().second;
+        }
+
+        if (!blocks.isEmpty()) {
+            ContentBlock &prev = blocks.last();
+            if (prev.lastRow + 1 == block.firstRow && prev.firstColumn == block.firstColumn
+                && prev.lastColumn == block.lastColumn && prev.parent == block.parent) {
+                prev.lastRow = block.lastRow;
+                continue;
+            }
+        }
+        blocks.push_back(block);
+    }
     m_pendingDataRequests.clear();
+
+    Message msg(m_myAddress, Protocol::ModelContentRequest);
+    msg.payload() << quint32(blocks.size());
+    foreach (const ContentBlock &block, blocks)
+        msg.payload() << block.parent << block.firstRow << block.lastRow << block.firstColumn
+                      << block.lastColumn;
     sendMessage(msg);
 }
 
@@ -48,6 +48,7 @@ public:
                         int modifiers) Q_DECL_OVERRIDE;
     void setViewActive(bool active) Q_DECL_OVERRIDE;
     void clientViewUpdated() Q_DECL_OVERRIDE;
+    void requestCompleteFrame() Q_DECL_OVERRIDE;
 };
 }
 
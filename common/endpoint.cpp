@@ -30,6 +30,11 @@
 #include "message.h"
 #include "methodargument.h"
 #include "propertysyncer.h"
+#include "streamcompressor.h"
+#include "variantwrapper.h"
+
+#include <QThread>
+#include <QTimer>
 
 #include <iostream>
 
@@ -38,11 +43,17 @@ using namespace std;
 
 Endpoint *Endpoint::s_instance = 0;
 
+// set on the method call id when it is used for the first time and the method name follows
+static const quint32 MethodCallDefinition = 0x80000000;
+
 Endpoint::Endpoint(QObject *parent)
     : QObject(parent)
     , m_propertySyncer(new PropertySyncer(this))
     , m_socket(0)
     , m_myAddress(Protocol::InvalidObjectAddress +1)
+    , m_receivePos(0)
+    , m_sendQueueSize(0)
+    , m_sendQueueTimer(new QTimer(this))
 {
     if (s_instance)
         qCritical(
@@ -56,12 +67,21 @@ Endpoint::Endpoint(QObject *parent)
     // TODO: we could set this as message handler here and use the same dispatch mechanism
     insertObjectInfo(endpointObj);
 
+    // keep the allocation around when the buffer runs empty
+    m_receiveBuffer.reserve(64 * 1024);
+
+    m_sendQueueTimer->setSingleShot(true);
+    m_sendQueueTimer->setInterval(0);
+    connect(m_sendQueueTimer, SIGNAL(timeout()), this, SLOT(flushSendQueue()));
+
     connect(m_propertySyncer, SIGNAL(message(GammaRay::Message)), this,
             SLOT(sendMessage(GammaRay::Message)));
 }
 
 Endpoint::~Endpoint()
 {
+    flushSendQueue();
+
     for (QHash<Protocol::ObjectAddress, ObjectInfo *>::const_iterator it =
              m_addressMap.constBegin();
          it != m_addressMap.constEnd(); ++it)
@@ -91,11 +111,69 @@ void Endpoint::sendMessage(const Message &msg)
 void Endpoint::doSendMessage(const GammaRay::Message &msg)
 {
     Q_ASSERT(msg.address() != Protocol::InvalidObjectAddress);
-    msg.write(m_socket);
+    Q_ASSERT(m_socket);
+    Q_ASSERT(QThread::currentThread() == thread());
+
+    // property changes made before this message was sent have to arrive before it
+    m_propertySyncer->flushPendingChanges();
+
+    const QByteArray data = msg.toByteArray(m_compressor.data());
+    m_sendQueue.push_back(data);
+    m_sendQueueSize += data.size();
+    if (!m_sendQueueTimer->isActive())
+        m_sendQueueTimer->start();
+}
+
+void Endpoint::flushSendQueue()
+{
+    m_sendQueueTimer->stop();
+    if (m_sendQueue.isEmpty())
+        return;
+
+    if (m_socket) {
+        if (m_sendQueue.size() == 1) {
+            m_socket->write(m_sendQueue.first());
+        } else {
+            // QIODevice has no scatter/gather write, so coalesce into a single write instead
+            QByteArray data;
+            data.reserve(m_sendQueueSize);
+            foreach (const QByteArray &msgData, m_sendQueue)
+                data.append(msgData);
+            m_socket->write(data);
+        }
+    }
+
+    m_sendQueue.clear();
+    m_sendQueueSize = 0;
+}
+
+void Endpoint::requestMessageCompression()
+{
+#ifdef ENABLE_MESSAGE_COMPRESSSION
+    // the reply is the last uncompressed message we get, be ready before that
+    m_decompressor.reset(new StreamDecompressor);
+    Message msg(endpointAddress(), Protocol::MessageCompressionRequest);
+    send(msg);
+#endif
+}
+
+void Endpoint::acceptMessageCompression()
+{
+    // the request was the last uncompressed message the other side sent us
+    m_decompressor.reset(new StreamDecompressor);
+    Message msg(endpointAddress(), Protocol::MessageCompressionReply);
+    send(msg);
+    enableMessageCompression();
+}
+
+void Endpoint::enableMessageCompression()
+{
+    m_compressor.reset(new StreamCompressor);
 }
 
 void Endpoint::waitForMessagesWritten()
 {
+    flushSendQueue();
     m_socket->waitForBytesWritten(-1);
 }
 
@@ -132,12 +210,49 @@ Protocol::ObjectAddress Endpoint::endpointAddress() const
 
 void Endpoint::readyRead()
 {
-    while (Message::canReadMessage(m_socket.data()))
-        messageReceived(Message::readMessage(m_socket.data()));
+    const qint64 available = m_socket->bytesAvailable();
+    if (available <= 0)
+        return;
+
+    // Messages are handed out as views into m_receiveBuffer, in case they are still around
+    // (e.g. due to a nested event loop in a message handler) implicit sharing makes the
+    // modifications below detach from them.
+    if (m_receivePos == m_receiveBuffer.size()) {
+        // everything dispatched, start over at the front
+        m_receiveBuffer.resize(0);
+        m_receivePos = 0;
+    } else if (m_receivePos > 0
+               && m_receiveBuffer.size() + available > m_receiveBuffer.capacity()) {
+        // move the incomplete message at the end to the front, rather than growing
+        m_receiveBuffer.remove(0, m_receivePos);
+        m_receivePos = 0;
+    }
+
+    const int oldSize = m_receiveBuffer.size();
+    m_receiveBuffer.resize(oldSize + int(available));
+    const qint64 readSize = m_socket->read(m_receiveBuffer.data() + oldSize, available);
+    m_receiveBuffer.resize(oldSize + int(qMax<qint64>(0, readSize)));
+
+    while (m_socket && Message::canReadMessage(m_receiveBuffer, m_receivePos)) {
+        messageReceived(Message::readMessage(m_receiveBuffer, m_receivePos,
+                                             m_decompressor.data()));
+    }
 }
 
 void Endpoint::connectionClosed()
 {
+    m_sendQueue.clear();
+    m_sendQueueSize = 0;
+    m_sendQueueTimer->stop();
+    m_compressor.reset();
+    m_decompressor.reset();
+    m_receiveBuffer.resize(0);
+    m_receivePos = 0;
+    foreach (ObjectInfo *obj, m_addressMap) {
+        obj->outgoingMethodCalls.clear();
+        obj->incomingMethodCalls.clear();
+    }
+
     m_socket->deleteLater();
     m_socket = 0;
     emit disconnected();
@@ -165,6 +280,9 @@ Protocol::ObjectAddress Endpoint::registerObject(const QString &name, QObject *o
         return 0;
 
     obj->object = object;
+    // method indexes resolved for a previous object are meaningless now
+    for (int i = 0; i < obj->incomingMethodCalls.size(); ++i)
+        obj->incomingMethodCalls[i].methodIndex = -1;
 
     Q_ASSERT(!m_objectMap.contains(object));
     m_objectMap[object] = obj;
@@ -192,7 +310,22 @@ void Endpoint::invokeObject(const QString &objectName, const char *method,
     Message msg(obj->address, Protocol::MethodCall);
     const QByteArray name(method);
     Q_ASSERT(!name.isEmpty());
-    msg.payload() << name << args;
+
+    // the receiver resolves the method from its name and the argument types once per id
+    QByteArray key(name);
+    foreach (const QVariant &arg, args) {
+        key += ',';
+        key += QByteArray::number(arg.userType());
+    }
+    const QHash<QByteArray, quint32>::const_iterator it = obj->outgoingMethodCalls.constFind(key);
+    if (it != obj->outgoingMethodCalls.constEnd()) {
+        msg.payload() << it.value();
+    } else {
+        const quint32 id = obj->outgoingMethodCalls.size();
+        obj->outgoingMethodCalls.insert(key, id);
+        msg.payload() << (id | MethodCallDefinition) << name;
+    }
+    msg.payload() << args;
     send(msg);
 }
 
@@ -208,6 +341,72 @@ void Endpoint::invokeObjectLocal(QObject *object, const char *method,
                               a[9]);
 }
 
+// same lookup QMetaObject::invokeMethod() does, based on the argument types
+static int methodIndex(const QMetaObject *mo, const QByteArray &name, const QVariantList &args)
+{
+    QByteArray signature(name);
+    signature += '(';
+    for (int i = 0; i < args.size(); ++i) {
+        if (i > 0)
+            signature += ',';
+        if (args.at(i).userType() == qMetaTypeId<VariantWrapper>())
+            signature += "QVariant";
+        else
+            signature += args.at(i).typeName();
+    }
+    signature += ')';
+
+    const int idx = mo->indexOfMethod(signature);
+    if (idx >= 0)
+        return idx;
+    return mo->indexOfMethod(QMetaObject::normalizedSignature(signature));
+}
+
+void Endpoint::invokeMethodCall(ObjectInfo *obj, const Message &msg)
+{
+    quint32 id;
+    msg.payload() >> id;
+    if (id & MethodCallDefinition) {
+        id &= ~MethodCallDefinition;
+        if (obj->incomingMethodCalls.size() <= (int)id)
+            obj->incomingMethodCalls.resize(id + 1);
+        MethodCallInfo &call = obj->incomingMethodCalls[id];
+        msg.payload() >> call.name;
+        call.methodIndex = -1;
+    }
+    Q_ASSERT((int)id < obj->incomingMethodCalls.size());
+    if ((int)id >= obj->incomingMethodCalls.size())
+        return;
+    MethodCallInfo &call = obj->incomingMethodCalls[id];
+    Q_ASSERT(!call.name.isEmpty());
+
+    if (!obj->object) {
+        cerr << "cannot call method " << call.name.constData() << " on unknown object of name "
+             << qPrintable(obj->name) << " with address " << quint64(obj->address)
+             << " - did you forget to register it?" << endl;
+        return;
+    }
+
+    QVariantList args;
+    msg.payload() >> args;
+    Q_ASSERT(args.size() <= 10);
+
+    if (call.methodIndex < 0)
+        call.methodIndex = methodIndex(obj->object->metaObject(), call.name, args);
+    if (call.methodIndex < 0) {
+        cerr << "cannot call method " << call.name.constData() << " on object of name "
+             << qPrintable(obj->name) << " - no such method with these arguments" << endl;
+        return;
+    }
+
+    QVector<MethodArgument> a(10);
+    for (int i = 0; i < args.size(); ++i)
+        a[i] = MethodArgument(args.at(i));
+
+    const QMetaMethod method = obj->object->metaObject()->method(call.methodIndex);
+    method.invoke(obj->object, a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9]);
+}
+
 void Endpoint::addObjectNameAddressMapping(const QString &objectName,
                                            Protocol::ObjectAddress objectAddress)
 {
@@ -304,21 +503,8 @@ void Endpoint::dispatchMessage(const Message &msg)
     }
 
     ObjectInfo *obj = it.value();
-    if (msg.type() == Protocol::MethodCall) {
-        QByteArray method;
-        msg.payload() >> method;
-        if (obj->object) {
-            Q_ASSERT(!method.isEmpty());
-            QVariantList args;
-            msg.payload() >> args;
-
-            invokeObjectLocal(obj->object, method.constData(), args);
-        } else {
-            cerr << "cannot call method " << method.constData() << " on unknown object of name "
-                 << qPrintable(obj->name) << " with address " << quint64(obj->address)
-                 << " - did you forget to register it?" << endl;
-        }
-    }
+    if (msg.type() == Protocol::MethodCall)
+        invokeMethodCall(obj, msg);
 
     if (obj->receiver)
         obj->messageHandler.invoke(obj->receiver, Q_ARG(GammaRay::Message, msg));
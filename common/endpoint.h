@@ -32,18 +32,24 @@
 #include "gammaray_common_export.h"
 #include "protocol.h"
 
+#include <QHash>
 #include <QMetaMethod>
 #include <QObject>
 #include <QPointer>
+#include <QScopedPointer>
+#include <QVector>
 
 QT_BEGIN_NAMESPACE
 class QIODevice;
+class QTimer;
 class QUrl;
 QT_END_NAMESPACE
 
 namespace GammaRay {
 class Message;
 class PropertySyncer;
+class StreamCompressor;
+class StreamDecompressor;
 
 /** @brief Network protocol endpoint.
  *
@@ -57,7 +63,9 @@ class GAMMARAY_COMMON_EXPORT Endpoint : public QObject
 public:
     ~Endpoint();
 
-    /** Send @p msg to the connected endpoint. */
+    /** Send @p msg to the connected endpoint.
+     *  Must be called from the thread the endpoint lives in.
+     */
     static void send(const Message &msg);
 
     /** Returns @c true if we are currently connected to another endpoint. */
@@ -168,9 +176,22 @@ protected:
     /** Calls the message handler registered for the receiver of @p msg. */
     void dispatchMessage(const GammaRay::Message &msg);
 
-    /** Sends a given message. */
+    /** Sends a given message.
+     *  The message is queued and written together with all other messages sent in the
+     *  same event loop iteration. The send queue, the compression stream and the socket
+     *  are not synchronized, so this must only be called from the thread of the endpoint.
+     */
     virtual void doSendMessage(const Message &msg);
 
+    /** Asks the other endpoint to compress the messages it sends with a shared streaming context.
+     *  This is done if GammaRay has been built with ENABLE_MESSAGE_COMPRESSSION, and is a no-op otherwise.
+     */
+    void requestMessageCompression();
+    /** Answers a message compression request of the other endpoint. */
+    void acceptMessageCompression();
+    /** Compresses all messages sent from now on with a shared streaming context. */
+    void enableMessageCompression();
+
     /** All current object name/address pairs. */
     QVector<QPair<Protocol::ObjectAddress, QString> > objectAddresses() const;
 
@@ -188,11 +209,23 @@ protected:
 
 private slots:
     void readyRead();
+    void flushSendQueue();
     void connectionClosed();
     void handlerDestroyed(QObject *obj);
     void objectDestroyed(QObject *obj);
 
 private:
+    struct MethodCallInfo
+    {
+        MethodCallInfo()
+            : methodIndex(-1)
+        {
+        }
+
+        QByteArray name;
+        int methodIndex; // in the meta object of the local object, -1 if not resolved yet
+    };
+
     struct ObjectInfo
     {
         ObjectInfo()
@@ -210,12 +243,18 @@ private:
         // custom message handling support
         QObject *receiver;
         QMetaMethod messageHandler;
+
+        // method call ids, assigned by the sender on first use during a connection
+        QHash<QByteArray, quint32> outgoingMethodCalls;
+        QVector<MethodCallInfo> incomingMethodCalls;
     };
 
     /** Inserts @p oi into all maps. */
     void insertObjectInfo(ObjectInfo *oi);
     /** Removes @p oi from all maps and destroys it. */
     void removeObjectInfo(ObjectInfo *oi);
+    /** Invokes a method call received for @p obj. */
+    void invokeMethodCall(ObjectInfo *obj, const Message &msg);
 
     QHash<QString, ObjectInfo *> m_nameMap;
     QHash<Protocol::ObjectAddress, ObjectInfo *> m_addressMap;
@@ -225,6 +264,18 @@ private:
     QPointer<QIODevice> m_socket;
     Protocol::ObjectAddress m_myAddress;
 
+    // received data, messages being dispatched refer to this without copying
+    QByteArray m_receiveBuffer;
+    int m_receivePos;
+
+    // encoded messages waiting for the next flush, these share the message buffers
+    QVector<QByteArray> m_sendQueue;
+    int m_sendQueueSize;
+    QTimer *m_sendQueueTimer;
+
+    QScopedPointer<StreamCompressor> m_compressor;
+    QScopedPointer<StreamDecompressor> m_decompressor;
+
     QString m_label;
 };
 }
@@ -27,23 +27,28 @@
 */
 
 #include "message.h"
+#include "streamcompressor.h"
 
 #include "lz4/lz4.h" // 3rdparty
 
 #include <QDebug>
 #include <qendian.h>
 
-inline QByteArray compress(const QByteArray &src)
-{
-    const qint32 srcSz = src.size();
+#include <cstring>
 
+// compresses @p srcSz bytes at @p src, leaving @p headroom bytes in front of the result
+inline QByteArray compress(const char *src, qint32 srcSz, int headroom)
+{
     QByteArray dst;
-    dst.resize(LZ4_compressBound(srcSz + sizeof(srcSz)));
-    *(qint32 *)dst.data() = srcSz; // save the source size
+    dst.resize(headroom + sizeof(srcSz) + LZ4_compressBound(srcSz));
+    char *out = dst.data() + headroom;
+    *(qint32 *)out = srcSz; // save the source size
+    out += sizeof(srcSz);
 
-    const int sz
-        = LZ4_compress_default(src.constData(), dst.data() + sizeof(int), srcSz, dst.size());
-    dst.resize(sz + sizeof(srcSz));
+    const int sz = LZ4_compress_default(src, out, srcSz, dst.size() - headroom - sizeof(srcSz));
+    if (sz <= 0)
+        return QByteArray();
+    dst.resize(headroom + sizeof(srcSz) + sz);
     return dst;
 }
 
@@ -62,9 +67,9 @@ inline QByteArray uncompress(const QByteArray &src)
 }
 
 static const QDataStream::Version StreamVersion = QDataStream::Qt_4_7;
-#ifdef ENABLE_MESSAGE_COMPRESSSION
+static const int HeaderSize = sizeof(Protocol::PayloadSize) + sizeof(Protocol::ObjectAddress)
+                              + sizeof(Protocol::MessageType);
 static const int minimumUncompressedSize = 32;
-#endif
 
 #if QT_VERSION < 0x040800
 // This template-specialization is missing in qendian.h, required for qFromBigEndian
@@ -84,35 +89,57 @@ template<typename T> static T readNumber(QIODevice *device)
     return qFromBigEndian(buffer);
 }
 
-template<typename T> static void writeNumber(QIODevice *device, T value)
+template<typename T> static T readNumber(const char *src)
+{
+    T buffer;
+    memcpy(&buffer, src, sizeof(T));
+    return qFromBigEndian(buffer);
+}
+
+template<typename T> static char *writeNumber(char *dst, T value)
 {
     value = qToBigEndian(value);
-    const int writeSize = device->write((char *)&value, sizeof(T));
-    Q_UNUSED(writeSize);
-    Q_ASSERT(writeSize == sizeof(T));
+    memcpy(dst, &value, sizeof(T));
+    return dst + sizeof(T);
 }
 
 using namespace GammaRay;
 
 Message::Message()
-    : m_objectAddress(Protocol::InvalidObjectAddress)
+    : m_payloadOffset(0)
+    , m_objectAddress(Protocol::InvalidObjectAddress)
     , m_messageType(Protocol::InvalidMessageType)
 {
 }
 
 Message::Message(Protocol::ObjectAddress objectAddress, Protocol::MessageType type)
-    : m_objectAddress(objectAddress)
+    : m_payloadOffset(HeaderSize)
+    , m_objectAddress(objectAddress)
     , m_messageType(type)
 {
+    m_buffer.resize(HeaderSize);
 }
 
 #ifdef Q_COMPILER_RVALUE_REFS
 Message::Message(Message &&other)
     : m_buffer(std::move(other.m_buffer))
+    , m_payloadOffset(other.m_payloadOffset)
     , m_objectAddress(other.m_objectAddress)
     , m_messageType(other.m_messageType)
 {
-    m_stream.swap(other.m_stream);
+    if (other.m_receiveBuffer.isNull()) {
+        m_stream.swap(other.m_stream);
+        return;
+    }
+
+    // retaining a message that refers to a receive buffer, copy the payload out
+    m_buffer = QByteArray(m_buffer.constData(), m_buffer.size());
+    if (other.m_stream) {
+        const qint64 pos = other.m_stream->device()->pos();
+        payload().device()->seek(pos);
+        other.m_stream.reset();
+    }
+    other.m_receiveBuffer.clear();
 }
 
 #endif
@@ -134,10 +161,12 @@ Protocol::MessageType Message::type() const
 QDataStream &Message::payload() const
 {
     if (!m_stream) {
-        if (m_buffer.isEmpty())
+        if (m_payloadOffset > 0) {
             m_stream.reset(new QDataStream(&m_buffer, QIODevice::WriteOnly));
-        else
+            m_stream->device()->seek(m_payloadOffset);
+        } else {
             m_stream.reset(new QDataStream(m_buffer));
+        }
         m_stream->setVersion(StreamVersion);
     }
     return *m_stream;
@@ -145,9 +174,7 @@ QDataStream &Message::payload() const
 
 bool Message::canReadMessage(QIODevice *device)
 {
-    static const int minimumSize = sizeof(Protocol::PayloadSize) + sizeof(Protocol::ObjectAddress)
-                                   + sizeof(Protocol::MessageType);
-    if (device->bytesAvailable() < minimumSize)
+    if (device->bytesAvailable() < HeaderSize)
         return false;
 
     Protocol::PayloadSize payloadSize;
@@ -159,10 +186,24 @@ bool Message::canReadMessage(QIODevice *device)
         return false;
 
     payloadSize = abs(qFromBigEndian(payloadSize));
-    return device->bytesAvailable() >= payloadSize + minimumSize;
+    return device->bytesAvailable() >= payloadSize + HeaderSize;
 }
 
-Message Message::readMessage(QIODevice *device)
+static QByteArray uncompressPayload(const QByteArray &buff, StreamDecompressor *decompressor)
+{
+    const qint32 uncompressedSize = *(const qint32 *)buff.constData();
+    if (uncompressedSize >= 0)
+        return uncompress(buff);
+
+    // part of a compression stream
+    Q_ASSERT(decompressor);
+    if (!decompressor)
+        return QByteArray();
+    return decompressor->uncompress(buff.constData() + sizeof(qint32),
+                                    buff.size() - sizeof(qint32), -uncompressedSize);
+}
+
+Message Message::readMessage(QIODevice *device, StreamDecompressor *decompressor)
 {
     Message msg;
 
@@ -175,8 +216,8 @@ Message Message::readMessage(QIODevice *device)
     if (payloadSize < 0) {
         payloadSize = abs(payloadSize);
         QByteArray buff = device->read(payloadSize);
-        msg.m_buffer = uncompress(buff);
         Q_ASSERT(payloadSize == buff.size());
+        msg.m_buffer = uncompressPayload(buff, decompressor);
     } else {
         if (payloadSize > 0) {
             msg.m_buffer = device->read(payloadSize);
@@ -186,43 +227,106 @@ Message Message::readMessage(QIODevice *device)
     return msg;
 }
 
-void Message::write(QIODevice *device) const
+bool Message::canReadMessage(const QByteArray &buffer, int pos)
 {
-    Q_ASSERT(m_objectAddress != Protocol::InvalidObjectAddress);
-    Q_ASSERT(m_messageType != Protocol::InvalidMessageType);
-    const int buffSize = m_buffer.size();
-#ifdef ENABLE_MESSAGE_COMPRESSSION
-    QByteArray buff;
-    if (buffSize > minimumUncompressedSize)
-        buff = compress(m_buffer);
+    const int available = buffer.size() - pos;
+    if (available < HeaderSize)
+        return false;
 
-    if (buff.size() && buff.size() < buffSize)
-        writeNumber<Protocol::PayloadSize>(device, -buff.size()); // send compressed Buffer
-    else
-#endif
-    writeNumber<Protocol::PayloadSize>(device, buffSize);   // send uncompressed Buffer
+    const Protocol::PayloadSize payloadSize
+        = abs(readNumber<Protocol::PayloadSize>(buffer.constData() + pos));
+    return available >= payloadSize + HeaderSize;
+}
 
-    writeNumber(device, m_objectAddress);
-    writeNumber(device, m_messageType);
+Message Message::readMessage(const QByteArray &buffer, int &pos,
+                             StreamDecompressor *decompressor)
+{
+    Message msg;
 
-#ifdef ENABLE_MESSAGE_COMPRESSSION
-    if (buffSize) {
-        if (buff.size() && buff.size() < buffSize) {
-            const int s = device->write(buff);
-            Q_ASSERT(s == buff.size());
-            Q_UNUSED(s);
-        } else {
-#endif
-    const int s = device->write(m_buffer);
-    Q_ASSERT(s == m_buffer.size());
+    const char *data = buffer.constData() + pos;
+    Protocol::PayloadSize payloadSize = readNumber<Protocol::PayloadSize>(data);
+    data += sizeof(Protocol::PayloadSize);
+    msg.m_objectAddress = readNumber<Protocol::ObjectAddress>(data);
+    data += sizeof(Protocol::ObjectAddress);
+    msg.m_messageType = readNumber<Protocol::MessageType>(data);
+    data += sizeof(Protocol::MessageType);
+    Q_ASSERT(msg.m_messageType != Protocol::InvalidMessageType);
+    Q_ASSERT(msg.m_objectAddress != Protocol::InvalidObjectAddress);
+
+    if (payloadSize < 0) {
+        payloadSize = abs(payloadSize);
+        msg.m_buffer = uncompressPayload(QByteArray::fromRawData(data, payloadSize), decompressor);
+    } else if (payloadSize > 0) {
+        // the shared reference keeps the data alive, should the owner of buffer modify it
+        // while the message still exists
+        msg.m_receiveBuffer = buffer;
+        msg.m_buffer = QByteArray::fromRawData(data, payloadSize);
+    }
+    Q_ASSERT(pos + HeaderSize + payloadSize <= buffer.size());
+    pos += HeaderSize + payloadSize;
+    return msg;
+}
+
+void Message::write(QIODevice *device) const
+{
+    const QByteArray data = toByteArray();
+    const int s = device->write(data);
+    Q_ASSERT(s == data.size());
     Q_UNUSED(s);
-#ifdef ENABLE_MESSAGE_COMPRESSSION
 }
+
+void Message::writeHeader(char *dst, Protocol::PayloadSize payloadSize) const
+{
+    Q_ASSERT(m_objectAddress != Protocol::InvalidObjectAddress);
+    Q_ASSERT(m_messageType != Protocol::InvalidMessageType);
+    dst = writeNumber(dst, payloadSize);
+    dst = writeNumber(dst, m_objectAddress);
+    writeNumber(dst, m_messageType);
 }
+
+QByteArray Message::toByteArray(StreamCompressor *compressor) const
+{
+    const int payloadSize = size();
+    if (compressor && payloadSize > 0) {
+        // always use the stream once negotiated, even tiny payloads benefit from the
+        // shared dictionary and the receiver has to see every block we compressed
+        QByteArray data = compressor->compress(m_buffer.constData() + m_payloadOffset, payloadSize,
+                                               HeaderSize);
+        if (!data.isEmpty()) {
+            writeHeader(data.data(), -(data.size() - HeaderSize));
+            return data;
+        }
+    }
+
+#ifdef ENABLE_MESSAGE_COMPRESSSION
+    const bool compressIndependently = true;
+#else
+    const bool compressIndependently = compressor; // too large for the stream
 #endif
+    if (compressIndependently && payloadSize > minimumUncompressedSize) {
+        QByteArray data = compress(m_buffer.constData() + m_payloadOffset, payloadSize, HeaderSize);
+        const int compressedSize = data.size() - HeaderSize;
+        if (compressedSize > 0 && compressedSize < payloadSize) {
+            writeHeader(data.data(), -compressedSize); // send compressed buffer
+            return data;
+        }
+    }
+
+    if (m_payloadOffset == 0) { // received message, no room for the header
+        QByteArray data;
+        data.reserve(HeaderSize + payloadSize);
+        data.resize(HeaderSize);
+        data.append(m_buffer);
+        writeHeader(data.data(), payloadSize);
+        return data;
+    }
+
+    Q_ASSERT(m_payloadOffset == HeaderSize);
+    writeHeader(m_buffer.data(), payloadSize);
+    return m_buffer;
 }
 
 int Message::size() const
 {
-    return m_buffer.size();
+    return m_buffer.size() - m_payloadOffset;
 }
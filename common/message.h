@@ -36,6 +36,9 @@
 #include <QDataStream>
 
 namespace GammaRay {
+class StreamCompressor;
+class StreamDecompressor;
+
 /**
  * Single message send between client and server.
  * Binary format:
@@ -70,19 +73,46 @@ public:
 
     /** Checks if there is a full message waiting in @p device. */
     static bool canReadMessage(QIODevice *device);
-    /** Read the next message from @p device. */
-    static Message readMessage(QIODevice *device);
+    /** Read the next message from @p device.
+     *  @p decompressor is needed for messages compressed by a StreamCompressor.
+     */
+    static Message readMessage(QIODevice *device, StreamDecompressor *decompressor = Q_NULLPTR);
+
+    /** Checks if there is a full message at position @p pos in @p buffer.
+     *  @since 2.6
+     */
+    static bool canReadMessage(const QByteArray &buffer, int pos);
+    /** Read the message at position @p pos in @p buffer, and advance @p pos past it.
+     *  Uncompressed payloads are not copied, the message refers to @p buffer instead.
+     *  Moving the message to retain it beyond that copies the payload out.
+     *  @since 2.6
+     */
+    static Message readMessage(const QByteArray &buffer, int &pos,
+                               StreamDecompressor *decompressor = Q_NULLPTR);
 
     /** Write this message to @p device. */
     void write(QIODevice *device) const;
 
+    /** Returns the complete binary representation of this message, header included.
+     *  The header is built in place in front of the payload, so for uncompressed
+     *  messages this shares the payload buffer instead of copying it.
+     *  If @p compressor is given, the payload is compressed as part of its stream.
+     *  @since 2.6
+     */
+    QByteArray toByteArray(StreamCompressor *compressor = Q_NULLPTR) const;
+
     /** Size of the uncompressed message payload. */
     int size() const;
 
 private:
     Message();
+    void writeHeader(char *dst, Protocol::PayloadSize payloadSize) const;
 
+    // outgoing messages keep room for the header in front of the payload
     mutable QByteArray m_buffer;
+    int m_payloadOffset;
+    // the buffer a received message refers to, if not copied
+    QByteArray m_receiveBuffer;
     mutable QScopedPointer<QDataStream> m_stream;
 
     Protocol::ObjectAddress m_objectAddress;
@@ -31,6 +31,7 @@
 
 #include <QDebug>
 #include <QMetaProperty>
+#include <QTimer>
 
 #include <algorithm>
 
@@ -44,8 +45,13 @@ static int qobjectPropertyOffset()
 PropertySyncer::PropertySyncer(QObject *parent)
     : QObject(parent)
     , m_address(Protocol::InvalidObjectAddress)
+    , m_flushTimer(new QTimer(this))
     , m_initialSync(false)
 {
+    // properties tend to change in bursts, so announce them once per event loop pass
+    m_flushTimer->setSingleShot(true);
+    m_flushTimer->setInterval(0);
+    connect(m_flushTimer, SIGNAL(timeout()), this, SLOT(flushPendingChanges()));
 }
 
 PropertySyncer::~PropertySyncer()
@@ -132,49 +138,31 @@ void PropertySyncer::handleMessage(const GammaRay::Message &msg)
         if (it == m_objects.constEnd())
             break;
 
-        QVector<QPair<QByteArray, QVariant> > values;
         const auto propCount = (*it).obj->metaObject()->propertyCount();
-        values.reserve(propCount);
+        Q_ASSERT(propCount > qobjectPropertyOffset());
+
+        Message msg(m_address, Protocol::PropertyValuesChanged);
+        msg.payload() << (quint32)1 << addr << (quint32)(propCount - qobjectPropertyOffset());
         for (int i = qobjectPropertyOffset(); i < propCount; ++i) {
             const auto prop = (*it).obj->metaObject()->property(i);
-            values.push_back(qMakePair(QByteArray(prop.name()), prop.read((*it).obj)));
+            msg.payload() << (quint16)(i - qobjectPropertyOffset()) << prop.read((*it).obj);
         }
-        Q_ASSERT(!values.isEmpty());
-
-        Message msg(m_address, Protocol::PropertyValuesChanged);
-        msg.payload() << addr << (quint32)values.size();
-        foreach (const auto &value, values)
-            msg.payload() << value.first << value.second;
         emit message(msg);
         break;
     }
     case Protocol::PropertyValuesChanged:
     {
-        Protocol::ObjectAddress addr;
-        quint32 changeSize;
-        msg.payload() >> addr >> changeSize;
-        Q_ASSERT(addr != Protocol::InvalidObjectAddress);
-        Q_ASSERT(changeSize > 0);
-
-        auto it = std::find_if(m_objects.begin(), m_objects.end(), [addr](const ObjectInfo &info) {
-                return info.addr == addr;
-            });
-        if (it == m_objects.end())
-            break;
-
-        for (quint32 i = 0; i < changeSize; ++i) {
-            QByteArray propName;
-            QVariant propValue;
-            msg.payload() >> propName >> propValue;
-            (*it).recursionLock = true;
-            (*it).obj->setProperty(propName, propValue);
-
-            // it can be invalid if as a result of the above call new objects have been registered for example
-            it = std::find_if(m_objects.begin(), m_objects.end(), [addr](const ObjectInfo &info) {
-                    return info.addr == addr;
-                });
-            Q_ASSERT(it != m_objects.end());
-            (*it).recursionLock = false;
+        quint32 objectCount;
+        msg.payload() >> objectCount;
+        Q_ASSERT(objectCount > 0);
+
+        for (quint32 i = 0; i < objectCount; ++i) {
+            Protocol::ObjectAddress addr;
+            quint32 changeSize;
+            msg.payload() >> addr >> changeSize;
+            Q_ASSERT(addr != Protocol::InvalidObjectAddress);
+            Q_ASSERT(changeSize > 0);
+            applyChanges(addr, changeSize, msg);
         }
         break;
     }
@@ -183,34 +171,93 @@ void PropertySyncer::handleMessage(const GammaRay::Message &msg)
     }
 }
 
+void PropertySyncer::applyChanges(Protocol::ObjectAddress addr, quint32 changeSize,
+                                  const Message &msg)
+{
+    auto it = std::find_if(m_objects.begin(), m_objects.end(), [addr](const ObjectInfo &info) {
+            return info.addr == addr;
+        });
+
+    for (quint32 i = 0; i < changeSize; ++i) {
+        quint16 propIndex;
+        QVariant propValue;
+        msg.payload() >> propIndex >> propValue;
+        if (it == m_objects.end())
+            continue; // still need to consume the values, other objects might follow
+
+        const auto prop = (*it).obj->metaObject()->property(qobjectPropertyOffset() + propIndex);
+        if (!prop.isValid())
+            continue;
+        // the other side has the latest value now, no need to send it back
+        const int pendingIndex = (*it).pendingProperties.indexOf(prop.propertyIndex());
+        if (pendingIndex >= 0)
+            (*it).pendingProperties.remove(pendingIndex);
+        (*it).recursionLock = true;
+        prop.write((*it).obj, propValue);
+
+        // it can be invalid if as a result of the above call new objects have been registered for example
+        it = std::find_if(m_objects.begin(), m_objects.end(), [addr](const ObjectInfo &info) {
+                return info.addr == addr;
+            });
+        Q_ASSERT(it != m_objects.end());
+        (*it).recursionLock = false;
+    }
+}
+
 void PropertySyncer::propertyChanged()
 {
     const auto *obj = sender();
     Q_ASSERT(obj);
     const auto it
-        = std::find_if(m_objects.constBegin(), m_objects.constEnd(), [obj](const ObjectInfo &info) {
+        = std::find_if(m_objects.begin(), m_objects.end(), [obj](const ObjectInfo &info) {
         return info.obj == obj;
     });
-    Q_ASSERT(it != m_objects.constEnd());
+    Q_ASSERT(it != m_objects.end());
 
     if ((*it).recursionLock || !(*it).enabled)
         return;
 
+    // values are only read when flushing, so intermediate values are never sent
     const auto sigIndex = senderSignalIndex();
-    QVector<QPair<QByteArray, QVariant> > changes;
     for (int i = qobjectPropertyOffset(); i < obj->metaObject()->propertyCount(); ++i) {
         const auto prop = obj->metaObject()->property(i);
-        if (prop.notifySignalIndex() != sigIndex)
+        if (prop.notifySignalIndex() != sigIndex || (*it).pendingProperties.contains(i))
             continue;
-        changes.push_back(qMakePair(QByteArray(prop.name()), prop.read(obj)));
+        (*it).pendingProperties.push_back(i);
     }
-    Q_ASSERT(!changes.isEmpty());
+
+    if (!m_flushTimer->isActive())
+        m_flushTimer->start();
+}
+
+void PropertySyncer::flushPendingChanges()
+{
+    if (!m_flushTimer->isActive())
+        return; // nothing pending
+    m_flushTimer->stop();
+
+    const auto hasChanges = [](const ObjectInfo &info) {
+        return info.enabled && !info.pendingProperties.isEmpty();
+    };
+    const auto objectCount = std::count_if(m_objects.constBegin(), m_objects.constEnd(),
+                                           hasChanges);
 
     Message msg(m_address, Protocol::PropertyValuesChanged);
-    msg.payload() << (*it).addr << (quint32)changes.size();
-    foreach (const auto &change, changes)
-        msg.payload() << change.first << change.second;
-    emit message(msg);
+    msg.payload() << (quint32)objectCount;
+    for (auto it = m_objects.begin(); it != m_objects.end(); ++it) {
+        if (hasChanges(*it)) {
+            msg.payload() << (*it).addr << (quint32)(*it).pendingProperties.size();
+            foreach (int propIndex, (*it).pendingProperties) {
+                const auto prop = (*it).obj->metaObject()->property(propIndex);
+                msg.payload() << (quint16)(propIndex - qobjectPropertyOffset())
+                              << prop.read((*it).obj);
+            }
+        }
+        (*it).pendingProperties.clear();
+    }
+
+    if (objectCount > 0)
+        emit message(msg);
 }
 
 void PropertySyncer::objectDestroyed(QObject *obj)
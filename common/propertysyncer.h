@@ -36,10 +36,20 @@
 #include <QObject>
 #include <QVector>
 
+QT_BEGIN_NAMESPACE
+class QTimer;
+QT_END_NAMESPACE
+
 namespace GammaRay {
 class Message;
 
-/** Infrastructure for syncing property values between a local and a remote object. */
+/** Infrastructure for syncing property values between a local and a remote object.
+ *
+ *  Property changes are collected and sent once per event loop pass, with only the latest
+ *  value of each changed property of all objects in a single message. Properties are
+ *  identified by their index, so both sides need to use objects with the same set of
+ *  properties, such as implementations of the same interface.
+ */
 class GAMMARAY_COMMON_EXPORT PropertySyncer : public QObject
 {
     Q_OBJECT
@@ -69,6 +79,12 @@ public slots:
     /** Feed in incoming network messages here. */
     void handleMessage(const GammaRay::Message &msg);
 
+    /** Sends all pending property changes right away.
+     *  Use this to keep the order with other messages sent to the other side.
+     *  @since 2.6
+     */
+    void flushPendingChanges();
+
 signals:
     /** Outgoing network messages, send those via Endpoint. */
     void message(const GammaRay::Message &msg);
@@ -78,14 +94,19 @@ private slots:
     void objectDestroyed(QObject *obj);
 
 private:
+    void applyChanges(Protocol::ObjectAddress addr, quint32 changeSize, const Message &msg);
+
     struct ObjectInfo {
         Protocol::ObjectAddress addr;
         QObject *obj;
         bool recursionLock;
         bool enabled;
+        // indexes of changed properties whose values have not been sent yet
+        QVector<int> pendingProperties;
     };
     QVector<ObjectInfo> m_objects;
     Protocol::ObjectAddress m_address;
+    QTimer *m_flushTimer; // active while there are pending changes
     bool m_initialSync;
 };
 }
@@ -100,6 +100,12 @@ enum BuildInMessageType {
     ProbeSettings,
     ServerAddress,
 
+    // streaming message compression, see Endpoint::requestMessageCompression()
+    // client -> server
+    MessageCompressionRequest,
+    // server -> client
+    MessageCompressionReply,
+
     MESSAGE_TYPE_COUNT // NOTE when changing this enum, also update MessageStatisticsModel!
 };
 
@@ -82,6 +82,26 @@ void RemoteViewFrame::setImage(const QImage &image)
     m_image.setImage(image);
 }
 
+void RemoteViewFrame::setImageCodec(TransferImage::TileCodec codec)
+{
+    m_image.setTileCodec(codec);
+}
+
+void RemoteViewFrame::setPreviousImage(const QImage &image)
+{
+    m_image.setPreviousImage(image);
+}
+
+bool RemoteViewFrame::isDelta() const
+{
+    return m_image.isDelta();
+}
+
+bool RemoteViewFrame::applyDelta(RemoteViewFrame &previous)
+{
+    return m_image.applyDelta(previous.m_image);
+}
+
 QVariant RemoteViewFrame::data() const
 {
     return m_data;
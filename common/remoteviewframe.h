@@ -62,6 +62,18 @@ public:
     QImage image() const;
     void setImage(const QImage &image);
 
+    /// encoding of the image for transfer
+    void setImageCodec(TransferImage::TileCodec codec);
+    /// only transfer what changed compared to @p image, the client got that with the last frame
+    void setPreviousImage(const QImage &image);
+
+    /// on the client, @c true if only the changed parts of the image have been received
+    bool isDelta() const;
+    /** Completes the image of a delta frame based on the @p previous frame, taking over its image.
+     *  Returns @c false if the delta doesn't fit onto @p previous.
+     */
+    bool applyDelta(RemoteViewFrame &previous);
+
     /// tool specific frame data
     QVariant data() const;
     void setData(const QVariant &data);
@@ -64,6 +64,9 @@ public slots:
     /// Tell the server we are ready for the next frame.
     virtual void clientViewUpdated() = 0;
 
+    /// Ask for a frame with the full image, if a delta frame could not be applied.
+    virtual void requestCompleteFrame() = 0;
+
 signals:
     void reset();
     void frameUpdated(const GammaRay::RemoteViewFrame &frame);
@@ -0,0 +1,131 @@
+/*
+  streamcompressor.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "streamcompressor.h"
+
+#include <cstring>
+
+using namespace GammaRay;
+
+// Both sides decode into a ring buffer of the same layout, so that the last
+// DictionarySize bytes of history stay in place for the next block to refer to.
+// Blocks are never split, we wrap around once the remaining space might not fit
+// a maximum size block anymore.
+static const int DictionarySize = 64 * 1024;
+static const int MaximumBlockSize = 64 * 1024;
+static const int RingBufferSize = DictionarySize + MaximumBlockSize;
+
+static int advance(int offset, int blockSize)
+{
+    offset += blockSize;
+    if (offset >= RingBufferSize - MaximumBlockSize)
+        return 0;
+    return offset;
+}
+
+StreamCompressor::StreamCompressor()
+    : m_stream(LZ4_createStream())
+    , m_offset(0)
+{
+    m_ringBuffer.resize(RingBufferSize);
+}
+
+StreamCompressor::~StreamCompressor()
+{
+    LZ4_freeStream(m_stream);
+}
+
+int StreamCompressor::maximumBlockSize()
+{
+    return MaximumBlockSize;
+}
+
+QByteArray StreamCompressor::compress(const char *data, int size, int headroom)
+{
+    Q_ASSERT(size > 0);
+    if (size > MaximumBlockSize)
+        return QByteArray();
+
+    // the input has to stay around as dictionary for the following blocks
+    char *block = m_ringBuffer.data() + m_offset;
+    memcpy(block, data, size);
+
+    const qint32 sizeMarker = -size; // negative size marks a streamed block
+    const int bound = LZ4_compressBound(size);
+    QByteArray dst;
+    dst.resize(headroom + sizeof(sizeMarker) + bound);
+    char *out = dst.data() + headroom;
+    memcpy(out, &sizeMarker, sizeof(sizeMarker));
+    out += sizeof(sizeMarker);
+
+    const int sz = LZ4_compress_fast_continue(m_stream, block, out, size, bound, 1);
+    // can't fail with a destination of LZ4_compressBound() size, and we couldn't
+    // recover from a stream the decompressor doesn't know about anyway
+    Q_ASSERT(sz > 0);
+
+    dst.resize(headroom + sizeof(sizeMarker) + sz);
+    m_offset = advance(m_offset, size);
+    return dst;
+}
+
+void StreamCompressor::reset()
+{
+    LZ4_resetStream(m_stream);
+    m_offset = 0;
+}
+
+StreamDecompressor::StreamDecompressor()
+    : m_stream(LZ4_createStreamDecode())
+    , m_offset(0)
+{
+    m_ringBuffer.resize(RingBufferSize);
+}
+
+StreamDecompressor::~StreamDecompressor()
+{
+    LZ4_freeStreamDecode(m_stream);
+}
+
+QByteArray StreamDecompressor::uncompress(const char *data, int size, int uncompressedSize)
+{
+    if (uncompressedSize <= 0 || uncompressedSize > MaximumBlockSize)
+        return QByteArray();
+
+    char *block = m_ringBuffer.data() + m_offset;
+    const int sz = LZ4_decompress_safe_continue(m_stream, data, block, size, uncompressedSize);
+    if (sz != uncompressedSize)
+        return QByteArray();
+
+    m_offset = advance(m_offset, sz);
+    return QByteArray(block, sz);
+}
+
+void StreamDecompressor::reset()
+{
+    LZ4_setStreamDecode(m_stream, Q_NULLPTR, 0);
+    m_offset = 0;
+}
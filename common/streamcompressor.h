@@ -0,0 +1,96 @@
+/*
+  streamcompressor.h
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GAMMARAY_STREAMCOMPRESSOR_H
+#define GAMMARAY_STREAMCOMPRESSOR_H
+
+#include "gammaray_common_export.h"
+
+#include "lz4/lz4.h" // 3rdparty
+
+#include <QByteArray>
+
+namespace GammaRay {
+/** @brief LZ4 compression of consecutive message payloads sharing one streaming context.
+ *
+ *  Each payload is compressed with the previously compressed ones as dictionary, which
+ *  pays off for the many small and repetitive messages the remote model sends.
+ *  There must be exactly one StreamCompressor per connection direction, matched
+ *  by a StreamDecompressor on the receiving side that sees the same blocks in the same order.
+ */
+class GAMMARAY_COMMON_EXPORT StreamCompressor
+{
+public:
+    StreamCompressor();
+    ~StreamCompressor();
+
+    /** Compresses @p size bytes at @p data as the next block in the stream.
+     *  The result contains @p headroom uninitialized bytes, followed by the negated
+     *  uncompressed size and the compressed data.
+     *  Returns an empty buffer if @p size exceeds maximumBlockSize(), in which case
+     *  the stream is not modified.
+     */
+    QByteArray compress(const char *data, int size, int headroom);
+
+    /** Starts a new stream, without any reference to previous blocks. */
+    void reset();
+
+    /** Largest payload that can be compressed as part of the stream. */
+    static int maximumBlockSize();
+
+private:
+    Q_DISABLE_COPY(StreamCompressor)
+    LZ4_stream_t *m_stream;
+    QByteArray m_ringBuffer;
+    int m_offset;
+};
+
+/** @brief Decompression counterpart of StreamCompressor. */
+class GAMMARAY_COMMON_EXPORT StreamDecompressor
+{
+public:
+    StreamDecompressor();
+    ~StreamDecompressor();
+
+    /** Decompresses the next block of the stream, @p size bytes at @p data
+     *  expanding to @p uncompressedSize bytes.
+     *  Returns an empty buffer on corrupt input.
+     */
+    QByteArray uncompress(const char *data, int size, int uncompressedSize);
+
+    /** Starts a new stream, matching StreamCompressor::reset(). */
+    void reset();
+
+private:
+    Q_DISABLE_COPY(StreamDecompressor)
+    LZ4_streamDecode_t *m_stream;
+    QByteArray m_ringBuffer;
+    int m_offset;
+};
+}
+
+#endif // GAMMARAY_STREAMCOMPRESSOR_H
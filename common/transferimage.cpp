@@ -28,15 +28,279 @@
 
 #include "transferimage.h"
 
+#include "lz4/lz4.h" // 3rdparty
+
+#include <QAtomicInt>
+#include <QBuffer>
 #include <QDebug>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
 
 namespace GammaRay {
+static const int DefaultTileSize = 64;
+static const int JpegQuality = 80;
+// below that, handing tiles to another thread costs more than it saves
+static const int MinimumTilesPerJob = 8;
+
+Q_GLOBAL_STATIC(QThreadPool, s_tilePool)
+
+namespace {
+/** Row-major grid of square tiles, the ones at the right and bottom edge might be smaller. */
+struct TileGrid
+{
+    TileGrid(const QSize &size, int tileSize)
+        : imageRect(QPoint(), size)
+        , tileSize(tileSize)
+        , columns(tileSize > 0 ? (size.width() + tileSize - 1) / tileSize : 0)
+        , rows(tileSize > 0 ? (size.height() + tileSize - 1) / tileSize : 0)
+    {
+    }
+
+    int count() const
+    {
+        return columns * rows;
+    }
+
+    QRect rect(int index) const
+    {
+        return QRect((index % columns) * tileSize, (index / columns) * tileSize,
+                     tileSize, tileSize) & imageRect;
+    }
+
+    QRect imageRect;
+    int tileSize;
+    int columns;
+    int rows;
+};
+
+/** Image memory as seen by the tile workers.
+ *  Non-const QImage access detaches, which is not safe from multiple threads at once.
+ */
+struct PixelBuffer
+{
+    PixelBuffer(const uchar *bits, const QImage &image)
+        : bits(const_cast<uchar *>(bits))
+        , bytesPerLine(image.bytesPerLine())
+        , bytesPerPixel(image.depth() / 8)
+        , width(image.width())
+        , format(image.format())
+    {
+    }
+
+    uchar *line(int y) const
+    {
+        return bits + y * bytesPerLine;
+    }
+
+    uchar *bits;
+    int bytesPerLine;
+    int bytesPerPixel;
+    int width;
+    QImage::Format format;
+};
+
+template<typename Func>
+class TileJob : public QRunnable
+{
+public:
+    TileJob(const Func &func, int count, QAtomicInt *next, QSemaphore *done)
+        : m_func(func)
+        , m_count(count)
+        , m_next(next)
+        , m_done(done)
+    {
+    }
+
+    void run() Q_DECL_OVERRIDE
+    {
+        process();
+        m_done->release();
+    }
+
+    void process()
+    {
+        int index;
+        while ((index = m_next->fetchAndAddRelaxed(1)) < m_count)
+            m_func(index);
+    }
+
+private:
+    const Func &m_func;
+    int m_count;
+    QAtomicInt *m_next;
+    QSemaphore *m_done;
+};
+}
+
+// calls func for 0 <= index < count on the tile pool and the calling thread, and waits for all
+template<typename Func>
+static void forEachTile(int count, const Func &func)
+{
+    const int jobs = std::min(count / MinimumTilesPerJob, QThread::idealThreadCount());
+    if (jobs <= 1) {
+        for (int index = 0; index < count; ++index)
+            func(index);
+        return;
+    }
+
+    QAtomicInt next(0);
+    QSemaphore done;
+    for (int i = 1; i < jobs; ++i)
+        s_tilePool()->start(new TileJob<Func>(func, count, &next, &done));
+    // help out rather than just waiting, this also guarantees progress if the pool is busy
+    TileJob<Func>(func, count, &next, &done).process();
+    done.acquire(jobs - 1);
+}
+
+// tiles are addressed in whole bytes, and color tables are not transferred
+static QImage transferableImage(const QImage &image)
+{
+    if (!image.isNull() && (image.depth() < 8 || image.format() == QImage::Format_Indexed8))
+        return image.convertToFormat(QImage::Format_ARGB32);
+    return image;
+}
+
+static bool tileChanged(const PixelBuffer &pixels, const PixelBuffer &previous, const QRect &rect)
+{
+    const int offset = rect.x() * pixels.bytesPerPixel;
+    const int length = rect.width() * pixels.bytesPerPixel;
+    for (int y = rect.top(); y <= rect.bottom(); ++y) {
+        if (memcmp(pixels.line(y) + offset, previous.line(y) + offset, length))
+            return true;
+    }
+    return false;
+}
+
+static int rawTileSize(const PixelBuffer &pixels, const QRect &rect)
+{
+    return rect.width() * pixels.bytesPerPixel * rect.height();
+}
+
+static QByteArray encodeTile(const PixelBuffer &pixels, const QRect &rect,
+                             TransferImage::TileCodec codec)
+{
+    const int offset = rect.x() * pixels.bytesPerPixel;
+    const int length = rect.width() * pixels.bytesPerPixel;
+
+    switch (codec) {
+    case TransferImage::RawCodec:
+        // written straight from the image instead, see operator<<
+        break;
+    case TransferImage::Lz4Codec:
+    {
+        // store the difference to the line above, like PNG's "up" filter,
+        // which turns gradients and repeated patterns into runs of zeros
+        const int rawSize = rawTileSize(pixels, rect);
+        QByteArray filtered;
+        filtered.resize(rawSize);
+        uchar *out = reinterpret_cast<uchar *>(filtered.data());
+        memcpy(out, pixels.line(rect.top()) + offset, length);
+        out += length;
+        for (int y = rect.top() + 1; y <= rect.bottom(); ++y, out += length) {
+            const uchar *above = pixels.line(y - 1) + offset;
+            const uchar *current = pixels.line(y) + offset;
+            for (int i = 0; i < length; ++i)
+                out[i] = current[i] - above[i];
+        }
+
+        // the receiver knows the uncompressed size from the tile geometry already
+        QByteArray data;
+        data.resize(LZ4_compressBound(rawSize));
+        const int size = LZ4_compress_default(filtered.constData(), data.data(), rawSize,
+                                              data.size());
+        if (size <= 0)
+            return QByteArray();
+        data.resize(size);
+        return data;
+    }
+    case TransferImage::PngCodec:
+    case TransferImage::JpegCodec:
+    {
+        const QImage tile(pixels.line(rect.top()) + offset, rect.width(), rect.height(),
+                          pixels.bytesPerLine, pixels.format);
+        QByteArray data;
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::WriteOnly);
+        if (codec == TransferImage::PngCodec)
+            tile.save(&buffer, "PNG");
+        else
+            tile.save(&buffer, "JPG", JpegQuality);
+        return data;
+    }
+    }
+    return QByteArray();
+}
+
+// corrupt tiles are skipped, rather than writing out of bounds
+static void decodeTile(const PixelBuffer &pixels, const QRect &rect,
+                       TransferImage::TileCodec codec, const char *data, int size)
+{
+    const int offset = rect.x() * pixels.bytesPerPixel;
+    const int length = rect.width() * pixels.bytesPerPixel;
+
+    switch (codec) {
+    case TransferImage::RawCodec:
+    {
+        if (size != rawTileSize(pixels, rect))
+            return;
+        for (int y = rect.top(); y <= rect.bottom(); ++y, data += length)
+            memcpy(pixels.line(y) + offset, data, length);
+        break;
+    }
+    case TransferImage::Lz4Codec:
+    {
+        const int rawSize = rawTileSize(pixels, rect);
+        QByteArray filtered;
+        filtered.resize(rawSize);
+        if (LZ4_decompress_safe(data, filtered.data(), size, rawSize) != rawSize)
+            return;
+        const uchar *in = reinterpret_cast<const uchar *>(filtered.constData());
+        memcpy(pixels.line(rect.top()) + offset, in, length);
+        in += length;
+        for (int y = rect.top() + 1; y <= rect.bottom(); ++y, in += length) {
+            const uchar *above = pixels.line(y - 1) + offset;
+            uchar *current = pixels.line(y) + offset;
+            for (int i = 0; i < length; ++i)
+                current[i] = in[i] + above[i];
+        }
+        break;
+    }
+    case TransferImage::PngCodec:
+    case TransferImage::JpegCodec:
+    {
+        const QImage tile = QImage::fromData(reinterpret_cast<const uchar *>(data), size)
+                            .convertToFormat(pixels.format);
+        if (tile.size() != rect.size())
+            return;
+        for (int y = 0; y < rect.height(); ++y)
+            memcpy(pixels.line(rect.top() + y) + offset, tile.constScanLine(y), length);
+        break;
+    }
+    }
+}
+
 TransferImage::TransferImage()
+    : m_codec(RawCodec)
+    , m_deltaFormat(QImage::Format_Invalid)
+    , m_deltaRatio(1.0)
+    , m_deltaTileSize(0)
+    , m_isDelta(false)
 {
 }
 
 TransferImage::TransferImage(const QImage &image)
     : m_image(image)
+    , m_codec(RawCodec)
+    , m_deltaFormat(QImage::Format_Invalid)
+    , m_deltaRatio(1.0)
+    , m_deltaTileSize(0)
+    , m_isDelta(false)
 {
 }
 
@@ -48,11 +312,101 @@ const QImage &TransferImage::image() const
 void TransferImage::setImage(const QImage &image)
 {
     m_image = image;
+    m_tiles.clear();
+    m_isDelta = false;
+}
+
+TransferImage::TileCodec TransferImage::tileCodec() const
+{
+    return m_codec;
+}
+
+void TransferImage::setTileCodec(TileCodec codec)
+{
+    m_codec = codec;
+}
+
+void TransferImage::setPreviousImage(const QImage &image)
+{
+    m_previousImage = image;
+}
+
+bool TransferImage::isDelta() const
+{
+    return m_isDelta;
+}
+
+bool TransferImage::applyDelta(TransferImage &previous)
+{
+    if (!m_isDelta)
+        return true;
+    if (previous.m_image.size() != m_deltaSize || previous.m_image.format() != m_deltaFormat)
+        return false;
+
+    // take over the previous image, so compositing onto it does not need to detach
+    QImage img;
+    img.swap(previous.m_image);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+    img.setDevicePixelRatio(m_deltaRatio);
+#endif
+    decodeTiles(img, m_deltaTileSize);
+    setImage(img);
+    return true;
+}
+
+void TransferImage::decodeTiles(QImage &image, int tileSize)
+{
+    const TileGrid grid(image.size(), tileSize);
+    const PixelBuffer pixels(image.bits(), image);
+    const TileCodec codec = m_codec;
+    const Tile *tiles = m_tiles.constData();
+    const char *data = m_tileData.constData();
+    const auto decode = [&](int i) {
+        const Tile &tile = tiles[i];
+        if (tile.index < quint32(grid.count()))
+            decodeTile(pixels, grid.rect(tile.index), codec, data + tile.offset, tile.size);
+    };
+
+    if (codec == RawCodec) {
+        // just copying memory, that doesn't get faster with more threads
+        for (int i = 0; i < m_tiles.size(); ++i)
+            decode(i);
+    } else {
+        forEachTile(m_tiles.size(), decode);
+    }
+    m_tiles.clear();
+    m_tileData.clear();
+}
+
+bool TransferImage::readTiles(QDataStream &stream, quint32 count)
+{
+    m_tiles.resize(count);
+    qint64 totalSize = 0;
+    for (quint32 n = 0; n < count; ++n) {
+        quint32 size;
+        stream >> m_tiles[n].index >> size;
+        m_tiles[n].offset = int(totalSize);
+        m_tiles[n].size = int(size);
+        totalSize += size;
+    }
+    if (stream.status() != QDataStream::Ok || totalSize > std::numeric_limits<int>::max()) {
+        m_tiles.clear();
+        return false;
+    }
+
+    // one allocation for all tiles, rather than one per tile
+    m_tileData.resize(int(totalSize));
+    if (stream.readRawData(m_tileData.data(), m_tileData.size()) != m_tileData.size()) {
+        m_tiles.clear();
+        m_tileData.clear();
+        return false;
+    }
+    return true;
 }
 
 QDataStream &operator<<(QDataStream &stream, const GammaRay::TransferImage &image)
 {
-    static const TransferImage::Format format = TransferImage::RawFormat;
+    static const TransferImage::Format format = TransferImage::TiledFormat;
 
     const QImage &img = image.image();
     stream << (quint32)(format);
@@ -70,6 +424,63 @@ QDataStream &operator<<(QDataStream &stream, const GammaRay::TransferImage &imag
         for (int i = 0; i < img.height(); ++i)
             stream.device()->write((const char *)img.scanLine(i), img.bytesPerLine());
         break;
+    case TransferImage::TiledFormat:
+    {
+        const QImage tiled = transferableImage(img);
+        const QImage previous = transferableImage(image.m_previousImage);
+        const bool delta = !previous.isNull() && previous.size() == tiled.size()
+                           && previous.format() == tiled.format();
+        const TileGrid grid(tiled.size(), DefaultTileSize);
+        const PixelBuffer pixels(tiled.constBits(), tiled);
+        const TransferImage::TileCodec codec = image.m_codec;
+
+        // comparing is bound by memory bandwidth, so there is little to gain from more threads
+        QVector<quint32> tiles;
+        tiles.reserve(grid.count());
+        const PixelBuffer previousPixels(previous.constBits(), previous);
+        for (int i = 0; i < grid.count(); ++i) {
+            if (!delta || tileChanged(pixels, previousPixels, grid.rect(i)))
+                tiles.push_back(i);
+        }
+
+        QVector<QByteArray> encoded;
+        if (codec != TransferImage::RawCodec) {
+            encoded.resize(tiles.size());
+            QByteArray *encodedData = encoded.data();
+            const quint32 *tileData = tiles.constData();
+            forEachTile(tiles.size(), [&](int i) {
+                encodedData[i] = encodeTile(pixels, grid.rect(tileData[i]), codec);
+            });
+        }
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+        stream << (double)tiled.devicePixelRatio();
+#else
+        stream << 1.0;
+#endif
+        stream << (quint32)tiled.format() << (quint32)tiled.width() << (quint32)tiled.height()
+               << (quint32)DefaultTileSize << (quint32)codec << delta << (quint32)tiles.size();
+        // all sizes first, so the receiver can read all tile data in one go
+        for (int i = 0; i < tiles.size(); ++i) {
+            const int size = encoded.isEmpty() ? rawTileSize(pixels, grid.rect(tiles.at(i)))
+                                               : encoded.at(i).size();
+            stream << tiles.at(i) << (quint32)size;
+        }
+        for (int i = 0; i < tiles.size(); ++i) {
+            if (!encoded.isEmpty()) {
+                stream.writeRawData(encoded.at(i).constData(), encoded.at(i).size());
+                continue;
+            }
+            // uncompressed tiles are written straight from the image
+            const QRect rect = grid.rect(tiles.at(i));
+            const int offset = rect.x() * pixels.bytesPerPixel;
+            const int length = rect.width() * pixels.bytesPerPixel;
+            for (int y = rect.top(); y <= rect.bottom(); ++y)
+                stream.writeRawData(reinterpret_cast<const char *>(pixels.line(y)) + offset,
+                                    length);
+        }
+        break;
+    }
     }
 
     return stream;
@@ -98,9 +509,61 @@ QDataStream &operator>>(QDataStream &stream, TransferImage &image)
 #if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
         img.setDevicePixelRatio(r);
 #endif
-        for (int i = 0; i < img.height(); ++i) {
-            const QByteArray buffer = stream.device()->read(img.bytesPerLine());
-            memcpy(img.scanLine(i), buffer.constData(), img.bytesPerLine());
+        for (int i = 0; i < img.height(); ++i)
+            stream.readRawData(reinterpret_cast<char *>(img.scanLine(i)), img.bytesPerLine());
+        image.setImage(img);
+        break;
+    }
+    case TransferImage::TiledFormat:
+    {
+        double r;
+        quint32 f, w, h, tileSize, codec, count;
+        bool delta;
+        stream >> r >> f >> w >> h >> tileSize >> codec >> delta >> count;
+        image.setImage(QImage());
+        image.setTileCodec(static_cast<TransferImage::TileCodec>(codec));
+
+        if (delta) {
+            // we don't have the previous image here, keep the tiles until applyDelta()
+            if (!image.readTiles(stream, count))
+                break;
+            image.m_isDelta = true;
+            image.m_deltaSize = QSize(w, h);
+            image.m_deltaFormat = static_cast<QImage::Format>(f);
+            image.m_deltaRatio = r;
+            image.m_deltaTileSize = tileSize;
+            break;
+        }
+
+        QImage img(w, h, static_cast<QImage::Format>(f));
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+        img.setDevicePixelRatio(r);
+#endif
+        if (image.tileCodec() == TransferImage::RawCodec && !img.isNull()) {
+            // read uncompressed tiles straight into the image memory
+            const TileGrid grid(img.size(), tileSize);
+            const PixelBuffer pixels(img.bits(), img);
+            QVector<QPair<QRect, int> > tiles;
+            tiles.reserve(count);
+            for (quint32 n = 0; n < count; ++n) {
+                quint32 index, size;
+                stream >> index >> size;
+                const QRect rect = index < quint32(grid.count()) ? grid.rect(index) : QRect();
+                tiles.push_back(qMakePair(rect, int(size)));
+            }
+            for (int n = 0; n < tiles.size(); ++n) {
+                const QRect &rect = tiles.at(n).first;
+                if (rect.isEmpty() || tiles.at(n).second != rawTileSize(pixels, rect)) {
+                    stream.skipRawData(tiles.at(n).second);
+                    continue;
+                }
+                const int offset = rect.x() * pixels.bytesPerPixel;
+                const int length = rect.width() * pixels.bytesPerPixel;
+                for (int y = rect.top(); y <= rect.bottom(); ++y)
+                    stream.readRawData(reinterpret_cast<char *>(pixels.line(y)) + offset, length);
+            }
+        } else if (image.readTiles(stream, count)) {
+            image.decodeTiles(img, tileSize);
         }
         image.setImage(img);
         break;
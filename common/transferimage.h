@@ -32,9 +32,18 @@
 #include <QDataStream>
 #include <QImage>
 #include <QVariant>
+#include <QVector>
 
 namespace GammaRay {
-/** Wrapper class for a QImage to allow raw data transfer over a QDataStream, bypassing the usuale PNG encoding. */
+/** Wrapper class for a QImage to allow raw data transfer over a QDataStream, bypassing the usuale PNG encoding.
+ *
+ * The image is transferred in tiles, and if the receiver is known to have the previously
+ * transferred image already, only the tiles that changed since then are sent. The receiver
+ * then composites those onto its copy of the previous image, see applyDelta().
+ *
+ * Comparing, encoding and decoding the tiles is spread over a thread pool for the
+ * compressing codecs, uncompressed tiles are read straight into the image memory.
+ */
 class TransferImage
 {
 public:
@@ -46,11 +55,58 @@ public:
 
     enum Format {
         QImageFormat,
-        RawFormat
+        RawFormat,
+        TiledFormat
     };
 
+    /** Encoding of the individual tiles. */
+    enum TileCodec {
+        RawCodec, ///< uncompressed pixel data
+        Lz4Codec, ///< lossless, cheap enough for frequent updates
+        PngCodec, ///< lossless, slower but smaller than Lz4Codec
+        JpegCodec ///< lossy, for slow remote connections
+    };
+    TileCodec tileCodec() const;
+    void setTileCodec(TileCodec codec);
+
+    /** Sender side, only transfer the tiles that differ from @p image.
+     *  Only use this if the receiver got @p image in the previous transfer.
+     */
+    void setPreviousImage(const QImage &image);
+
+    /** Receiver side, @c true if only the tiles changed since the previous image
+     *  have been received, image() is null until applyDelta() has been called then.
+     */
+    bool isDelta() const;
+    /** Composites the received tiles onto the image of @p previous, which is taken over.
+     *  Returns @c false and leaves @p previous untouched if the tiles don't fit onto it.
+     */
+    bool applyDelta(TransferImage &previous);
+
 private:
+    friend QDataStream &operator<<(QDataStream &stream, const TransferImage &image);
+    friend QDataStream &operator>>(QDataStream &stream, TransferImage &image);
+    bool readTiles(QDataStream &stream, quint32 count);
+    void decodeTiles(QImage &image, int tileSize);
+
+    struct Tile
+    {
+        quint32 index;
+        int offset; // into m_tileData
+        int size;
+    };
+
     QImage m_image;
+    QImage m_previousImage;
+    TileCodec m_codec;
+    // received tiles of a delta, until it is applied
+    QVector<Tile> m_tiles;
+    QByteArray m_tileData;
+    QSize m_deltaSize;
+    QImage::Format m_deltaFormat;
+    double m_deltaRatio;
+    int m_deltaTileSize;
+    bool m_isDelta;
 };
 
 QDataStream &operator<<(QDataStream &stream, const GammaRay::TransferImage &image);
@@ -0,0 +1,275 @@
+/*
+  chunkedsortedvector.h
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GAMMARAY_CHUNKEDSORTEDVECTOR_H
+#define GAMMARAY_CHUNKEDSORTEDVECTOR_H
+
+#include <QVector>
+
+#include <algorithm>
+
+namespace GammaRay {
+/** Sorted sequence of unique pointers, addressable by row, for large item models.
+ *
+ * Entries are kept in a list of sorted chunks of at most MaximumChunkSize pointers,
+ * so inserting or removing an entry only shifts the rest of its chunk rather than
+ * the entire sequence. The chunk sizes are indexed by a Fenwick tree, which turns
+ * row lookups in both directions into logarithmic operations. That tree only needs
+ * to be rebuilt when chunks are split, merged or dropped.
+ *
+ * Like QVector, this is implicitly shared, copying it is cheap.
+ */
+template<typename T>
+class ChunkedSortedVector
+{
+public:
+    ChunkedSortedVector()
+        : m_size(0)
+    {
+    }
+
+    int size() const
+    {
+        return m_size;
+    }
+
+    bool isEmpty() const
+    {
+        return m_size == 0;
+    }
+
+    void clear()
+    {
+        m_chunks.clear();
+        m_rowIndex.clear();
+        m_size = 0;
+    }
+
+    T *at(int row) const
+    {
+        Q_ASSERT(row >= 0 && row < m_size);
+        int chunk;
+        const int offset = locateRow(row, chunk);
+        return m_chunks.at(chunk).at(offset);
+    }
+
+    /** Returns the row @p ptr has, or would have if it got inserted. */
+    int lowerBound(const T *ptr) const
+    {
+        if (m_chunks.isEmpty())
+            return 0;
+        const int chunk = chunkForKey(ptr);
+        const QVector<T *> &entries = m_chunks.at(chunk);
+        const int offset = std::distance(entries.constBegin(),
+                                         std::lower_bound(entries.constBegin(),
+                                                          entries.constEnd(), ptr));
+        return rowsBefore(chunk) + offset;
+    }
+
+    /** Returns the row of @p ptr, or -1 if it is not contained. */
+    int indexOf(const T *ptr) const
+    {
+        const int row = lowerBound(ptr);
+        if (row < m_size && at(row) == ptr)
+            return row;
+        return -1;
+    }
+
+    bool contains(const T *ptr) const
+    {
+        return indexOf(ptr) >= 0;
+    }
+
+    /** Inserts @p ptr and returns its row, or -1 if it was contained already. */
+    int insert(T *ptr)
+    {
+        if (m_chunks.isEmpty()) {
+            m_chunks.push_back(QVector<T *>() << ptr);
+            m_rowIndex.push_back(1);
+            m_size = 1;
+            return 0;
+        }
+
+        const int chunk = chunkForKey(ptr);
+        QVector<T *> &entries = m_chunks[chunk];
+        typename QVector<T *>::iterator it = std::lower_bound(entries.begin(), entries.end(), ptr);
+        if (it != entries.end() && *it == ptr)
+            return -1;
+        const int row = rowsBefore(chunk) + std::distance(entries.begin(), it);
+
+        entries.insert(it, ptr);
+        ++m_size;
+        if (entries.size() > MaximumChunkSize) {
+            splitChunk(chunk);
+            rebuildRowIndex();
+        } else {
+            addToRowIndex(chunk, 1);
+        }
+        return row;
+    }
+
+    /** Removes @p count entries starting at @p row. */
+    void remove(int row, int count = 1)
+    {
+        Q_ASSERT(row >= 0 && count >= 0 && row + count <= m_size);
+        while (count > 0) {
+            int chunk;
+            const int offset = locateRow(row, chunk);
+            QVector<T *> &entries = m_chunks[chunk];
+            const int n = std::min(count, entries.size() - offset);
+            entries.remove(offset, n);
+            m_size -= n;
+            count -= n;
+
+            if (m_size == 0) {
+                clear();
+            } else if (entries.size() < MaximumChunkSize / 4 && m_chunks.size() > 1) {
+                mergeChunk(chunk);
+                rebuildRowIndex();
+            } else {
+                addToRowIndex(chunk, -n);
+            }
+        }
+    }
+
+    /** Returns @c true if @p ptr was contained. */
+    bool remove(const T *ptr)
+    {
+        const int row = indexOf(ptr);
+        if (row < 0)
+            return false;
+        remove(row);
+        return true;
+    }
+
+    QVector<T *> toVector() const
+    {
+        QVector<T *> result;
+        result.reserve(m_size);
+        foreach (const QVector<T *> &entries, m_chunks)
+            result += entries;
+        return result;
+    }
+
+private:
+    enum {
+        // 2kB of pointers on 64bit, small enough for cheap shifting within a chunk
+        MaximumChunkSize = 256
+    };
+
+    // index of the last chunk whose first entry is not greater than ptr, 0 if there is none
+    int chunkForKey(const T *ptr) const
+    {
+        int first = 0;
+        int count = m_chunks.size();
+        while (count > 0) {
+            const int step = count / 2;
+            if (m_chunks.at(first + step).first() <= ptr) {
+                first += step + 1;
+                count -= step + 1;
+            } else {
+                count = step;
+            }
+        }
+        return std::max(0, first - 1);
+    }
+
+    // m_rowIndex is a Fenwick tree over the chunk sizes
+    int rowsBefore(int chunk) const
+    {
+        int rows = 0;
+        for (; chunk > 0; chunk -= chunk & -chunk)
+            rows += m_rowIndex.at(chunk - 1);
+        return rows;
+    }
+
+    void addToRowIndex(int chunk, int delta)
+    {
+        for (++chunk; chunk <= m_rowIndex.size(); chunk += chunk & -chunk)
+            m_rowIndex[chunk - 1] += delta;
+    }
+
+    // returns the offset of row within the chunk it is stored in
+    int locateRow(int row, int &chunk) const
+    {
+        const int chunkCount = m_rowIndex.size();
+        int bit = 1;
+        while (bit * 2 <= chunkCount)
+            bit *= 2;
+
+        chunk = 0;
+        for (; bit > 0; bit /= 2) {
+            const int next = chunk + bit;
+            if (next <= chunkCount && m_rowIndex.at(next - 1) <= row) {
+                chunk = next;
+                row -= m_rowIndex.at(next - 1);
+            }
+        }
+        return row;
+    }
+
+    void rebuildRowIndex()
+    {
+        const int chunkCount = m_chunks.size();
+        m_rowIndex.resize(chunkCount);
+        for (int i = 0; i < chunkCount; ++i)
+            m_rowIndex[i] = m_chunks.at(i).size();
+        for (int i = 1; i <= chunkCount; ++i) {
+            const int parent = i + (i & -i);
+            if (parent <= chunkCount)
+                m_rowIndex[parent - 1] += m_rowIndex.at(i - 1);
+        }
+    }
+
+    // callers need to rebuild the row index afterwards
+    void splitChunk(int chunk)
+    {
+        QVector<T *> &entries = m_chunks[chunk];
+        const int half = entries.size() / 2;
+        const QVector<T *> upper = entries.mid(half);
+        entries.resize(half);
+        m_chunks.insert(chunk + 1, upper);
+    }
+
+    // merges an underfull chunk with a neighbor, splitting again if that got too large
+    void mergeChunk(int chunk)
+    {
+        if (chunk == m_chunks.size() - 1)
+            --chunk;
+        m_chunks[chunk] += m_chunks.at(chunk + 1);
+        m_chunks.remove(chunk + 1);
+        if (m_chunks.at(chunk).size() > MaximumChunkSize)
+            splitChunk(chunk);
+    }
+
+    QVector<QVector<T *> > m_chunks;
+    QVector<int> m_rowIndex;
+    int m_size;
+};
+}
+
+#endif // GAMMARAY_CHUNKEDSORTEDVECTOR_H
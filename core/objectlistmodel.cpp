@@ -42,10 +42,10 @@ using namespace std;
 ObjectListModel::ObjectListModel(Probe *probe)
     : ObjectModelBase< QAbstractTableModel >(probe)
 {
-    connect(probe, SIGNAL(objectCreated(QObject*)),
-            this, SLOT(objectAdded(QObject*)));
-    connect(probe, SIGNAL(objectDestroyed(QObject*)),
-            this, SLOT(objectRemoved(QObject*)));
+    connect(probe, SIGNAL(objectsCreated(QVector<QObject*>)),
+            this, SLOT(objectsAdded(QVector<QObject*>)));
+    connect(probe, SIGNAL(objectsDestroyed(QVector<QObject*>)),
+            this, SLOT(objectsRemoved(QVector<QObject*>)));
 }
 
 QPair<int, QVariant> ObjectListModel::defaultSelectedItem() const
@@ -80,40 +80,68 @@ int ObjectListModel::rowCount(const QModelIndex &parent) const
     return m_objects.size();
 }
 
-void ObjectListModel::objectAdded(QObject *obj)
+void ObjectListModel::objectsAdded(const QVector<QObject *> &objs)
 {
-    // see Probe::objectCreated, that promises a valid object in the main thread
+    // see Probe::objectCreated, that promises valid objects in the main thread
     Q_ASSERT(QThread::currentThread() == thread());
-    Q_ASSERT(obj);
-    Q_ASSERT(Probe::instance()->isValidObject(obj));
 
-    QVector<QObject *>::iterator it = std::lower_bound(m_objects.begin(), m_objects.end(), obj);
-    Q_ASSERT(it == m_objects.end() || *it != obj);
-
-    const int row = std::distance(m_objects.begin(), it);
-    Q_ASSERT(row >= 0 && row <= m_objects.size());
-
-    beginInsertRows(QModelIndex(), row, row);
-    m_objects.insert(it, obj);
-    Q_ASSERT(m_objects.at(row) == obj);
-    endInsertRows();
+    QVector<QObject *> newObjects(objs);
+    std::sort(newObjects.begin(), newObjects.end());
+    newObjects.erase(std::unique(newObjects.begin(), newObjects.end()), newObjects.end());
+
+    // all new objects sharing an insertion point are inserted as one row range
+    for (int i = 0; i < newObjects.size();) {
+        QObject *obj = newObjects.at(i);
+        Q_ASSERT(obj);
+        Q_ASSERT(Probe::instance()->isValidObject(obj));
+
+        const int row = m_objects.lowerBound(obj);
+        if (row < m_objects.size() && m_objects.at(row) == obj) {
+            ++i;
+            continue;
+        }
+
+        int count = newObjects.size() - i;
+        if (row < m_objects.size()) {
+            count = std::distance(newObjects.constBegin() + i,
+                                  std::lower_bound(newObjects.constBegin() + i, newObjects.constEnd(),
+                                                   m_objects.at(row)));
+        }
+
+        beginInsertRows(QModelIndex(), row, row + count - 1);
+        for (int j = i; j < i + count; ++j)
+            m_objects.insert(newObjects.at(j));
+        endInsertRows();
+
+        i += count;
+    }
 }
 
-void ObjectListModel::objectRemoved(QObject *obj)
+void ObjectListModel::objectsRemoved(const QVector<QObject *> &objs)
 {
     Q_ASSERT(thread() == QThread::currentThread());
 
-    QVector<QObject *>::iterator it = std::lower_bound(m_objects.begin(), m_objects.end(), obj);
-    if (it == m_objects.end() || *it != obj) {
-        // not found
-        return;
+    QVector<int> rows;
+    rows.reserve(objs.size());
+    foreach (QObject *obj, objs) {
+        const int row = m_objects.indexOf(obj);
+        if (row >= 0)
+            rows.push_back(row);
     }
+    std::sort(rows.begin(), rows.end());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
 
-    const int row = std::distance(m_objects.begin(), it);
-    Q_ASSERT(row >= 0 && row < m_objects.size());
-    Q_ASSERT(m_objects.at(row) == obj);
+    // remove contiguous row ranges back to front, that keeps the rows in front of them valid
+    int last = rows.size() - 1;
+    while (last >= 0) {
+        int first = last;
+        while (first > 0 && rows.at(first - 1) == rows.at(first) - 1)
+            --first;
 
-    beginRemoveRows(QModelIndex(), row, row);
-    m_objects.erase(it);
-    endRemoveRows();
+        beginRemoveRows(QModelIndex(), rows.at(first), rows.at(last));
+        m_objects.remove(rows.at(first), last - first + 1);
+        endRemoveRows();
+
+        last = first - 1;
+    }
 }
@@ -29,6 +29,7 @@
 #ifndef GAMMARAY_OBJECTLISTMODEL_H
 #define GAMMARAY_OBJECTLISTMODEL_H
 
+#include "chunkedsortedvector.h"
 #include "objectmodelbase.h"
 
 #include <QMutex>
@@ -62,14 +63,12 @@ public slots:
     QPair<int, QVariant> defaultSelectedItem() const;
 
 private slots:
-    void objectAdded(QObject *obj);
-    void objectRemoved(QObject *obj);
+    void objectsAdded(const QVector<QObject *> &objs);
+    void objectsRemoved(const QVector<QObject *> &objs);
 
 private:
-    void removeObject(QObject *obj);
-
-    // sorted vector for stable iterators/indexes, esp. for the model methods
-    QVector<QObject *> m_objects;
+    // sorted for stable indexes, esp. for the model methods
+    ChunkedSortedVector<QObject> m_objects;
 };
 }
 
@@ -48,10 +48,10 @@ using namespace GammaRay;
 ObjectTreeModel::ObjectTreeModel(Probe *probe)
     : ObjectModelBase< QAbstractItemModel >(probe)
 {
-    connect(probe, SIGNAL(objectCreated(QObject*)),
-            this, SLOT(objectAdded(QObject*)));
-    connect(probe, SIGNAL(objectDestroyed(QObject*)),
-            this, SLOT(objectRemoved(QObject*)));
+    connect(probe, SIGNAL(objectsCreated(QVector<QObject*>)),
+            this, SLOT(objectsAdded(QVector<QObject*>)));
+    connect(probe, SIGNAL(objectsDestroyed(QVector<QObject*>)),
+            this, SLOT(objectsRemoved(QVector<QObject*>)));
     connect(probe, SIGNAL(objectReparented(QObject*)),
             this, SLOT(objectReparented(QObject*)));
 }
@@ -67,6 +67,134 @@ static inline QObject *parentObject(QObject *obj)
     return obj->parent();
 }
 
+void ObjectTreeModel::objectsAdded(const QVector<QObject *> &objs)
+{
+    // see Probe::objectCreated, that promises valid objects in the main thread here
+    Q_ASSERT(thread() == QThread::currentThread());
+
+    // group by parent, so every sibling vector is merged only once per batch
+    QHash<QObject *, QVector<QObject *> > newChildren;
+    foreach (QObject *obj, objs) {
+        Q_ASSERT(Probe::instance()->isValidObject(obj));
+        if (!m_childParentMap.contains(obj))
+            newChildren[parentObject(obj)].push_back(obj);
+    }
+
+    while (!newChildren.isEmpty())
+        insertChildren(newChildren, newChildren.constBegin().key());
+}
+
+void ObjectTreeModel::objectsRemoved(const QVector<QObject *> &objs)
+{
+    // slot, hence should always land in main thread due to auto connection
+    Q_ASSERT(thread() == QThread::currentThread());
+
+    QHash<QObject *, QVector<QObject *> > removedChildren;
+    foreach (QObject *obj, objs) {
+        QHash<QObject *, QObject *>::const_iterator it = m_childParentMap.constFind(obj);
+        if (it != m_childParentMap.constEnd())
+            removedChildren[it.value()].push_back(obj);
+    }
+
+    for (QHash<QObject *, QVector<QObject *> >::const_iterator it = removedChildren.constBegin();
+         it != removedChildren.constEnd(); ++it)
+        removeChildren(it.key(), it.value());
+}
+
+void ObjectTreeModel::insertChildren(QHash<QObject *, QVector<QObject *> > &newChildren,
+                                     QObject *parent)
+{
+    QVector<QObject *> children = newChildren.take(parent);
+
+    // the parent has to be known first, it might be part of this very batch
+    // or, as in objectAdded(), show up only later
+    if (parent && !m_childParentMap.contains(parent)) {
+        if (newChildren.contains(parentObject(parent)))
+            insertChildren(newChildren, parentObject(parent));
+        if (!m_childParentMap.contains(parent))
+            objectAdded(parent);
+    }
+
+    const QModelIndex parentIndex = indexForObject(parent);
+    Q_ASSERT(parentIndex.isValid() || !parent);
+
+    std::sort(children.begin(), children.end());
+    children.erase(std::unique(children.begin(), children.end()), children.end());
+
+    // same row range merging as in ObjectListModel::objectsAdded()
+    ChildList &siblings = m_parentChildMap[parent];
+    for (int i = 0; i < children.size();) {
+        QObject *obj = children.at(i);
+        // might have been added as the parent of another object meanwhile
+        if (m_childParentMap.contains(obj)) {
+            ++i;
+            continue;
+        }
+
+        const int row = siblings.lowerBound(obj);
+        const QObject *next = row < siblings.size() ? siblings.at(row) : 0;
+        int count = 1;
+        while (i + count < children.size() && (!next || children.at(i + count) < next)
+               && !m_childParentMap.contains(children.at(i + count)))
+            ++count;
+
+        beginInsertRows(parentIndex, row, row + count - 1);
+        for (int j = i; j < i + count; ++j) {
+            siblings.insert(children.at(j));
+            m_childParentMap.insert(children.at(j), parent);
+        }
+        endInsertRows();
+
+        i += count;
+    }
+}
+
+void ObjectTreeModel::removeChildren(QObject *parentObj, const QVector<QObject *> &children)
+{
+    const QModelIndex parentIndex = indexForObject(parentObj);
+    // cppcheck-suppress nullPointerRedundantCheck
+    if (parentObj && !parentIndex.isValid())
+        return;
+
+    QVector<int> rows;
+    rows.reserve(children.size());
+    {
+        // scoped, so the removal below does not need to detach from this copy
+        const ChildList siblings = m_parentChildMap.value(parentObj);
+        foreach (QObject *obj, children) {
+            const int row = siblings.indexOf(obj);
+            if (row >= 0)
+                rows.push_back(row);
+        }
+    }
+    std::sort(rows.begin(), rows.end());
+
+    // remove contiguous row ranges back to front, that keeps the rows in front of them valid
+    int last = rows.size() - 1;
+    while (last >= 0) {
+        int first = last;
+        while (first > 0 && rows.at(first - 1) == rows.at(first) - 1)
+            --first;
+        const int count = last - first + 1;
+
+        beginRemoveRows(parentIndex, rows.at(first), rows.at(last));
+        // look up again every time, removing from m_parentChildMap can rehash it
+        ChildList &siblings = m_parentChildMap[parentObj];
+        QVector<QObject *> removed;
+        removed.reserve(count);
+        for (int row = rows.at(first); row <= rows.at(last); ++row)
+            removed.push_back(siblings.at(row));
+        siblings.remove(rows.at(first), count);
+        foreach (QObject *obj, removed) {
+            m_childParentMap.remove(obj);
+            purgeDescendants(obj);
+        }
+        endRemoveRows();
+
+        last = first - 1;
+    }
+}
+
 void ObjectTreeModel::objectAdded(QObject *obj)
 {
     // see Probe::objectCreated, that promises a valid object in the main thread here
@@ -102,13 +230,12 @@ void ObjectTreeModel::objectAdded(QObject *obj)
     // either we get a proper parent and hence valid index or there is no parent
     Q_ASSERT(index.isValid() || !parentObject(obj));
 
-    QVector<QObject *> &children = m_parentChildMap[ parentObject(obj) ];
-    QVector<QObject *>::iterator it = std::lower_bound(children.begin(), children.end(), obj);
-    const int row = std::distance(children.begin(), it);
+    ChildList &children = m_parentChildMap[ parentObject(obj) ];
+    const int row = children.lowerBound(obj);
 
     beginInsertRows(index, row, row);
 
-    children.insert(it, obj);
+    children.insert(obj);
     m_childParentMap.insert(obj, parentObject(obj));
 
     endInsertRows();
@@ -138,22 +265,36 @@ void ObjectTreeModel::objectRemoved(QObject *obj)
     if (parentObj && !parentIndex.isValid())
         return;
 
-    QVector<QObject *> &siblings = m_parentChildMap[ parentObj ];
+    ChildList &siblings = m_parentChildMap[ parentObj ];
 
-    QVector<QObject *>::iterator it = std::lower_bound(siblings.begin(), siblings.end(), obj);
-    if (it == siblings.end() || *it != obj)
+    const int row = siblings.indexOf(obj);
+    if (row < 0)
         return;
-    const int row = std::distance(siblings.begin(), it);
 
     beginRemoveRows(parentIndex, row, row);
 
-    siblings.erase(it);
+    siblings.remove(row);
     m_childParentMap.remove(obj);
-    m_parentChildMap.remove(obj);
+    purgeDescendants(obj);
 
     endRemoveRows();
 }
 
+// the rows of all descendants vanish along with the one of obj, so forget about them as well,
+// otherwise a removal batch handling a parent before its children would leave those behind
+void ObjectTreeModel::purgeDescendants(QObject *obj)
+{
+    const auto it = m_parentChildMap.find(obj);
+    if (it == m_parentChildMap.end())
+        return;
+    const QVector<QObject *> children = it.value().toVector();
+    m_parentChildMap.erase(it);
+    foreach (QObject *child, children) {
+        m_childParentMap.remove(child);
+        purgeDescendants(child);
+    }
+}
+
 void ObjectTreeModel::objectReparented(QObject *obj)
 {
     // slot, hence should always land in main thread due to auto connection
@@ -180,12 +321,9 @@ void ObjectTreeModel::objectReparented(QObject *obj)
     if ((oldParent && !sourceParent.isValid()) || (oldParent == parentObject(obj)))
         return;
 
-    QVector<QObject *> &oldSiblings = m_parentChildMap[oldParent];
-    QVector<QObject *>::iterator oldIt = std::lower_bound(oldSiblings.begin(),
-                                                          oldSiblings.end(), obj);
-    if (oldIt == oldSiblings.end() || *oldIt != obj)
+    const int sourceRow = m_parentChildMap.value(oldParent).indexOf(obj);
+    if (sourceRow < 0)
         return;
-    const int sourceRow = std::distance(oldSiblings.begin(), oldIt);
 
     IF_DEBUG(cout << "actually reparenting! " << hex << obj << " old parent: " << oldParent << " new parent: " << parentObject(
                  obj) << dec << endl;
@@ -193,14 +331,11 @@ void ObjectTreeModel::objectReparented(QObject *obj)
     const auto destParent = indexForObject(parentObject(obj));
     Q_ASSERT(destParent.isValid() || !parentObject(obj));
 
-    QVector<QObject *> &newSiblings = m_parentChildMap[parentObject(obj)];
-    QVector<QObject *>::iterator newIt = std::lower_bound(newSiblings.begin(),
-                                                          newSiblings.end(), obj);
-    const int destRow = std::distance(newSiblings.begin(), newIt);
+    const int destRow = m_parentChildMap.value(parentObject(obj)).lowerBound(obj);
 
     beginMoveRows(sourceParent, sourceRow, sourceRow, destParent, destRow);
-    oldSiblings.erase(oldIt);
-    newSiblings.insert(newIt, obj);
+    m_parentChildMap[oldParent].remove(sourceRow);
+    m_parentChildMap[parentObject(obj)].insert(obj);
     m_childParentMap.insert(obj, parentObject(obj));
     endMoveRows();
 }
@@ -242,7 +377,7 @@ QModelIndex ObjectTreeModel::parent(const QModelIndex &child) const
 QModelIndex ObjectTreeModel::index(int row, int column, const QModelIndex &parent) const
 {
     QObject *parentObj = reinterpret_cast<QObject *>(parent.internalPointer());
-    const QVector<QObject *> children = m_parentChildMap.value(parentObj);
+    const ChildList children = m_parentChildMap.value(parentObj);
     if (row < 0 || column < 0 || row >= children.size() || column >= columnCount())
         return QModelIndex();
     return createIndex(row, column, children.at(row));
@@ -256,12 +391,9 @@ QModelIndex ObjectTreeModel::indexForObject(QObject *object) const
     const QModelIndex parentIndex = indexForObject(parent);
     if (!parentIndex.isValid() && parent)
         return QModelIndex();
-    const QVector<QObject *> &siblings = m_parentChildMap[ parent ];
-    QVector<QObject *>::const_iterator it = std::lower_bound(
-        siblings.constBegin(), siblings.constEnd(), object);
-    if (it == siblings.constEnd() || *it != object)
+    const int row = m_parentChildMap.value(parent).indexOf(object);
+    if (row < 0)
         return QModelIndex();
 
-    const int row = std::distance(siblings.constBegin(), it);
     return index(row, 0, parentIndex);
 }
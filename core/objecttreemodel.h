@@ -29,6 +29,7 @@
 #ifndef GAMMARAY_OBJECTTREEMODEL_H
 #define GAMMARAY_OBJECTTREEMODEL_H
 
+#include "chunkedsortedvector.h"
 #include "objectmodelbase.h"
 
 #include <QVector>
@@ -52,16 +53,22 @@ public slots:
     QPair<int, QVariant> defaultSelectedItem() const;
 
 private slots:
-    void objectAdded(QObject *obj);
-    void objectRemoved(QObject *obj);
+    void objectsAdded(const QVector<QObject *> &objs);
+    void objectsRemoved(const QVector<QObject *> &objs);
     void objectReparented(QObject *obj);
 
 private:
+    void objectAdded(QObject *obj);
+    void objectRemoved(QObject *obj);
+    void insertChildren(QHash<QObject *, QVector<QObject *> > &newChildren, QObject *parent);
+    void removeChildren(QObject *parentObj, const QVector<QObject *> &children);
+    void purgeDescendants(QObject *obj);
     QModelIndex indexForObject(QObject *object) const;
 
 private:
+    typedef ChunkedSortedVector<QObject> ChildList;
     QHash<QObject *, QObject *> m_childParentMap;
-    QHash<QObject *, QVector<QObject *> > m_parentChildMap;
+    QHash<QObject *, ChildList> m_parentChildMap;
 };
 }
 
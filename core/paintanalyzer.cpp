@@ -30,25 +30,74 @@
 
 #include "paintanalyzer.h"
 #include "paintbuffermodel.h"
+#include "paintbufferreplay.h"
 
 #include <core/probe.h>
+#include <core/probesettings.h>
 #include <core/remoteviewserver.h>
 
 #include <common/objectbroker.h>
 #include <common/remoteviewframe.h>
 
 #include <QItemSelectionModel>
+#include <QRunnable>
+#include <QThreadPool>
 
 using namespace GammaRay;
 
+#ifdef HAVE_PRIVATE_QT_HEADERS
+namespace GammaRay {
+class PaintReplayJob : public QRunnable
+{
+public:
+    PaintReplayJob(PaintAnalyzer *analyzer, PaintBufferReplay *replay, int end, int generation)
+        : m_analyzer(analyzer)
+        , m_replay(replay)
+        , m_end(end)
+        , m_generation(generation)
+    {
+    }
+
+    void run() Q_DECL_OVERRIDE
+    {
+        const QImage image = m_replay->render(m_end);
+        QMetaObject::invokeMethod(m_analyzer, "replayFinished", Qt::QueuedConnection,
+                                  Q_ARG(QImage, image), Q_ARG(int, m_generation));
+    }
+
+private:
+    PaintAnalyzer *m_analyzer;
+    PaintBufferReplay *m_replay;
+    int m_end;
+    int m_generation;
+};
+}
+#endif
+
 PaintAnalyzer::PaintAnalyzer(const QString &name, QObject *parent)
     : PaintAnalyzerInterface(name, parent)
     , m_paintBufferModel(Q_NULLPTR)
     , m_selectionModel(Q_NULLPTR)
     , m_paintBuffer(Q_NULLPTR)
     , m_remoteView(new RemoteViewServer(name + QStringLiteral(".remoteView"), this))
+    , m_replay(Q_NULLPTR)
+    , m_replayPool(Q_NULLPTR)
+    , m_replayGeneration(0)
+    , m_pendingReplayEnd(-1)
+    , m_replayRunning(false)
 {
 #ifdef HAVE_PRIVATE_QT_HEADERS
+    m_replay = new PaintBufferReplay;
+    m_replay->setCheckpointInterval(ProbeSettings::value(QStringLiteral(
+                                                             "PaintAnalyzerCheckpointInterval"),
+                                                         256).toInt());
+    m_replay->setCacheSize(ProbeSettings::value(QStringLiteral("PaintAnalyzerCheckpointCacheSize"),
+                                                64).toInt() * 1024 * 1024);
+    if (ProbeSettings::value(QStringLiteral("PaintAnalyzerThreadedReplay"), false).toBool()) {
+        m_replayPool = new QThreadPool(this);
+        m_replayPool->setMaxThreadCount(1);
+    }
+
     m_paintBufferModel = new PaintBufferModel(this);
     Probe::instance()->registerModel(name + QStringLiteral(".paintBufferModel"),
                                      m_paintBufferModel);
@@ -63,6 +112,11 @@ PaintAnalyzer::PaintAnalyzer(const QString &name, QObject *parent)
 
 PaintAnalyzer::~PaintAnalyzer()
 {
+    if (m_replayPool)
+        m_replayPool->waitForDone();
+#ifdef HAVE_PRIVATE_QT_HEADERS
+    delete m_replay;
+#endif
 }
 
 void PaintAnalyzer::repaint()
@@ -71,34 +125,51 @@ void PaintAnalyzer::repaint()
         return;
 
 #ifdef HAVE_PRIVATE_QT_HEADERS
-    const QSize sourceSize = m_paintBufferModel->buffer().boundingRect().size().toSize();
-#if QT_VERSION >= QT_VERSION_CHECK(5, 6, 0)
-    const qreal ratio = m_paintBufferModel->buffer().devicePixelRatioF();
-#elif QT_VERSION >= QT_VERSION_CHECK(5, 1, 0)
-    const qreal ratio = m_paintBufferModel->buffer().devicePixelRatio();
-#else
-    const qreal ratio = 1.0;
+    // include selected row or paint all if nothing is selected
+    const auto index = m_selectionModel->currentIndex();
+    const auto end = m_paintBufferModel->buffer().frameStartIndex(0)
+                     + (index.isValid() ? index.row() + 1 : m_paintBufferModel->rowCount());
+
+    if (!m_replayPool) {
+        sendFrame(m_replay->render(end));
+        return;
+    }
+
+    // only one replay at a time, the latest request supersedes any queued one
+    m_pendingReplayEnd = end;
+    if (!m_replayRunning)
+        startReplay();
 #endif
-    QImage image(sourceSize * ratio, QImage::Format_ARGB32);
-#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
-    image.setDevicePixelRatio(ratio);
+}
+
+void PaintAnalyzer::startReplay()
+{
+#ifdef HAVE_PRIVATE_QT_HEADERS
+    Q_ASSERT(m_replayPool && !m_replayRunning && m_pendingReplayEnd >= 0);
+    m_replayRunning = true;
+    m_replayPool->start(new PaintReplayJob(this, m_replay, m_pendingReplayEnd,
+                                           m_replayGeneration));
+    m_pendingReplayEnd = -1;
 #endif
-    image.fill(Qt::transparent);
-    QPainter painter(&image);
-    const auto start = m_paintBufferModel->buffer().frameStartIndex(0);
+}
 
-    // include selected row or paint all if nothing is selected
-    const auto index = ObjectBroker::selectionModel(m_paintBufferModel)->currentIndex();
-    const auto end = index.isValid() ? index.row() + 1 : m_paintBufferModel->rowCount();
-    auto depth = m_paintBufferModel->buffer().processCommands(&painter, start, start + end);
-    for (; depth > 0; --depth)
-        painter.restore();
-    painter.end();
+void PaintAnalyzer::replayFinished(const QImage &image, int generation)
+{
+    if (generation != m_replayGeneration)
+        return; // result for a previous paint buffer
+
+    m_replayRunning = false;
+    if (m_pendingReplayEnd >= 0)
+        startReplay();
+    else if (m_remoteView->isActive())
+        sendFrame(image);
+}
 
+void PaintAnalyzer::sendFrame(const QImage &image)
+{
     RemoteViewFrame frame;
     frame.setImage(image);
     m_remoteView->sendFrame(frame);
-#endif
 }
 
 void PaintAnalyzer::beginAnalyzePainting()
@@ -134,7 +205,15 @@ void PaintAnalyzer::endAnalyzePainting()
 #ifdef HAVE_PRIVATE_QT_HEADERS
     Q_ASSERT(m_paintBuffer);
     Q_ASSERT(m_paintBufferModel);
+    if (m_replayPool) {
+        // the replay must not change underneath a running job
+        m_replayPool->waitForDone();
+        m_replayRunning = false;
+        m_pendingReplayEnd = -1;
+        ++m_replayGeneration;
+    }
     m_paintBufferModel->setPaintBuffer(*m_paintBuffer);
+    m_replay->setPaintBuffer(*m_paintBuffer);
     delete m_paintBuffer;
     m_paintBuffer = 0;
     m_remoteView->resetView();
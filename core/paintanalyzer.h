@@ -34,14 +34,17 @@
 #include <common/paintanalyzerinterface.h>
 
 QT_BEGIN_NAMESPACE
+class QImage;
 class QItemSelectionModel;
 class QPaintBuffer;
 class QPaintDevice;
 class QRectF;
+class QThreadPool;
 QT_END_NAMESPACE
 
 namespace GammaRay {
 class PaintBufferModel;
+class PaintBufferReplay;
 class RemoteViewServer;
 
 /** Inspects individual operations on a QPainter. */
@@ -64,12 +67,23 @@ public:
 
 private slots:
     void repaint();
+    void replayFinished(const QImage &image, int generation);
 
 private:
+    void startReplay();
+    void sendFrame(const QImage &image);
+
     PaintBufferModel *m_paintBufferModel;
     QItemSelectionModel *m_selectionModel;
     QPaintBuffer *m_paintBuffer;
     RemoteViewServer *m_remoteView;
+    PaintBufferReplay *m_replay;
+
+    // replaying on a worker thread, optional as drawing pixmaps there is not always safe
+    QThreadPool *m_replayPool;
+    int m_replayGeneration;
+    int m_pendingReplayEnd;
+    bool m_replayRunning;
 };
 }
 
@@ -0,0 +1,230 @@
+/*
+  paintbufferreplay.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <config-gammaray.h>
+#ifdef HAVE_PRIVATE_QT_HEADERS
+#include "paintbufferreplay.h"
+
+#include <QPainter>
+
+#include <algorithm>
+
+using namespace GammaRay;
+
+class PaintBufferReplayPrivacyViolater : public QPainterReplayer
+{
+public:
+    QPaintBufferPrivate *extract() const { return d; }
+};
+
+static bool isStateCommand(int id)
+{
+    return id <= QPaintBufferPrivate::Cmd_ClipVectorPath
+           || id == QPaintBufferPrivate::Cmd_SystemStateChanged
+           || id == QPaintBufferPrivate::Cmd_Translate;
+}
+
+PaintBufferReplay::PaintBufferReplay()
+    : m_privateBuffer(0)
+    , m_useCounter(0)
+    , m_checkpointInterval(256)
+    , m_cacheSize(64 * 1024 * 1024)
+{
+}
+
+void PaintBufferReplay::setPaintBuffer(const QPaintBuffer &buffer)
+{
+    m_buffer = buffer;
+    PaintBufferReplayPrivacyViolater p;
+    p.processCommands(buffer, 0, 0, -1); // end < begin -> no processing
+    m_privateBuffer = p.extract();
+
+    m_stateCommands.clear();
+    m_checkpoints.clear();
+    m_lastRendered = Checkpoint();
+
+    const QVector<QPaintBufferCommand> &commands = m_privateBuffer->commands;
+    for (int i = 0; i < commands.size(); ++i) {
+        if (!isStateCommand(commands.at(i).id))
+            continue;
+        if (!m_stateCommands.isEmpty() && m_stateCommands.last().second == i)
+            ++m_stateCommands.last().second;
+        else
+            m_stateCommands.push_back(qMakePair(i, i + 1));
+    }
+}
+
+int PaintBufferReplay::checkpointInterval() const
+{
+    return m_checkpointInterval;
+}
+
+void PaintBufferReplay::setCheckpointInterval(int interval)
+{
+    m_checkpointInterval = std::max(1, interval);
+    m_checkpoints.clear();
+}
+
+void PaintBufferReplay::setCacheSize(int bytes)
+{
+    m_cacheSize = bytes;
+    const int count = maximumCheckpointCount();
+    while (m_checkpoints.size() > count)
+        m_checkpoints.remove(0);
+}
+
+qreal PaintBufferReplay::devicePixelRatio() const
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 6, 0)
+    return m_buffer.devicePixelRatioF();
+#elif QT_VERSION >= QT_VERSION_CHECK(5, 1, 0)
+    return m_buffer.devicePixelRatio();
+#else
+    return 1.0;
+#endif
+}
+
+QSize PaintBufferReplay::imageSize() const
+{
+    return m_buffer.boundingRect().size().toSize() * devicePixelRatio();
+}
+
+QImage PaintBufferReplay::createImage() const
+{
+    QImage image(imageSize(), QImage::Format_ARGB32);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+    image.setDevicePixelRatio(devicePixelRatio());
+#endif
+    image.fill(Qt::transparent);
+    return image;
+}
+
+QImage PaintBufferReplay::render(int end)
+{
+    if (!m_privateBuffer)
+        return QImage();
+
+    const int start = m_buffer.frameStartIndex(0);
+    end = qBound(start, end, m_buffer.frameEndIndex(0));
+
+    // stepping through the commands one by one resumes from the previous result
+    const int cp = findCheckpoint(end);
+    QImage image;
+    int pos = start;
+    if (m_lastRendered.command >= start && m_lastRendered.command <= end
+        && (cp < 0 || m_lastRendered.command > m_checkpoints.at(cp).command)) {
+        image = m_lastRendered.image;
+        pos = m_lastRendered.command;
+    } else if (cp >= 0) {
+        m_checkpoints[cp].lastUsed = ++m_useCounter;
+        image = m_checkpoints.at(cp).image;
+        pos = m_checkpoints.at(cp).command;
+    } else {
+        image = createImage();
+    }
+    if (pos == end)
+        return image;
+
+    QPainter painter(&image);
+    int depth = restorePainterState(&painter, start, pos);
+    while (pos < end) {
+        const int nextCheckpoint = (pos - start) / m_checkpointInterval + 1;
+        const int next = std::min(end, start + nextCheckpoint * m_checkpointInterval);
+        depth += m_buffer.processCommands(&painter, pos, next);
+        pos = next;
+        if ((pos - start) % m_checkpointInterval == 0)
+            addCheckpoint(pos, image);
+    }
+    for (; depth > 0; --depth)
+        painter.restore();
+    painter.end();
+
+    m_lastRendered.command = end;
+    m_lastRendered.image = image;
+    return image;
+}
+
+int PaintBufferReplay::findCheckpoint(int end) const
+{
+    int best = -1;
+    for (int i = 0; i < m_checkpoints.size(); ++i) {
+        const int command = m_checkpoints.at(i).command;
+        if (command <= end && (best < 0 || command > m_checkpoints.at(best).command))
+            best = i;
+    }
+    return best;
+}
+
+void PaintBufferReplay::addCheckpoint(int command, const QImage &image)
+{
+    const int count = maximumCheckpointCount();
+    if (count <= 0)
+        return;
+    for (int i = 0; i < m_checkpoints.size(); ++i) {
+        if (m_checkpoints.at(i).command == command)
+            return;
+    }
+
+    Checkpoint checkpoint;
+    checkpoint.command = command;
+    checkpoint.image = image.copy(); // image is still being painted on
+    checkpoint.lastUsed = ++m_useCounter;
+    if (m_checkpoints.size() < count) {
+        m_checkpoints.push_back(checkpoint);
+        return;
+    }
+
+    // evict the least recently used keyframe
+    int lru = 0;
+    for (int i = 1; i < m_checkpoints.size(); ++i) {
+        if (m_checkpoints.at(i).lastUsed < m_checkpoints.at(lru).lastUsed)
+            lru = i;
+    }
+    m_checkpoints[lru] = checkpoint;
+}
+
+int PaintBufferReplay::maximumCheckpointCount() const
+{
+    const QSize size = imageSize();
+    const qint64 imageBytes = std::max<qint64>(1, qint64(size.width()) * size.height() * 4);
+    return int(std::min<qint64>(m_cacheSize / imageBytes, 1024));
+}
+
+int PaintBufferReplay::restorePainterState(QPainter *painter, int begin, int end) const
+{
+    int depth = 0;
+    foreach (const auto &range, m_stateCommands) {
+        if (range.first >= end)
+            break;
+        const int first = std::max(begin, range.first);
+        const int last = std::min(end, range.second);
+        if (first < last)
+            depth += m_buffer.processCommands(painter, first, last);
+    }
+    return depth;
+}
+#endif
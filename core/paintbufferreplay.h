@@ -0,0 +1,104 @@
+/*
+  paintbufferreplay.h
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GAMMARAY_PAINTBUFFERREPLAY_H
+#define GAMMARAY_PAINTBUFFERREPLAY_H
+
+#include <config-gammaray.h>
+
+#ifdef HAVE_PRIVATE_QT_HEADERS
+#include <private/qpaintbuffer_p.h>
+
+#include <QImage>
+#include <QPair>
+#include <QVector>
+
+namespace GammaRay {
+/**
+ * Renders the commands of a QPaintBuffer up to a given command, resuming from keyframes.
+ *
+ * Every checkpointInterval() commands a snapshot of the rendered image is taken, and kept
+ * in a least recently used cache of bounded size. The painter state belonging to such a
+ * snapshot is restored by replaying only the state changing commands before it, which is
+ * cheap compared to the actual drawing. Rendering up to any command therefore only needs
+ * to rasterize the commands since the nearest keyframe, instead of the entire prefix.
+ *
+ * This is not thread-safe, but can be used from any one thread at a time.
+ */
+class PaintBufferReplay
+{
+public:
+    PaintBufferReplay();
+
+    /** Replaces the replayed buffer, this discards all keyframes. */
+    void setPaintBuffer(const QPaintBuffer &buffer);
+
+    int checkpointInterval() const;
+    void setCheckpointInterval(int interval);
+
+    /** Limits the memory used by keyframes to @p bytes. */
+    void setCacheSize(int bytes);
+
+    /** Renders the commands of the first frame, up to but excluding command @p end. */
+    QImage render(int end);
+
+private:
+    struct Checkpoint {
+        Checkpoint()
+            : command(-1)
+            , lastUsed(0)
+        {
+        }
+
+        int command;
+        QImage image;
+        quint64 lastUsed;
+    };
+
+    qreal devicePixelRatio() const;
+    QSize imageSize() const;
+    QImage createImage() const;
+    int findCheckpoint(int end) const;
+    void addCheckpoint(int command, const QImage &image);
+    int maximumCheckpointCount() const;
+    /// replays the state changing commands in [begin, end), returns the resulting save depth
+    int restorePainterState(QPainter *painter, int begin, int end) const;
+
+    QPaintBuffer m_buffer;
+    QPaintBufferPrivate *m_privateBuffer;
+    // ranges [first, second) of consecutive commands that only change the painter state
+    QVector<QPair<int, int> > m_stateCommands;
+    QVector<Checkpoint> m_checkpoints;
+    Checkpoint m_lastRendered;
+    quint64 m_useCounter;
+    int m_checkpointInterval;
+    int m_cacheSize;
+};
+}
+#endif
+
+#endif // GAMMARAY_PAINTBUFFERREPLAY_H
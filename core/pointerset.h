@@ -0,0 +1,197 @@
+/*
+  pointerset.h
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GAMMARAY_POINTERSET_H
+#define GAMMARAY_POINTERSET_H
+
+#include <QVector>
+
+#include <algorithm>
+
+namespace GammaRay {
+/** Flat hash set of non-null pointers, tuned for high insert/remove churn.
+ *
+ * Uses open addressing with Robin Hood hashing and backward-shift deletion,
+ * so removing entries never leaves tombstones behind and lookups keep their
+ * short probe sequences. Slots are plain pointers, a probe sequence therefore
+ * typically stays within a single cache line.
+ */
+template<typename T>
+class PointerSet
+{
+public:
+    PointerSet()
+        : m_size(0)
+        , m_shift(64)
+    {
+    }
+
+    int size() const
+    {
+        return m_size;
+    }
+
+    bool isEmpty() const
+    {
+        return m_size == 0;
+    }
+
+    void clear()
+    {
+        m_slots.clear();
+        m_size = 0;
+        m_shift = 64;
+    }
+
+    /** Makes sure @p count entries fit without rehashing. */
+    void reserve(int count)
+    {
+        int capacity = MinimumCapacity;
+        while (count * MaxLoadDenominator >= capacity * MaxLoadNumerator)
+            capacity *= 2;
+        if (capacity > m_slots.size())
+            rehash(capacity);
+    }
+
+    bool contains(T *ptr) const
+    {
+        return find(ptr) >= 0;
+    }
+
+    /** Returns @c true if @p ptr was not contained before. */
+    bool insert(T *ptr)
+    {
+        Q_ASSERT(ptr);
+        if ((m_size + 1) * MaxLoadDenominator >= m_slots.size() * MaxLoadNumerator)
+            rehash(std::max<int>(MinimumCapacity, m_slots.size() * 2));
+
+        T **slots = m_slots.data();
+        const int mask = m_slots.size() - 1;
+        int pos = bucket(ptr);
+        int dist = 0;
+        T *current = ptr;
+        while (true) {
+            T *&slot = slots[pos];
+            if (!slot) {
+                slot = current;
+                ++m_size;
+                return true;
+            }
+            if (slot == current)
+                return false;
+            // steal from the rich: whoever is closer to its home bucket moves on
+            const int slotDist = (pos - bucket(slot)) & mask;
+            if (slotDist < dist) {
+                std::swap(slot, current);
+                dist = slotDist;
+            }
+            pos = (pos + 1) & mask;
+            ++dist;
+        }
+    }
+
+    /** Returns @c true if @p ptr was contained. */
+    bool remove(T *ptr)
+    {
+        int pos = find(ptr);
+        if (pos < 0)
+            return false;
+
+        // shift the following entries of the cluster back by one, instead of a tombstone
+        T **slots = m_slots.data();
+        const int mask = m_slots.size() - 1;
+        while (true) {
+            const int next = (pos + 1) & mask;
+            T *nextSlot = slots[next];
+            if (!nextSlot || bucket(nextSlot) == next) {
+                slots[pos] = 0;
+                break;
+            }
+            slots[pos] = nextSlot;
+            pos = next;
+        }
+        --m_size;
+        return true;
+    }
+
+private:
+    enum {
+        MinimumCapacity = 16,
+        MaxLoadNumerator = 7,
+        MaxLoadDenominator = 8
+    };
+
+    int bucket(const T *ptr) const
+    {
+        // Fibonacci hashing, the low bits of pointers are mostly zero due to alignment
+        return int((quint64(reinterpret_cast<quintptr>(ptr)) * Q_UINT64_C(0x9E3779B97F4A7C15))
+                   >> m_shift);
+    }
+
+    int find(T *ptr) const
+    {
+        if (m_size == 0)
+            return -1;
+
+        const T * const *slots = m_slots.constData();
+        const int mask = m_slots.size() - 1;
+        int pos = bucket(ptr);
+        int dist = 0;
+        while (true) {
+            const T *slot = slots[pos];
+            if (slot == ptr)
+                return pos;
+            // ptr would have displaced any entry closer to its home bucket
+            if (!slot || ((pos - bucket(slot)) & mask) < dist)
+                return -1;
+            pos = (pos + 1) & mask;
+            ++dist;
+        }
+    }
+
+    void rehash(int capacity)
+    {
+        QVector<T *> oldSlots(capacity, 0);
+        m_slots.swap(oldSlots);
+        m_size = 0;
+        m_shift = 64;
+        while ((1 << (64 - m_shift)) < capacity)
+            --m_shift;
+
+        foreach (T *ptr, oldSlots) {
+            if (ptr)
+                insert(ptr);
+        }
+    }
+
+    QVector<T *> m_slots;
+    int m_size;
+    int m_shift;
+};
+}
+
+#endif // GAMMARAY_POINTERSET_H
@@ -49,6 +49,7 @@
 #include "toolpluginerrormodel.h"
 #include "toolfactory.h"
 #include "probeguard.h"
+#include "threadobjectqueue.h"
 
 #include <common/objectbroker.h>
 #include <common/streamoperators.h>
@@ -64,7 +65,9 @@
 #include <QLibrary>
 #include <QMouseEvent>
 #include <QUrl>
+#include <QVarLengthArray>
 #include <QThread>
+#include <QThreadStorage>
 #include <QTimer>
 
 #ifdef HAVE_PRIVATE_QT_HEADERS
@@ -203,6 +206,36 @@ Q_GLOBAL_STATIC(Listener, s_listener)
 // locking it in objectAdded/Removed
 Q_GLOBAL_STATIC_WITH_ARGS(QMutex, s_lock, (QMutex::Recursive))
 
+// per-thread queues for lock-free object tracking, the list is protected by s_lock
+struct ThreadObjectQueueHandle
+{
+    ThreadObjectQueueHandle()
+        : queue(new ThreadObjectQueue)
+    {
+    }
+
+    ~ThreadObjectQueueHandle()
+    {
+        // ownership is with the probe thread, which still needs to process pending entries
+        queue->setOrphaned();
+    }
+
+    ThreadObjectQueue *queue;
+};
+
+static QThreadStorage<ThreadObjectQueueHandle *> s_threadObjectQueue;
+Q_GLOBAL_STATIC(QVector<ThreadObjectQueue *>, s_threadObjectQueues)
+static QAtomicInt s_threadObjectQueuesScheduled;
+
+static int loadAcquire(const QAtomicInt &value)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+    return value.loadAcquire();
+#else
+    return const_cast<QAtomicInt &>(value).fetchAndAddAcquire(0);
+#endif
+}
+
 Probe::Probe(QObject *parent)
     : QObject(parent)
     , m_objectListModel(new ObjectListModel(this))
@@ -210,6 +243,7 @@ Probe::Probe(QObject *parent)
     , m_metaObjectTreeModel(new MetaObjectTreeModel(this))
     , m_toolModel(0)
     , m_window(0)
+    , m_lockFreeObjectTracking(false)
     , m_queueTimer(new QTimer(this))
     , m_server(Q_NULLPTR)
 {
@@ -218,6 +252,8 @@ Probe::Probe(QObject *parent)
              )
 
     ProbeSettings::receiveSettings();
+    m_lockFreeObjectTracking = ProbeSettings::value(QStringLiteral("LockFreeObjectTracking"),
+                                                    false).toBool();
     m_toolModel = new ToolModel(this);
     auto sortedToolModel = new ServerProxyModel<QSortFilterProxyModel>(this);
     sortedToolModel->setSourceModel(m_toolModel);
@@ -282,11 +318,18 @@ Probe::~Probe()
     ProbeSettings::resetLauncherIdentifier();
 
     s_instance = QAtomicPointer<Probe>(0);
+
+    // discard whatever secondary threads queued meanwhile, it must not leak into a new probe instance
+    QMutexLocker lock(s_lock());
+    QVector<QObject *> discarded;
+    foreach (ThreadObjectQueue *queue, *s_threadObjectQueues())
+        queue->takeAll(discarded);
 }
 
 void Probe::setWindow(QObject *window)
 {
     m_window = window;
+    m_filterCache.clear();
 }
 
 QObject *Probe::window() const
@@ -388,6 +431,8 @@ void Probe::startupHookReceived()
 void Probe::delayedInit()
 {
     QCoreApplication::instance()->installEventFilter(this);
+    // we might have missed reparenting before the event filter was in place
+    m_filterCache.clear();
 
     QString appName = qApp->applicationName();
     if (appName.isEmpty() && !qApp->arguments().isEmpty()) {
@@ -451,12 +496,27 @@ void Probe::showInProcessUi()
 }
 
 bool Probe::filterObject(QObject *obj) const
+{
+    return filterObject(obj, true);
+}
+
+bool Probe::filterObject(QObject *obj, bool allowCache) const
 {
     if (obj->thread() != thread()) {
         // shortcut, never filter objects from a different thread
         return false;
     }
 
+    // signal spy callbacks can reach us from other threads, only those in ours may use the cache
+    // without reliable destruction tracking we could end up with stale entries for reused addresses
+    const bool useCache = allowCache && QThread::currentThread() == thread()
+                          && hasReliableObjectTracking();
+    // the cache is only touched from our thread, other threads queue their invalidations
+    if (useCache && loadAcquire(m_filterCacheInvalidationsPending))
+        processFilterCacheInvalidations();
+    QVarLengthArray<QObject *, 32> uncachedAncestors;
+    bool filtered = false;
+
     QSet<QObject *> visitedObjects;
     int iteration = 0;
     QObject *o = obj;
@@ -474,11 +534,66 @@ bool Probe::filterObject(QObject *obj) const
         }
         ++iteration;
 
-        if (o == this || o == window())
-            return true;
+        if (o == this || o == window()) {
+            filtered = true;
+            break;
+        }
+        if (useCache) {
+            const auto it = m_filterCache.constFind(o);
+            if (it != m_filterCache.constEnd()) {
+                filtered = it.value();
+                break;
+            }
+            uncachedAncestors.append(o);
+        }
         o = o->parent();
     } while (o);
-    return false;
+
+    for (int i = 0; i < uncachedAncestors.size(); ++i)
+        m_filterCache.insert(uncachedAncestors.at(i), filtered);
+    return filtered;
+}
+
+// pre-conditions: lock may or may not be held already, arbitrary thread
+void Probe::invalidateFilterCache(QObject *obj)
+{
+    if (QThread::currentThread() != thread()) {
+        // walking the children of obj isn't safe from here, so drop everything
+        queueFilterCacheInvalidation(Q_NULLPTR);
+        return;
+    }
+    // any cached descendant implies a cached ancestor, so we can stop at the first miss
+    if (!m_filterCache.remove(obj))
+        return;
+    foreach (QObject *child, obj->children())
+        invalidateFilterCache(child);
+}
+
+// pre-conditions: lock may or may not be held already, arbitrary thread
+void Probe::queueFilterCacheInvalidation(QObject *obj)
+{
+    QMutexLocker lock(s_lock());
+    m_filterCacheInvalidations.push_back(obj);
+    m_filterCacheInvalidationsPending.fetchAndStoreRelease(1);
+}
+
+// pre-conditions: lock may or may not be held already, our thread
+void Probe::processFilterCacheInvalidations() const
+{
+    QVector<QObject *> invalidations;
+    {
+        QMutexLocker lock(s_lock());
+        invalidations.swap(m_filterCacheInvalidations);
+        m_filterCacheInvalidationsPending.fetchAndStoreRelaxed(0);
+    }
+    foreach (QObject *obj, invalidations) {
+        if (!obj) {
+            m_filterCache.clear();
+            return;
+        }
+        // obj is gone already, its children report their own destruction
+        m_filterCache.remove(obj);
+    }
 }
 
 void Probe::registerModel(const QString &objectName, QAbstractItemModel *model)
@@ -544,8 +659,18 @@ QMutex *Probe::objectLock()
  */
 void Probe::objectAdded(QObject *obj, bool fromCtor)
 {
+    // objects constructed in other threads are only looked at by our thread once they
+    // are fully constructed anyway, so there is no need to take the lock for them yet
+    if (fromCtor && queueCreatedObjectLockFree(obj))
+        return;
+
     QMutexLocker lock(s_lock());
+    addObject(obj, fromCtor);
+}
 
+// pre-conditions: lock is held already, arbitrary thread
+void Probe::addObject(QObject *obj, bool fromCtor)
+{
     // attempt to ignore objects created by GammaRay itself, especially short-lived ones
     if (fromCtor && ProbeGuard::insideProbe() && obj->thread() == QThread::currentThread())
         return;
@@ -590,10 +715,15 @@ void Probe::objectAdded(QObject *obj, bool fromCtor)
 
     // make sure we already know the parent
     if (obj->parent() && !instance()->m_validObjects.contains(obj->parent()))
-        objectAdded(obj->parent(), fromCtor);
+        addObject(obj->parent(), fromCtor);
     Q_ASSERT(!obj->parent() || instance()->m_validObjects.contains(obj->parent()));
 
-    instance()->m_validObjects << obj;
+    // we might have found obj by other means than the queue of its thread,
+    // make sure its thread doesn't consider it untracked on destruction
+    if (instance()->m_lockFreeObjectTracking && obj->thread() != instance()->thread())
+        instance()->revokeFromThreadObjectQueues(obj);
+
+    instance()->m_validObjects.insert(obj);
     if (!instance()->hasReliableObjectTracking()) {
         // when we did not use a preload variant that
         // overwrites qt_removeObject we must track object
@@ -617,8 +747,11 @@ void Probe::objectAdded(QObject *obj, bool fromCtor)
 
     if (fromCtor)
         instance()->queueCreatedObject(obj);
-    else
-        instance()->objectFullyConstructed(obj);
+    else if (instance()->objectFullyConstructed(obj)) {
+        QVector<QObject *> batch;
+        batch.push_back(obj);
+        instance()->emitObjectChangeBatch(batch, ObjectChange::Create);
+    }
 }
 
 // pre-conditions: lock may or may not be held already, our thread
@@ -632,25 +765,45 @@ void Probe::processQueuedObjectChanges()
     // must be called from the main thread via timeout
     Q_ASSERT(QThread::currentThread() == thread());
 
-    foreach (const auto &change, m_queuedObjectChanges) {
+    processThreadObjectQueues();
+
+    // consecutive changes of the same type are reported as one batch in addition,
+    // iterate by index as processing a change might queue further ones
+    QVector<QObject *> batch;
+    ObjectChange::Type batchType = ObjectChange::Create;
+    for (int i = 0; i < m_queuedObjectChanges.size(); ++i) {
+        const ObjectChange change = m_queuedObjectChanges.at(i);
+        if (!change.obj) // cancelled out by purgeChangesForObject()
+            continue;
+
+        if (change.type != batchType) {
+            emitObjectChangeBatch(batch, batchType);
+            batchType = change.type;
+        }
+
         switch (change.type) {
         case ObjectChange::Create:
-            objectFullyConstructed(change.obj);
+            m_queuedObjectCreations.remove(change.obj);
+            if (objectFullyConstructed(change.obj))
+                batch.push_back(change.obj);
             break;
         case ObjectChange::Destroy:
-            emit objectDestroyed(change.obj);
+            batch.push_back(change.obj);
             break;
         }
     }
+    emitObjectChangeBatch(batch, batchType);
 
     IF_DEBUG(cout << Q_FUNC_INFO << " done" << endl;
              )
 
     m_queuedObjectChanges.clear();
+    m_queuedObjectCreations.clear();
 
     foreach (QObject *obj, m_pendingReparents) {
         if (!isValidObject(obj))
             continue;
+        invalidateFilterCache(obj); // cached meanwhile, possibly while it was still being moved
         if (filterObject(obj)) // the move might have put it under a hidden parent
             objectRemoved(obj);
         else
@@ -660,7 +813,34 @@ void Probe::processQueuedObjectChanges()
 }
 
 // pre-condition: lock is held already, our thread
-void Probe::objectFullyConstructed(QObject *obj)
+void Probe::emitObjectChangeBatch(QVector<QObject *> &batch, ObjectChange::Type type)
+{
+    if (batch.isEmpty())
+        return;
+
+    // the batch goes first, so per-object receivers find the objects in our models already
+    if (type == ObjectChange::Create) {
+        // receivers of signals for ancestors might have destroyed some of them again meanwhile
+        batch.erase(std::remove_if(batch.begin(), batch.end(), [this](QObject *obj) {
+            return !m_validObjects.contains(obj);
+        }), batch.end());
+        if (!batch.isEmpty())
+            emit objectsCreated(batch);
+        foreach (QObject *obj, batch) {
+            if (m_validObjects.contains(obj)) // same for receivers of objectCreated()
+                emit objectCreated(obj);
+        }
+    } else {
+        emit objectsDestroyed(batch);
+        foreach (QObject *obj, batch)
+            emit objectDestroyed(obj);
+    }
+    batch.clear();
+}
+
+// pre-condition: lock is held already, our thread
+// returns true if obj is to be reported via emitObjectChangeBatch()
+bool Probe::objectFullyConstructed(QObject *obj)
 {
     Q_ASSERT(thread() == QThread::currentThread());
 
@@ -668,7 +848,7 @@ void Probe::objectFullyConstructed(QObject *obj)
         // deleted already
         IF_DEBUG(cout << "stale fully constructed: " << hex << obj << endl;
                  )
-        return;
+        return false;
     }
 
     if (filterObject(obj)) {
@@ -678,7 +858,7 @@ void Probe::objectFullyConstructed(QObject *obj)
         m_validObjects.remove(obj);
         IF_DEBUG(cout << "now filtered fully constructed: " << hex << obj << endl;
                  )
-        return;
+        return false;
     }
 
     IF_DEBUG(cout << "fully constructed: " << hex << obj << endl;
@@ -700,8 +880,7 @@ void Probe::objectFullyConstructed(QObject *obj)
         connect(obj, SIGNAL(parentChanged(QQuickItem*)), this, SLOT(objectParentChanged()));
 
     m_toolModel->objectAdded(obj);
-
-    emit objectCreated(obj);
+    return true;
 }
 
 /*
@@ -715,6 +894,14 @@ void Probe::objectFullyConstructed(QObject *obj)
  */
 void Probe::objectRemoved(QObject *obj)
 {
+    // the filter cache belongs to our thread, other threads queue the removal further down
+    if (isInitialized() && QThread::currentThread() == instance()->thread())
+        instance()->m_filterCache.remove(obj);
+
+    // short-lived objects that never left the queue of their thread don't need the lock
+    if (revokeQueuedObjectLockFree(obj))
+        return;
+
     QMutexLocker lock(s_lock());
 
     if (!isInitialized()) {
@@ -740,20 +927,32 @@ void Probe::objectRemoved(QObject *obj)
     IF_DEBUG(cout << "object removed:" << hex << obj << " " << obj->parent() << endl;
              )
 
+    // objects of other threads are never cached, ThreadChange invalidates moved ones
+    if (QThread::currentThread() != instance()->thread() && obj->thread() == instance()->thread())
+        instance()->queueFilterCacheInvalidation(obj);
+
     bool success = instance()->m_validObjects.remove(obj);
     if (!success) {
-        // object was not tracked by the probe, probably a gammaray object
+        // object was not tracked by the probe, probably a gammaray object,
+        // or it is still queued by a thread other than the one destroying it
+        if (instance()->m_lockFreeObjectTracking)
+            instance()->revokeFromThreadObjectQueues(obj);
         EXPENSIVE_ASSERT(!instance()->isObjectCreationQueued(obj));
         return;
     }
 
+    // a still queued creation is dropped, but the destruction has to be reported regardless,
+    // listeners might have discovered obj on their own (e.g. by traversing the object tree)
     instance()->purgeChangesForObject(obj);
     EXPENSIVE_ASSERT(!instance()->isObjectCreationQueued(obj));
 
-    if (instance()->thread() == QThread::currentThread())
-        emit instance()->objectDestroyed(obj);
-    else
+    if (instance()->thread() == QThread::currentThread()) {
+        QVector<QObject *> batch;
+        batch.push_back(obj);
+        instance()->emitObjectChangeBatch(batch, ObjectChange::Destroy);
+    } else {
         instance()->queueDestroyedObject(obj);
+    }
 }
 
 void Probe::handleObjectDestroyed(QObject *obj)
@@ -763,8 +962,10 @@ void Probe::handleObjectDestroyed(QObject *obj)
 
 void Probe::objectParentChanged()
 {
-    if (sender())
+    if (sender()) {
+        invalidateFilterCache(sender());
         emit objectReparented(sender());
+    }
 }
 
 // pre-condition: we have the lock, arbitrary thread
@@ -775,6 +976,7 @@ void Probe::queueCreatedObject(QObject *obj)
     ObjectChange c;
     c.obj = obj;
     c.type = ObjectChange::Create;
+    m_queuedObjectCreations.insert(obj, m_queuedObjectChanges.size());
     m_queuedObjectChanges.push_back(c);
     notifyQueuedObjectChanges();
 }
@@ -792,22 +994,96 @@ void Probe::queueDestroyedObject(QObject *obj)
 // pre-condition: we have the lock, arbitrary thread
 bool Probe::isObjectCreationQueued(QObject *obj) const
 {
-    return std::find_if(m_queuedObjectChanges.begin(), m_queuedObjectChanges.end(),
-                        [obj](const ObjectChange &c) {
-        return c.obj == obj && c.type == Probe::ObjectChange::Create;
-    }) != m_queuedObjectChanges.end();
+    return m_queuedObjectCreations.contains(obj);
 }
 
 // pre-condition: we have the lock, arbitrary thread
-void Probe::purgeChangesForObject(QObject *obj)
+// returns true if a queued creation of obj has been cancelled
+bool Probe::purgeChangesForObject(QObject *obj)
 {
-    for (int i = 0; i < m_queuedObjectChanges.size(); ++i) {
-        if (m_queuedObjectChanges.at(i).obj == obj
-            && m_queuedObjectChanges.at(i).type == ObjectChange::Create) {
-            m_queuedObjectChanges.remove(i);
-            return;
+    const auto it = m_queuedObjectCreations.find(obj);
+    if (it == m_queuedObjectCreations.end())
+        return false;
+
+    // leave a gap rather than shifting the queue, processQueuedObjectChanges() skips those
+    m_queuedObjectChanges[it.value()].obj = 0;
+    m_queuedObjectCreations.erase(it);
+    return true;
+}
+
+/*
+ * Objects created in secondary threads are put into a lock-free queue owned by
+ * that thread, and only added to m_validObjects once we process that queue here.
+ * Until then, the creating thread can drop them again without ever touching the lock.
+ *
+ * pre-conditions: lock may or may not be held already, arbitrary thread
+ */
+bool Probe::queueCreatedObjectLockFree(QObject *obj)
+{
+    Probe *probe = instance();
+    if (!probe || !probe->m_lockFreeObjectTracking || !probe->hasReliableObjectTracking())
+        return false;
+    if (probe->thread() == QThread::currentThread() || obj->thread() != QThread::currentThread())
+        return false;
+
+    // ignore objects created by GammaRay itself, same as the locked code path
+    if (ProbeGuard::insideProbe())
+        return true;
+
+    if (!s_threadObjectQueue.hasLocalData()) {
+        ThreadObjectQueueHandle *handle = new ThreadObjectQueueHandle;
+        {
+            QMutexLocker lock(s_lock());
+            s_threadObjectQueues()->push_back(handle->queue);
+        }
+        s_threadObjectQueue.setLocalData(handle);
+    }
+
+    if (!s_threadObjectQueue.localData()->queue->push(obj))
+        return false; // queue is full, take the slow path
+
+    if (s_threadObjectQueuesScheduled.testAndSetOrdered(0, 1))
+        QMetaObject::invokeMethod(probe, "processQueuedObjectChanges", Qt::QueuedConnection);
+    return true;
+}
+
+// pre-conditions: lock may or may not be held already, arbitrary thread
+bool Probe::revokeQueuedObjectLockFree(QObject *obj)
+{
+    if (!s_threadObjectQueue.hasLocalData())
+        return false;
+    return s_threadObjectQueue.localData()->queue->revoke(obj);
+}
+
+// pre-condition: we have the lock, arbitrary thread
+void Probe::revokeFromThreadObjectQueues(QObject *obj)
+{
+    foreach (ThreadObjectQueue *queue, *s_threadObjectQueues())
+        queue->revoke(obj);
+}
+
+// pre-condition: we have the lock, our thread
+void Probe::processThreadObjectQueues()
+{
+    s_threadObjectQueuesScheduled.fetchAndStoreOrdered(0);
+
+    // take everything out first, so ancestors found via addObject() below
+    // are no longer considered pending by their threads
+    QVector<QObject *> objects;
+    QVector<ThreadObjectQueue *> &queues = *s_threadObjectQueues();
+    for (auto it = queues.begin(); it != queues.end();) {
+        const bool orphaned = (*it)->isOrphaned();
+        (*it)->takeAll(objects);
+        if (orphaned) {
+            delete *it;
+            it = queues.erase(it);
+        } else {
+            ++it;
         }
     }
+
+    foreach (QObject *obj, objects)
+        addObject(obj, false);
 }
 
 // pre-condition: we have the lock, arbitrary thread
@@ -840,8 +1116,10 @@ bool Probe::eventFilter(QObject *receiver, QEvent *event)
         QObject *obj = childEvent->child();
 
         QMutexLocker lock(s_lock());
+        // ChildRemoved still reports the old parent, so don't cache anything here
+        invalidateFilterCache(obj);
         const bool tracked = m_validObjects.contains(obj);
-        const bool filtered = filterObject(obj);
+        const bool filtered = filterObject(obj, false);
 
         IF_DEBUG(cout << "child event: " << hex << obj << ", p: " << obj->parent() << dec
                       << ", tracked: " << tracked
@@ -876,8 +1154,9 @@ bool Probe::eventFilter(QObject *receiver, QEvent *event)
     // widget only unfortunately, but more precise than ChildAdded/Removed...
     if (event->type() == QEvent::ParentChange) {
         QMutexLocker lock(s_lock());
+        invalidateFilterCache(receiver);
         const bool tracked = m_validObjects.contains(receiver);
-        const bool filtered = filterObject(receiver);
+        const bool filtered = filterObject(receiver, false);
         if (!filtered && tracked && !isObjectCreationQueued(receiver)
             && !isObjectCreationQueued(receiver->parent())) {
             m_pendingReparents.removeAll(receiver);
@@ -885,6 +1164,10 @@ bool Probe::eventFilter(QObject *receiver, QEvent *event)
         }
     }
 
+    // filterObject() only caches objects of our thread
+    if (event->type() == QEvent::ThreadChange)
+        invalidateFilterCache(receiver);
+
     // we have no preloading hooks, so recover all objects we see
     if (needsObjectDiscovery() && event->type() != QEvent::ChildAdded
         && event->type() != QEvent::ChildRemoved
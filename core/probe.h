@@ -30,10 +30,12 @@
 #define GAMMARAY_PROBE_H
 
 #include "gammaray_core_export.h"
+#include "pointerset.h"
 #include "probeinterface.h"
 #include "signalspycallbackset.h"
 
 #include <QObject>
+#include <QHash>
 #include <QList>
 #include <QSet>
 #include <QVector>
@@ -155,6 +157,26 @@ signals:
     void objectDestroyed(QObject *obj);
     void objectReparented(QObject *obj);
 
+    /**
+     * Emitted right before objectCreated() is emitted for each of @p objects.
+     *
+     * Objects created in one go, e.g. by a model reset, are reported in a single batch
+     * here, which allows to process them at once. The same notes as for objectCreated()
+     * apply. A batch might also contain just a single object. Receivers of objectCreated()
+     * can therefore rely on the object models containing the object already.
+     * @since 2.6
+     */
+    void objectsCreated(const QVector<QObject *> &objects);
+
+    /**
+     * Emitted right before objectDestroyed() is emitted for each of @p objects.
+     *
+     * The same notes as for objectDestroyed() apply. A batch might also contain just
+     * a single object.
+     * @since 2.6
+     */
+    void objectsDestroyed(const QVector<QObject *> &objects);
+
 protected:
     bool eventFilter(QObject *receiver, QEvent *event) Q_DECL_OVERRIDE;
 
@@ -176,12 +198,23 @@ private:
      */
     bool hasReliableObjectTracking() const;
 
-    void objectFullyConstructed(QObject *obj);
+    bool objectFullyConstructed(QObject *obj);
+    void invalidateFilterCache(QObject *obj);
+    void queueFilterCacheInvalidation(QObject *obj);
+    void processFilterCacheInvalidations() const;
+    bool filterObject(QObject *obj, bool allowCache) const;
+    static void addObject(QObject *obj, bool fromCtor);
+
+    // lock-free tracking of objects created in secondary threads, see ThreadObjectQueue
+    static bool queueCreatedObjectLockFree(QObject *obj);
+    static bool revokeQueuedObjectLockFree(QObject *obj);
+    void revokeFromThreadObjectQueues(QObject *obj);
+    void processThreadObjectQueues();
 
     void queueCreatedObject(QObject *obj);
     void queueDestroyedObject(QObject *obj);
     bool isObjectCreationQueued(QObject *obj) const;
-    void purgeChangesForObject(QObject *obj);
+    bool purgeChangesForObject(QObject *obj);
     void notifyQueuedObjectChanges();
 
     void findExistingObjects();
@@ -205,7 +238,8 @@ private:
     ToolModel *m_toolModel;
     QItemSelectionModel *m_toolSelectionModel;
     QObject *m_window;
-    QSet<QObject *> m_validObjects;
+    PointerSet<QObject> m_validObjects;
+    bool m_lockFreeObjectTracking;
 
     // all delayed object changes need to go through a single queue, as the order is crucial
     struct ObjectChange {
@@ -215,9 +249,19 @@ private:
             Destroy
         } type;
     };
+    void emitObjectChangeBatch(QVector<QObject *> &batch, ObjectChange::Type type);
+
     QVector<ObjectChange> m_queuedObjectChanges;
+    // position of pending Create changes in m_queuedObjectChanges
+    QHash<QObject *, int> m_queuedObjectCreations;
 
     QList<QObject *> m_pendingReparents;
+    // result of filterObject() for objects of our thread, invalidated on reparenting
+    // only accessed from our thread, without locking
+    mutable QHash<QObject *, bool> m_filterCache;
+    // invalidations from other threads, guarded by s_lock, null clears the entire cache
+    mutable QVector<QObject *> m_filterCacheInvalidations;
+    mutable QAtomicInt m_filterCacheInvalidationsPending;
     QTimer *m_queueTimer;
     QVector<QObject *> m_globalEventFilters;
     QVector<SignalSpyCallbackSet> m_signalSpyCallbacks;
@@ -38,8 +38,10 @@
 #include <QDataStream>
 #include <QDebug>
 #include <QBuffer>
+#include <QHash>
 #include <QIcon>
 
+#include <algorithm>
 #include <iostream>
 
 using namespace GammaRay;
@@ -47,6 +49,43 @@ using namespace std;
 
 void(*RemoteModelServer::s_registerServerCallback)() = 0;
 
+namespace {
+enum SerializableType {
+    NotSerializable,
+    Serializable,
+    VariantContainer // depends on the QVariant elements of each value
+};
+}
+
+// whether values of a given type can be serialized, type id -> SerializableType
+typedef QHash<int, SerializableType> SerializableTypes;
+Q_GLOBAL_STATIC(SerializableTypes, s_serializableTypes)
+
+static bool hasVariantElements(const QVariant &value)
+{
+    switch (value.userType()) {
+    case QMetaType::QVariantList:
+    case QMetaType::QVariantMap:
+    case QMetaType::QVariantHash:
+        return true;
+    }
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 2, 0)
+    // any other registered container can have QVariant elements as well
+    const int sequentialId = qMetaTypeId<QtMetaTypePrivate::QSequentialIterableImpl>();
+    if (QMetaType::hasRegisteredConverterFunction(value.userType(), sequentialId)) {
+        const auto impl = value.value<QtMetaTypePrivate::QSequentialIterableImpl>();
+        return impl._metaType_id == QMetaType::QVariant;
+    }
+    const int associativeId = qMetaTypeId<QtMetaTypePrivate::QAssociativeIterableImpl>();
+    if (QMetaType::hasRegisteredConverterFunction(value.userType(), associativeId)) {
+        const auto impl = value.value<QtMetaTypePrivate::QAssociativeIterableImpl>();
+        return impl._metaType_id_value == QMetaType::QVariant;
+    }
+#endif
+    return false;
+}
+
 RemoteModelServer::RemoteModelServer(const QString &objectName, QObject *parent)
     : QObject(parent)
     , m_model(0)
@@ -189,29 +228,70 @@ void RemoteModelServer::newRequest(const GammaRay::Message &msg)
 
     case Protocol::ModelContentRequest:
     {
-        quint32 size;
-        msg.payload() >> size;
-        Q_ASSERT(size > 0);
-
-        QVector<QModelIndex> indexes;
-        indexes.reserve(size);
-        for (quint32 i = 0; i < size; ++i) {
-            Protocol::ModelIndex index;
-            msg.payload() >> index;
-            const QModelIndex qmIndex = Protocol::toQModelIndex(m_model, index);
-            if (!qmIndex.isValid())
+        quint32 blockCount;
+        msg.payload() >> blockCount;
+        Q_ASSERT(blockCount > 0);
+
+        struct ContentBlock {
+            Protocol::ModelIndex parent;
+            QModelIndex qmParent;
+            qint32 firstRow, lastRow, firstColumn, lastColumn;
+        };
+        QVector<ContentBlock> blocks;
+        blocks.reserve(blockCount);
+        for (quint32 i = 0; i < blockCount; ++i) {
+            ContentBlock block;
+            msg.payload() >> block.parent >> block.firstRow >> block.lastRow >> block.firstColumn
+            >> block.lastColumn;
+            block.qmParent = Protocol::toQModelIndex(m_model, block.parent);
+            if (!block.parent.isEmpty() && !block.qmParent.isValid())
                 continue;
-            indexes.push_back(qmIndex);
+            // the client might not have processed all structure changes yet
+            block.lastRow = std::min(block.lastRow, m_model->rowCount(block.qmParent) - 1);
+            block.lastColumn
+                = std::min(block.lastColumn, m_model->columnCount(block.qmParent) - 1);
+            if (block.firstRow > block.lastRow || block.firstColumn > block.lastColumn)
+                continue;
+            blocks.push_back(block);
         }
-        if (indexes.isEmpty())
+        if (blocks.isEmpty())
             break;
 
+        // columnar layout: per column the union of the roles present,
+        // followed by flags and values for each row
         Message msg(m_myAddress, Protocol::ModelContentReply);
-        msg.payload() << quint32(indexes.size());
-        foreach (const auto &qmIndex, indexes)
-            msg.payload() << Protocol::fromQModelIndex(qmIndex)
-                          << filterItemData(m_model->itemData(qmIndex))
-                          << qint32(m_model->flags(qmIndex));
+        msg.payload() << quint32(blocks.size());
+        QVector<QMap<int, QVariant> > columnData;
+        QVector<qint32> columnFlags;
+        QVector<int> roles;
+        foreach (const ContentBlock &block, blocks) {
+            msg.payload() << block.parent << block.firstRow << block.lastRow << block.firstColumn
+                          << block.lastColumn;
+            const int rowCount = block.lastRow - block.firstRow + 1;
+            columnData.resize(rowCount);
+            columnFlags.resize(rowCount);
+            for (int column = block.firstColumn; column <= block.lastColumn; ++column) {
+                roles.clear();
+                for (int i = 0; i < rowCount; ++i) {
+                    const QModelIndex qmIndex
+                        = m_model->index(block.firstRow + i, column, block.qmParent);
+                    columnData[i] = filterItemData(m_model->itemData(qmIndex));
+                    columnFlags[i] = m_model->flags(qmIndex);
+                    const QMap<int, QVariant> &itemData = columnData.at(i);
+                    for (auto it = itemData.constBegin(); it != itemData.constEnd(); ++it)
+                        roles.push_back(it.key());
+                }
+                std::sort(roles.begin(), roles.end());
+                roles.erase(std::unique(roles.begin(), roles.end()), roles.end());
+
+                msg.payload() << roles;
+                for (int i = 0; i < rowCount; ++i) {
+                    msg.payload() << columnFlags.at(i);
+                    foreach (int role, roles)
+                        msg.payload() << columnData.at(i).value(role);
+                }
+            }
+        }
 
         sendMessage(msg);
         break;
@@ -296,28 +376,67 @@ QMap<int, QVariant> RemoteModelServer::filterItemData(const QMap< int, QVariant
 
 bool RemoteModelServer::canSerialize(const QVariant &value) const
 {
-    if (qstrcmp(value.typeName(), "QJSValue") == 0) {
-        // QJSValue tries to serialize nested elements and asserts if that fails
-        // too bad it can contain QObject* as nested element, which obviously can't be serialized...
-        return false;
+    // serializability depends on the type only, so we only need to try once per type,
+    // unless it's a container with QVariant elements, those can be of any type
+    SerializableTypes::const_iterator it = s_serializableTypes()->constFind(value.userType());
+    if (it == s_serializableTypes()->constEnd()) {
+        SerializableType type = NotSerializable;
+        if (hasVariantElements(value))
+            type = VariantContainer;
+        else if (trySerialize(value))
+            type = Serializable;
+        it = s_serializableTypes()->insert(value.userType(), type);
+    }
+    if (it.value() != VariantContainer)
+        return it.value() == Serializable;
+
+    switch (value.userType()) {
+    case QMetaType::QVariantList:
+        foreach (const QVariant &v, value.toList()) {
+            if (!canSerialize(v))
+                return false;
+        }
+        return true;
+    case QMetaType::QVariantMap:
+        foreach (const QVariant &v, value.toMap()) {
+            if (!canSerialize(v))
+                return false;
+        }
+        return true;
+    case QMetaType::QVariantHash:
+        foreach (const QVariant &v, value.toHash()) {
+            if (!canSerialize(v))
+                return false;
+        }
+        return true;
     }
 
-    // recurse into containers
 #if QT_VERSION >= QT_VERSION_CHECK(5, 2, 0)
     if (value.canConvert<QVariantList>()) {
-        QSequentialIterable it = value.value<QSequentialIterable>();
-        foreach (const QVariant &v, it) {
+        QSequentialIterable iterable = value.value<QSequentialIterable>();
+        foreach (const QVariant &v, iterable) {
             if (!canSerialize(v))
                 return false;
         }
-    } else if (value.canConvert<QVariantMap>()) {
-        auto iterable = value.value<QAssociativeIterable>();
-        for (auto it = iterable.begin(); it != iterable.end(); ++it) {
-            if (!canSerialize(it.value()))
+    } else {
+        QAssociativeIterable iterable = value.value<QAssociativeIterable>();
+        for (auto element = iterable.begin(); element != iterable.end(); ++element) {
+            if (!canSerialize(element.value()))
                 return false;
         }
     }
 #endif
+    // custom containers might lack stream operators, independent of their elements
+    return trySerialize(value);
+}
+
+bool RemoteModelServer::trySerialize(const QVariant &value) const
+{
+    if (qstrcmp(value.typeName(), "QJSValue") == 0) {
+        // QJSValue tries to serialize nested elements and asserts if that fails
+        // too bad it can contain QObject* as nested element, which obviously can't be serialized...
+        return false;
+    }
 
     // ugly, but there doesn't seem to be a better way atm to find out without trying
     m_dummyBuffer->seek(0);
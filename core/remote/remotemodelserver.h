@@ -86,6 +86,7 @@ private:
         const QVector<Protocol::ModelIndex> &parents = QVector<Protocol::ModelIndex>(),
         quint32 hint = 0);
     bool canSerialize(const QVariant &value) const;
+    bool trySerialize(const QVariant &value) const;
 
     // proxy model settings
     bool proxyDynamicSortFilter() const;
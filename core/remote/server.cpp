@@ -176,6 +176,9 @@ void Server::messageReceived(const Message &msg)
                                       Q_ARG(bool, msg.type() == Protocol::ObjectMonitored));
             break;
         }
+        case Protocol::MessageCompressionRequest:
+            acceptMessageCompression();
+            break;
         }
     } else {
         dispatchMessage(msg);
@@ -29,6 +29,9 @@
 #include "remoteviewserver.h"
 
 #include <core/remote/server.h>
+#include <core/probesettings.h>
+
+#include <common/remoteviewframe.h>
 
 #include <QCoreApplication>
 #include <QDebug>
@@ -45,6 +48,7 @@ RemoteViewServer::RemoteViewServer(const QString &name, QObject *parent)
     : RemoteViewInterface(name, parent)
     , m_eventReceiver(Q_NULLPTR)
     , m_updateTimer(new QTimer(this))
+    , m_imageCodec(TransferImage::RawCodec)
     , m_clientActive(false)
     , m_sourceChanged(false)
     , m_clientReady(true)
@@ -55,6 +59,15 @@ RemoteViewServer::RemoteViewServer(const QString &name, QObject *parent)
     m_updateTimer->setSingleShot(true);
     m_updateTimer->setInterval(100);
     connect(m_updateTimer, SIGNAL(timeout()), this, SLOT(requestUpdateTimeout()));
+
+    const QString codec = ProbeSettings::value(QStringLiteral("RemoteViewImageCodec"),
+                                               QStringLiteral("raw")).toString();
+    if (codec == QLatin1String("lz4"))
+        m_imageCodec = TransferImage::Lz4Codec;
+    else if (codec == QLatin1String("png"))
+        m_imageCodec = TransferImage::PngCodec;
+    else if (codec == QLatin1String("jpeg"))
+        m_imageCodec = TransferImage::JpegCodec;
 }
 
 void RemoteViewServer::setEventReceiver(EventReceiver *receiver)
@@ -69,6 +82,7 @@ void RemoteViewServer::pickElementAt(const QPoint &pos)
 
 void RemoteViewServer::resetView()
 {
+    m_lastFrameImage = QImage();
     if (isActive())
         emit reset();
 }
@@ -81,7 +95,12 @@ bool RemoteViewServer::isActive() const
 void RemoteViewServer::sendFrame(const RemoteViewFrame &frame)
 {
     m_clientReady = false;
-    emit frameUpdated(frame);
+
+    RemoteViewFrame f(frame);
+    f.setImageCodec(m_imageCodec);
+    f.setPreviousImage(m_lastFrameImage);
+    m_lastFrameImage = frame.image();
+    emit frameUpdated(f);
 }
 
 void RemoteViewServer::sourceChanged()
@@ -96,6 +115,12 @@ void RemoteViewServer::clientViewUpdated()
     checkRequestUpdate();
 }
 
+void RemoteViewServer::requestCompleteFrame()
+{
+    m_lastFrameImage = QImage();
+    sourceChanged();
+}
+
 void RemoteViewServer::checkRequestUpdate()
 {
     if (isActive() && !m_updateTimer->isActive() && m_clientReady && m_sourceChanged)
@@ -150,6 +175,7 @@ void RemoteViewServer::setViewActive(bool active)
 {
     m_clientActive = active;
     m_clientReady = active;
+    m_lastFrameImage = QImage();
     if (active)
         sourceChanged();
     else
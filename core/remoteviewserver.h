@@ -32,6 +32,9 @@
 #include "gammaray_core_export.h"
 
 #include <common/remoteviewinterface.h>
+#include <common/transferimage.h>
+
+#include <QImage>
 
 QT_BEGIN_NAMESPACE
 class QTimer;
@@ -83,6 +86,7 @@ private:
                         int modifiers) Q_DECL_OVERRIDE;
     void setViewActive(bool active) Q_DECL_OVERRIDE;
     void clientViewUpdated() Q_DECL_OVERRIDE;
+    void requestCompleteFrame() Q_DECL_OVERRIDE;
 
     void checkRequestUpdate();
 
@@ -93,6 +97,9 @@ private slots:
 private:
     EventReceiver *m_eventReceiver;
     QTimer *m_updateTimer;
+    // what the client has, frames only need to contain the difference to that
+    QImage m_lastFrameImage;
+    TransferImage::TileCodec m_imageCodec;
     bool m_clientActive;
     bool m_sourceChanged;
     bool m_clientReady;
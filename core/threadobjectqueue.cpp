@@ -0,0 +1,95 @@
+/*
+  threadobjectqueue.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "threadobjectqueue.h"
+
+using namespace GammaRay;
+
+ThreadObjectQueue::ThreadObjectQueue()
+    : m_head(0)
+    , m_tail(0)
+    , m_orphaned(0)
+{
+}
+
+int ThreadObjectQueue::loadAcquire(const QAtomicInt &value)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+    return value.loadAcquire();
+#else
+    return const_cast<QAtomicInt &>(value).fetchAndAddAcquire(0);
+#endif
+}
+
+QObject *ThreadObjectQueue::loadRelaxed(const QAtomicPointer<QObject> &value)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+    return value.load();
+#else
+    return value;
+#endif
+}
+
+int ThreadObjectQueue::pendingCount(int head, int tail) const
+{
+    return (head - tail) & IndexMask;
+}
+
+bool ThreadObjectQueue::push(QObject *obj)
+{
+    const int head = loadAcquire(m_head);
+    if (pendingCount(head, loadAcquire(m_tail)) >= Capacity)
+        return false;
+
+    m_slots[head & (Capacity - 1)].fetchAndStoreRelease(obj);
+    m_head.fetchAndStoreRelease((head + 1) & IndexMask);
+    return true;
+}
+
+bool ThreadObjectQueue::revoke(QObject *obj)
+{
+    // search backwards, short-lived objects are usually found right at the head
+    int pos = loadAcquire(m_head);
+    int count = pendingCount(pos, loadAcquire(m_tail));
+    while (count-- > 0) {
+        pos = (pos - 1) & IndexMask;
+        QAtomicPointer<QObject> &slot = m_slots[pos & (Capacity - 1)];
+        if (loadRelaxed(slot) == obj)
+            return slot.testAndSetOrdered(obj, 0);
+    }
+    return false;
+}
+
+void ThreadObjectQueue::setOrphaned()
+{
+    m_orphaned.fetchAndStoreRelease(1);
+}
+
+bool ThreadObjectQueue::isOrphaned() const
+{
+    return loadAcquire(m_orphaned);
+}
@@ -0,0 +1,96 @@
+/*
+  threadobjectqueue.h
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GAMMARAY_THREADOBJECTQUEUE_H
+#define GAMMARAY_THREADOBJECTQUEUE_H
+
+#include <QAtomicInt>
+#include <QAtomicPointer>
+
+QT_BEGIN_NAMESPACE
+class QObject;
+QT_END_NAMESPACE
+
+namespace GammaRay {
+/** Lock-free single-producer/single-consumer ring of objects created in a secondary thread.
+ *
+ * The owning thread pushes newly constructed objects, the probe thread takes them
+ * out again with the object lock held. Entries that have not been taken yet can
+ * be revoked by any thread, which allows short-lived objects to be created and
+ * destroyed without ever touching the object lock.
+ */
+class ThreadObjectQueue
+{
+public:
+    ThreadObjectQueue();
+
+    /** Producer side. Returns @c false if the queue is full. */
+    bool push(QObject *obj);
+
+    /** Revokes a pending entry for @p obj.
+     *  Returns @c true if @p obj was still pending and will never be seen by the consumer.
+     */
+    bool revoke(QObject *obj);
+
+    /** Consumer side. Appends all pending, non-revoked entries to @p objects. */
+    template<typename Container>
+    void takeAll(Container &objects)
+    {
+        int tail = loadAcquire(m_tail);
+        const int head = loadAcquire(m_head);
+        while (tail != head) {
+            QObject *obj = m_slots[tail & (Capacity - 1)].fetchAndStoreAcquire(0);
+            if (obj)
+                objects.push_back(obj);
+            tail = (tail + 1) & IndexMask;
+        }
+        m_tail.fetchAndStoreRelease(tail);
+    }
+
+    /** Marks this queue as no longer used by its producer thread. */
+    void setOrphaned();
+    bool isOrphaned() const;
+
+private:
+    Q_DISABLE_COPY(ThreadObjectQueue)
+    static int loadAcquire(const QAtomicInt &value);
+    static QObject *loadRelaxed(const QAtomicPointer<QObject> &value);
+    int pendingCount(int head, int tail) const;
+
+    enum {
+        Capacity = 1024, // must be a power of two
+        IndexMask = 2 * Capacity - 1 // positions wrap at twice the capacity to tell full from empty
+    };
+
+    QAtomicPointer<QObject> m_slots[Capacity];
+    QAtomicInt m_head; // written by the producer only
+    QAtomicInt m_tail; // written by the consumer only
+    QAtomicInt m_orphaned;
+};
+}
+
+#endif // GAMMARAY_THREADOBJECTQUEUE_H
@@ -0,0 +1,278 @@
+/*
+  elffile.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2015-2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Volker Krause <volker.krause@kdab.com>
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <config-gammaray.h>
+
+#include "elffile.h"
+
+#include <QDebug>
+#include <QString>
+#include <QVector>
+
+#ifdef HAVE_ELF_H
+#include <elf.h>
+#endif
+// on Linux sys/elf.h is not what we want, on QNX we cannot add "sys" to the include dir without messing other stuff up...
+#if defined(HAVE_SYS_ELF_H) && !defined(HAVE_ELF_H)
+#include <sys/elf.h>
+#endif
+
+#include <cstring>
+
+using namespace GammaRay;
+
+ElfFile::ElfFile(const QString &filePath)
+    : m_file(filePath)
+    , m_begin(Q_NULLPTR)
+    , m_end(Q_NULLPTR)
+    , m_elfClass(0)
+    , m_machine(0)
+{
+    if (!m_file.open(QFile::ReadOnly))
+        return;
+
+    m_begin = m_file.map(0, m_file.size());
+    m_end = m_begin + m_file.size();
+    if (!parse())
+        close();
+}
+
+ElfFile::~ElfFile()
+{
+    close();
+}
+
+void ElfFile::close()
+{
+    if (!m_begin)
+        return;
+    m_file.close();
+    m_begin = Q_NULLPTR;
+    m_end = Q_NULLPTR;
+}
+
+bool ElfFile::parse()
+{
+    if (!m_begin || m_file.size() < EI_NIDENT)
+        return false;
+
+    if (qstrncmp(reinterpret_cast<const char *>(m_begin), ELFMAG, SELFMAG) != 0) // no ELF signature
+        return false;
+
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    if (m_begin[EI_DATA] != ELFDATA2LSB)
+        return false;
+#else
+    if (m_begin[EI_DATA] != ELFDATA2MSB)
+        return false;
+#endif
+
+    m_elfClass = m_begin[EI_CLASS];
+    switch (m_elfClass) {
+    case ELFCLASS32:
+        return parseDynamic<Elf32_Ehdr, Elf32_Phdr, Elf32_Dyn, Elf32_Verdef, Elf32_Verdaux>();
+    case ELFCLASS64:
+        return parseDynamic<Elf64_Ehdr, Elf64_Phdr, Elf64_Dyn, Elf64_Verdef, Elf64_Verdaux>();
+    }
+    return false;
+}
+
+static QList<QByteArray> splitPathList(const char *paths)
+{
+    QList<QByteArray> result;
+    foreach (const QByteArray &path, QByteArray(paths).split(':')) {
+        if (!path.isEmpty())
+            result.push_back(path);
+    }
+    return result;
+}
+
+template<typename Ehdr, typename Phdr, typename Dyn, typename Verdef, typename Verdaux>
+bool ElfFile::parseDynamic()
+{
+    const quint64 fileSize = m_end - m_begin;
+    if (fileSize < sizeof(Ehdr))
+        return false;
+    const Ehdr *hdr = reinterpret_cast<const Ehdr *>(m_begin);
+    m_machine = hdr->e_machine;
+
+    // anything beyond the header is optional, files without dynamic section are valid nevertheless
+    if (hdr->e_phentsize != sizeof(Phdr)
+        || hdr->e_phoff + quint64(hdr->e_phnum) * sizeof(Phdr) > fileSize)
+        return true;
+    const Phdr *phdrs = reinterpret_cast<const Phdr *>(m_begin + hdr->e_phoff);
+
+    // dynamic entries refer to virtual addresses, map those back to the file via the load segments
+    auto fileData = [this, hdr, phdrs, fileSize](quint64 vaddr, quint64 size) -> const uchar * {
+        for (int i = 0; i < hdr->e_phnum; ++i) {
+            const Phdr &phdr = phdrs[i];
+            if (phdr.p_type != PT_LOAD || vaddr < phdr.p_vaddr
+                || vaddr + size > phdr.p_vaddr + phdr.p_filesz)
+                continue;
+            const quint64 offset = vaddr - phdr.p_vaddr + phdr.p_offset;
+            if (offset + size > fileSize)
+                return Q_NULLPTR;
+            return m_begin + offset;
+        }
+        return Q_NULLPTR;
+    };
+
+    const Dyn *dyn = Q_NULLPTR;
+    const Dyn *dynEnd = Q_NULLPTR;
+    for (int i = 0; i < hdr->e_phnum; ++i) {
+        if (phdrs[i].p_type != PT_DYNAMIC || phdrs[i].p_offset + phdrs[i].p_filesz > fileSize)
+            continue;
+        dyn = reinterpret_cast<const Dyn *>(m_begin + phdrs[i].p_offset);
+        dynEnd = dyn + phdrs[i].p_filesz / sizeof(Dyn);
+    }
+
+    quint64 strTab = 0, strSize = 0, verDef = 0, verDefNum = 0;
+    QVector<quint64> needed;
+    qint64 rpath = -1, runpath = -1;
+    for (; dyn && dyn < dynEnd && dyn->d_tag != DT_NULL; ++dyn) {
+        switch (dyn->d_tag) {
+        case DT_STRTAB:
+            strTab = dyn->d_un.d_ptr;
+            break;
+        case DT_STRSZ:
+            strSize = dyn->d_un.d_val;
+            break;
+        case DT_NEEDED:
+            needed.push_back(dyn->d_un.d_val);
+            break;
+        case DT_RPATH:
+            rpath = dyn->d_un.d_val;
+            break;
+        case DT_RUNPATH:
+            runpath = dyn->d_un.d_val;
+            break;
+        case DT_VERDEF:
+            verDef = dyn->d_un.d_ptr;
+            break;
+        case DT_VERDEFNUM:
+            verDefNum = dyn->d_un.d_val;
+            break;
+        }
+    }
+
+    const char *strings = reinterpret_cast<const char *>(fileData(strTab, strSize));
+    if (!strings || strSize == 0)
+        return true;
+    auto stringAt = [strings, strSize](quint64 offset) -> const char * {
+        // entries need to be null-terminated within the string table
+        if (offset >= strSize || !memchr(strings + offset, 0, strSize - offset))
+            return Q_NULLPTR;
+        return strings + offset;
+    };
+
+    foreach (quint64 offset, needed) {
+        if (const char *name = stringAt(offset))
+            m_neededLibraries.push_back(QByteArray(name));
+    }
+    if (rpath >= 0 && stringAt(rpath))
+        m_rpath = splitPathList(stringAt(rpath));
+    if (runpath >= 0 && stringAt(runpath))
+        m_runpath = splitPathList(stringAt(runpath));
+
+    const uchar *def = fileData(verDef, sizeof(Verdef));
+    for (quint64 i = 0; def && i < verDefNum; ++i) {
+        const Verdef *vd = reinterpret_cast<const Verdef *>(def);
+        if (def + vd->vd_aux + sizeof(Verdaux) > m_end)
+            break;
+        const Verdaux *aux = reinterpret_cast<const Verdaux *>(def + vd->vd_aux);
+        // the base entry is just the soname
+        if (!(vd->vd_flags & VER_FLG_BASE) && stringAt(aux->vda_name))
+            m_versionDefinitions.push_back(QByteArray(stringAt(aux->vda_name)));
+        if (!vd->vd_next || def + vd->vd_next + sizeof(Verdef) > m_end)
+            break;
+        def += vd->vd_next;
+    }
+
+    return true;
+}
+
+bool ElfFile::isValid() const
+{
+    return m_begin != Q_NULLPTR;
+}
+
+int ElfFile::elfClass() const
+{
+    return m_elfClass;
+}
+
+int ElfFile::machine() const
+{
+    return m_machine;
+}
+
+QString ElfFile::architecture() const
+{
+    if (!isValid())
+        return QString();
+
+    switch (m_machine) {
+    case EM_386:
+        return QStringLiteral("i686");
+#ifdef EM_X86_64
+    case EM_X86_64:
+        return QStringLiteral("x86_64");
+#endif
+    case EM_ARM:
+        return QStringLiteral("arm");
+    }
+
+    qWarning() << "Unsupported ELF machine type:" << m_machine;
+    return QString();
+}
+
+QList<QByteArray> ElfFile::neededLibraries() const
+{
+    return m_neededLibraries;
+}
+
+QList<QByteArray> ElfFile::rpath() const
+{
+    return m_rpath;
+}
+
+QList<QByteArray> ElfFile::runpath() const
+{
+    return m_runpath;
+}
+
+QList<QByteArray> ElfFile::versionDefinitions() const
+{
+    return m_versionDefinitions;
+}
+
+QByteArray ElfFile::data() const
+{
+    if (!isValid())
+        return QByteArray();
+    return QByteArray::fromRawData(reinterpret_cast<const char *>(m_begin), m_end - m_begin);
+}
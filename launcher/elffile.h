@@ -0,0 +1,81 @@
+/*
+  elffile.h
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2015-2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Volker Krause <volker.krause@kdab.com>
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef GAMMARAY_ELFFILE_H
+#define GAMMARAY_ELFFILE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+
+namespace GammaRay {
+/** Convenience API to deal with extracting information from ELF files.
+ *  Only files matching the byte order of the host are supported.
+ */
+class ElfFile
+{
+public:
+    explicit ElfFile(const QString &filePath);
+    ~ElfFile();
+
+    bool isValid() const;
+    /** ELF class and machine type, dependencies need to match both. */
+    int elfClass() const;
+    int machine() const;
+    QString architecture() const;
+
+    /** DT_NEEDED entries. */
+    QList<QByteArray> neededLibraries() const;
+    /** DT_RPATH and DT_RUNPATH entries, without $ORIGIN expansion. */
+    QList<QByteArray> rpath() const;
+    QList<QByteArray> runpath() const;
+    /** Names of the symbol versions defined by this file. */
+    QList<QByteArray> versionDefinitions() const;
+
+    /** The entire file content, valid as long as this object lives. */
+    QByteArray data() const;
+
+private:
+    Q_DISABLE_COPY(ElfFile)
+    void close();
+    bool parse();
+    template<typename Ehdr, typename Phdr, typename Dyn, typename Verdef, typename Verdaux>
+    bool parseDynamic();
+
+    QFile m_file;
+    const uchar *m_begin;
+    const uchar *m_end;
+    int m_elfClass;
+    int m_machine;
+    QList<QByteArray> m_neededLibraries;
+    QList<QByteArray> m_rpath;
+    QList<QByteArray> m_runpath;
+    QList<QByteArray> m_versionDefinitions;
+};
+}
+
+#endif // GAMMARAY_ELFFILE_H
@@ -39,6 +39,7 @@
 #include <common/paths.h>
 #include <common/protocol.h>
 #include <launcher/probeabi.h>
+#include <launcher/probeabicache.h>
 #include <launcher/probeabidetector.h>
 
 #ifdef HAVE_QT_WIDGETS
@@ -337,6 +338,8 @@ int main(int argc, char **argv)
         }
         options.setProbeABI(availableProbes.first());
     }
+    // don't rely on global destructors running to persist the detection results
+    ProbeABICache::instance()->save();
 
     Launcher launcher(options);
     QObject::connect(&launcher, SIGNAL(finished()), &app, SLOT(quit()));
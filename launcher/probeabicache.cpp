@@ -0,0 +1,390 @@
+/*
+  probeabicache.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2015-2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Volker Krause <volker.krause@kdab.com>
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <config-gammaray.h>
+
+#include "probeabicache.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QPair>
+#if QT_VERSION >= QT_VERSION_CHECK(5, 1, 0)
+#include <QSaveFile>
+#include <QStandardPaths>
+#endif
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+
+using namespace GammaRay;
+
+static const quint32 CacheMagic = 0x47524143; // "GRAC"
+static const quint32 CacheVersion = 3;
+static const int MaximumEntries = 4096;
+
+Q_GLOBAL_STATIC(ProbeABICache, s_probeABICache)
+
+ProbeABICache::MappedFile::MappedFile()
+    : m_begin(Q_NULLPTR)
+    , m_size(0)
+    , m_records(Q_NULLPTR)
+    , m_recordCount(0)
+{
+}
+
+bool ProbeABICache::MappedFile::open(const QString &fileName)
+{
+    close();
+    m_file.setFileName(fileName);
+    if (!m_file.open(QFile::ReadOnly) || m_file.size() < qint64(sizeof(FileHeader)))
+        return false;
+    m_begin = m_file.map(0, m_file.size());
+    if (!m_begin) {
+        close();
+        return false;
+    }
+    m_size = m_file.size();
+
+    FileHeader header;
+    memcpy(&header, m_begin, sizeof(header));
+    if (header.magic != CacheMagic || header.version != CacheVersion
+        || header.buildId != buildId()
+        || sizeof(FileHeader) + quint64(header.recordCount) * sizeof(FileRecord) > m_size) {
+        close();
+        return false;
+    }
+
+    m_records = reinterpret_cast<const FileRecord *>(m_begin + sizeof(FileHeader));
+    m_recordCount = header.recordCount;
+    return true;
+}
+
+void ProbeABICache::MappedFile::close()
+{
+    // unmapping is implied by closing
+    m_file.close();
+    m_begin = Q_NULLPTR;
+    m_size = 0;
+    m_records = Q_NULLPTR;
+    m_recordCount = 0;
+}
+
+QByteArray ProbeABICache::MappedFile::string(quint32 offset, quint32 length) const
+{
+    if (quint64(offset) + length > m_size)
+        return QByteArray();
+    return QByteArray::fromRawData(reinterpret_cast<const char *>(m_begin + offset), length);
+}
+
+bool ProbeABICache::MappedFile::toEntry(const FileRecord &record, Entry &entry) const
+{
+    entry.key = QString::fromUtf8(string(record.keyOffset, record.keyLength));
+    entry.path = QString::fromUtf8(string(record.pathOffset, record.pathLength));
+    entry.fileId.inode = record.inode;
+    entry.fileId.size = record.size;
+    entry.fileId.lastModified = record.lastModified;
+    entry.value = QString::fromUtf8(string(record.valueOffset, record.valueLength));
+    return deserializeDependencies(QString::fromUtf8(string(record.dependenciesOffset,
+                                                            record.dependenciesLength)),
+                                   entry.dependencies);
+}
+
+bool ProbeABICache::MappedFile::find(const QString &key, Entry &entry) const
+{
+    if (!m_records)
+        return false;
+
+    const QByteArray utf8Key = key.toUtf8();
+    const quint64 hash = keyHash(utf8Key);
+    const FileRecord *end = m_records + m_recordCount;
+    const FileRecord *it = std::lower_bound(m_records, end, hash,
+                                            [](const FileRecord &record, quint64 value) {
+        return record.keyHash < value;
+    });
+    for (; it != end && it->keyHash == hash; ++it) {
+        if (string(it->keyOffset, it->keyLength) == utf8Key)
+            return toEntry(*it, entry);
+    }
+    return false;
+}
+
+QVector<ProbeABICache::Entry> ProbeABICache::MappedFile::entries() const
+{
+    QVector<Entry> entries;
+    entries.reserve(m_recordCount);
+    for (quint32 i = 0; i < m_recordCount; ++i) {
+        Entry entry;
+        if (toEntry(m_records[i], entry))
+            entries.push_back(entry);
+    }
+    return entries;
+}
+
+ProbeABICache::ProbeABICache()
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 1, 0)
+    const QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation);
+    if (!cacheDir.isEmpty())
+        m_fileName = cacheDir + QLatin1String("/gammaray/probeabi.cache");
+#endif
+    if (!m_fileName.isEmpty())
+        m_mappedFile.open(m_fileName);
+}
+
+ProbeABICache::ProbeABICache(const QString &fileName)
+    : m_fileName(fileName)
+{
+    m_mappedFile.open(m_fileName);
+}
+
+ProbeABICache::~ProbeABICache()
+{
+    save();
+}
+
+ProbeABICache *ProbeABICache::instance()
+{
+    return s_probeABICache();
+}
+
+QString ProbeABICache::key(Type type, const QString &path, const QString &context)
+{
+    return QString::number(type) + QLatin1Char('\t') + path + QLatin1Char('\t') + context;
+}
+
+quint64 ProbeABICache::keyHash(const QByteArray &key)
+{
+    // FNV-1a, qHash() is not stable across processes
+    quint64 hash = Q_UINT64_C(14695981039346656037);
+    for (int i = 0; i < key.size(); ++i) {
+        hash ^= uchar(key.at(i));
+        hash *= Q_UINT64_C(1099511628211);
+    }
+    return hash;
+}
+
+quint64 ProbeABICache::buildId()
+{
+    // a different GammaRay build might come with different detection results or probes
+    return keyHash(QByteArray(GAMMARAY_PLUGIN_VERSION "-" GAMMARAY_PROBE_ABI));
+}
+
+ProbeABICache::FileId ProbeABICache::fileIdForPath(const QString &path)
+{
+    FileId id;
+    const QFileInfo fi(path);
+    if (!fi.exists())
+        return id;
+    id.size = fi.size();
+    id.lastModified = fi.lastModified().toMSecsSinceEpoch();
+#ifdef Q_OS_UNIX
+    struct stat statBuffer;
+    if (stat(QFile::encodeName(path).constData(), &statBuffer) == 0)
+        id.inode = statBuffer.st_ino;
+#endif
+    return id;
+}
+
+bool ProbeABICache::isValid(const Entry &entry)
+{
+    if (!(entry.fileId == fileIdForPath(entry.path)))
+        return false;
+    foreach (const Dependency &dependency, entry.dependencies) {
+        if (!(dependency.fileId == fileIdForPath(dependency.path)))
+            return false;
+    }
+    return true;
+}
+
+// one line per dependency, with tab separated inode, size, modification time and path
+QString ProbeABICache::serializeDependencies(const QVector<Dependency> &dependencies)
+{
+    QStringList lines;
+    foreach (const Dependency &dependency, dependencies) {
+        lines.push_back(QString::number(dependency.fileId.inode) + QLatin1Char('\t')
+                        + QString::number(dependency.fileId.size) + QLatin1Char('\t')
+                        + QString::number(dependency.fileId.lastModified) + QLatin1Char('\t')
+                        + dependency.path);
+    }
+    return lines.join(QStringLiteral("\n"));
+}
+
+bool ProbeABICache::deserializeDependencies(const QString &data,
+                                            QVector<Dependency> &dependencies)
+{
+    dependencies.clear();
+    if (data.isEmpty())
+        return true;
+
+    foreach (const QString &line, data.split(QLatin1Char('\n'))) {
+        const QStringList fields = line.split(QLatin1Char('\t'));
+        if (fields.size() != 4)
+            return false;
+        bool inodeOk, sizeOk, lastModifiedOk;
+        Dependency dependency;
+        dependency.fileId.inode = fields.at(0).toULongLong(&inodeOk);
+        dependency.fileId.size = fields.at(1).toLongLong(&sizeOk);
+        dependency.fileId.lastModified = fields.at(2).toLongLong(&lastModifiedOk);
+        dependency.path = fields.at(3);
+        if (!inodeOk || !sizeOk || !lastModifiedOk || dependency.path.isEmpty())
+            return false;
+        dependencies.push_back(dependency);
+    }
+    return true;
+}
+
+QString ProbeABICache::value(Type type, const QString &path, const QString &context) const
+{
+    const QString k = key(type, path, context);
+    Entry entry;
+    {
+        QMutexLocker lock(&m_mutex);
+        const QHash<QString, Entry>::const_iterator it = m_modifiedEntries.constFind(k);
+        if (it != m_modifiedEntries.constEnd())
+            entry = it.value();
+        else if (!m_mappedFile.find(k, entry))
+            return QString();
+    }
+
+    if (!isValid(entry))
+        return QString();
+    return entry.value;
+}
+
+void ProbeABICache::setValue(Type type, const QString &path, const QString &value,
+                             const QString &context, const QStringList &dependencies)
+{
+    Entry entry;
+    entry.key = key(type, path, context);
+    entry.path = path;
+    entry.fileId = fileIdForPath(path);
+    entry.value = value;
+    if (entry.fileId.size < 0)
+        return;
+    entry.dependencies.reserve(dependencies.size());
+    foreach (const QString &dependencyPath, dependencies) {
+        Dependency dependency;
+        dependency.path = dependencyPath;
+        dependency.fileId = fileIdForPath(dependencyPath);
+        entry.dependencies.push_back(dependency);
+    }
+
+    QMutexLocker lock(&m_mutex);
+    m_modifiedEntries.insert(entry.key, entry);
+}
+
+void ProbeABICache::save()
+{
+    QMutexLocker lock(&m_mutex);
+    if (m_fileName.isEmpty() || m_modifiedEntries.isEmpty())
+        return;
+
+    // other launcher instances might have updated the file meanwhile, merge with the latest
+    // version, and drop what got invalidated instead of carrying it along forever
+    QVector<Entry> entries;
+    {
+        MappedFile current;
+        current.open(m_fileName);
+        foreach (const Entry &entry, current.entries()) {
+            if (!m_modifiedEntries.contains(entry.key) && isValid(entry))
+                entries.push_back(entry);
+        }
+    }
+    if (entries.size() + m_modifiedEntries.size() > MaximumEntries)
+        entries.resize(std::max(0, MaximumEntries - m_modifiedEntries.size()));
+    foreach (const Entry &entry, m_modifiedEntries)
+        entries.push_back(entry);
+
+    m_mappedFile.close();
+    if (write(entries))
+        m_modifiedEntries.clear();
+    m_mappedFile.open(m_fileName);
+}
+
+bool ProbeABICache::write(const QVector<Entry> &entries)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 1, 0)
+    QVector<QPair<quint64, int> > order;
+    order.reserve(entries.size());
+    for (int i = 0; i < entries.size(); ++i)
+        order.push_back(qMakePair(keyHash(entries.at(i).key.toUtf8()), i));
+    std::sort(order.begin(), order.end());
+
+    QVector<FileRecord> records;
+    records.reserve(entries.size());
+    QByteArray strings;
+    const quint32 stringsOffset = sizeof(FileHeader) + entries.size() * sizeof(FileRecord);
+    auto addString = [&strings, stringsOffset](const QString &str, quint32 &offset,
+                                               quint32 &length) {
+        const QByteArray utf8 = str.toUtf8();
+        offset = stringsOffset + strings.size();
+        length = utf8.size();
+        strings += utf8;
+    };
+
+    for (int i = 0; i < order.size(); ++i) {
+        const Entry &entry = entries.at(order.at(i).second);
+        FileRecord record;
+        memset(&record, 0, sizeof(record));
+        record.keyHash = order.at(i).first;
+        record.inode = entry.fileId.inode;
+        record.size = entry.fileId.size;
+        record.lastModified = entry.fileId.lastModified;
+        addString(entry.key, record.keyOffset, record.keyLength);
+        addString(entry.path, record.pathOffset, record.pathLength);
+        addString(entry.value, record.valueOffset, record.valueLength);
+        addString(serializeDependencies(entry.dependencies), record.dependenciesOffset,
+                  record.dependenciesLength);
+        records.push_back(record);
+    }
+
+    FileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = CacheMagic;
+    header.version = CacheVersion;
+    header.buildId = buildId();
+    header.recordCount = records.size();
+
+    QDir().mkpath(QFileInfo(m_fileName).absolutePath());
+    QSaveFile file(m_fileName);
+    if (!file.open(QFile::WriteOnly))
+        return false;
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(records.constData()),
+               records.size() * sizeof(FileRecord));
+    file.write(strings);
+    return file.commit();
+#else
+    Q_UNUSED(entries);
+    return false;
+#endif
+}
@@ -0,0 +1,187 @@
+/*
+  probeabicache.h
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2015-2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Volker Krause <volker.krause@kdab.com>
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef GAMMARAY_PROBEABICACHE_H
+#define GAMMARAY_PROBEABICACHE_H
+
+#include "gammaray_launcher_export.h"
+
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+namespace GammaRay {
+/** Persistent cache for the expensive parts of the probe ABI detection and probe lookup.
+ *
+ *  Entries are keyed by the path of the inspected file or directory, and are only valid
+ *  as long as its inode, size and modification time do not change. The same applies to
+ *  the optional dependencies of an entry, for results derived from more than one file
+ *  (e.g. the content of sub-directories, which doesn't touch the parent directory).
+ *  The cache is shared between launcher runs via a file in the user's cache directory.
+ *  That file is memory mapped and looked up in place, modifications are merged into it
+ *  by save(), or on destruction at the latest, by atomically replacing it. Entries of a
+ *  different GammaRay version are ignored.
+ */
+class GAMMARAY_LAUNCHER_EXPORT ProbeABICache
+{
+public:
+    enum Type {
+        QtCoreForExecutable,
+        ABIForQtCore,
+        ABIsForProbeDirectory,
+        ProbeForABI
+    };
+
+    ProbeABICache();
+    /** Uses @p fileName instead of the default location, mainly for testing. */
+    explicit ProbeABICache(const QString &fileName);
+    ~ProbeABICache();
+
+    static ProbeABICache *instance();
+
+    /** Returns the cached value for @p path, or a null string if there is none
+     *  or @p path has been modified since.
+     *  @p context allows to distinguish results depending on more than just the file.
+     */
+    QString value(Type type, const QString &path, const QString &context = QString()) const;
+    /** Stores @p value for @p path, which is invalidated as soon as @p path or any of
+     *  @p dependencies is modified.
+     */
+    void setValue(Type type, const QString &path, const QString &value,
+                  const QString &context = QString(),
+                  const QStringList &dependencies = QStringList());
+
+    /** Merges our modifications into the cache file. */
+    void save();
+
+private:
+    Q_DISABLE_COPY(ProbeABICache)
+
+    struct FileId
+    {
+        FileId()
+            : inode(0)
+            , size(-1)
+            , lastModified(-1)
+        {
+        }
+
+        bool operator==(const FileId &other) const
+        {
+            return inode == other.inode && size == other.size
+                   && lastModified == other.lastModified;
+        }
+
+        quint64 inode;
+        qint64 size;
+        qint64 lastModified;
+    };
+
+    struct Dependency
+    {
+        QString path;
+        FileId fileId;
+    };
+
+    struct Entry
+    {
+        QString key;
+        QString path;
+        FileId fileId;
+        QString value;
+        QVector<Dependency> dependencies;
+    };
+
+    // on-disk layout, a header followed by records sorted by key hash and the string data
+    struct FileHeader
+    {
+        quint32 magic;
+        quint32 version;
+        quint64 buildId;
+        quint32 recordCount;
+        quint32 reserved;
+    };
+
+    struct FileRecord
+    {
+        quint64 keyHash;
+        quint64 inode;
+        qint64 size;
+        qint64 lastModified;
+        quint32 keyOffset;
+        quint32 keyLength;
+        quint32 pathOffset;
+        quint32 pathLength;
+        quint32 valueOffset;
+        quint32 valueLength;
+        quint32 dependenciesOffset;
+        quint32 dependenciesLength;
+    };
+
+    /** Read-only view on a mapped cache file. */
+    class MappedFile
+    {
+    public:
+        MappedFile();
+        bool open(const QString &fileName);
+        void close();
+        bool find(const QString &key, Entry &entry) const;
+        QVector<Entry> entries() const;
+
+    private:
+        Q_DISABLE_COPY(MappedFile)
+        QByteArray string(quint32 offset, quint32 length) const;
+        bool toEntry(const FileRecord &record, Entry &entry) const;
+
+        QFile m_file;
+        const uchar *m_begin;
+        quint64 m_size;
+        const FileRecord *m_records;
+        quint32 m_recordCount;
+    };
+
+    static QString key(Type type, const QString &path, const QString &context);
+    static quint64 keyHash(const QByteArray &key);
+    static quint64 buildId();
+    static FileId fileIdForPath(const QString &path);
+    static bool isValid(const Entry &entry);
+    static QString serializeDependencies(const QVector<Dependency> &dependencies);
+    static bool deserializeDependencies(const QString &data,
+                                        QVector<Dependency> &dependencies);
+    bool write(const QVector<Entry> &entries);
+
+    mutable QMutex m_mutex;
+    QString m_fileName;
+    MappedFile m_mappedFile;
+    QHash<QString, Entry> m_modifiedEntries;
+};
+}
+
+#endif // GAMMARAY_PROBEABICACHE_H
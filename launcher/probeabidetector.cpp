@@ -29,6 +29,7 @@
 #include <config-gammaray.h>
 
 #include "probeabidetector.h"
+#include "probeabicache.h"
 
 #include <QFileInfo>
 #include <QProcess>
@@ -63,7 +64,16 @@ ProbeABI ProbeABIDetector::abiForQtCore(const QString &path) const
     if (it != m_abiForQtCoreCache.constEnd())
         return it.value();
 
-    const ProbeABI abi = detectAbiForQtCore(fi.canonicalFilePath());
+    // results of previous launcher runs
+    ProbeABI abi = ProbeABI::fromString(ProbeABICache::instance()->value(
+                                            ProbeABICache::ABIForQtCore, fi.canonicalFilePath()));
+    if (!abi.isValid()) {
+        abi = detectAbiForQtCore(fi.canonicalFilePath());
+        if (abi.isValid()) {
+            ProbeABICache::instance()->setValue(ProbeABICache::ABIForQtCore,
+                                                fi.canonicalFilePath(), abi.id());
+        }
+    }
     m_abiForQtCoreCache.insert(fi.canonicalFilePath(), abi);
     return abi;
 }
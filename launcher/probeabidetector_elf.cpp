@@ -30,10 +30,17 @@
 
 #include "probeabidetector.h"
 #include "probeabi.h"
+#include "probeabicache.h"
+#ifdef HAVE_ELF
+#include "elffile.h"
+#endif
 
 #include <QDebug>
 #include <QFile>
+#include <QFileInfo>
+#include <QHash>
 #include <QProcess>
+#include <QSet>
 #include <QString>
 #include <QStringList>
 
@@ -45,9 +52,198 @@
 #include <sys/elf.h>
 #endif
 
+#include <cstring>
+
 using namespace GammaRay;
 
-static QString qtCoreFromLdd(const QString &path)
+#ifdef HAVE_ELF
+namespace {
+/** The library lookup table ldconfig generates, the new format only. */
+class LdSoCache
+{
+public:
+    LdSoCache();
+    QStringList paths(const QByteArray &soName) const;
+
+private:
+    QHash<QByteArray, QStringList> m_libraries;
+};
+}
+
+Q_GLOBAL_STATIC(LdSoCache, s_ldSoCache)
+
+LdSoCache::LdSoCache()
+{
+    QFile f(QStringLiteral("/etc/ld.so.cache"));
+    if (!f.open(QFile::ReadOnly))
+        return;
+    const char *data = reinterpret_cast<const char *>(f.map(0, f.size()));
+    const quint64 size = f.size();
+    if (!data)
+        return;
+
+    // the new format might be appended to an old format table
+    static const char oldMagic[] = "ld.so-1.7.0";
+    static const char newMagic[] = "glibc-ld.so.cache1.1";
+    enum {
+        OldHeaderSize = 16, OldEntrySize = 12,
+        NewHeaderSize = 48, NewEntrySize = 24
+    };
+    quint64 offset = 0;
+    if (size >= OldHeaderSize && memcmp(data, oldMagic, sizeof(oldMagic) - 1) == 0) {
+        quint32 count;
+        memcpy(&count, data + 12, sizeof(count));
+        offset = (OldHeaderSize + quint64(count) * OldEntrySize + 7) & ~quint64(7);
+    }
+    if (offset + NewHeaderSize > size || memcmp(data + offset, newMagic, sizeof(newMagic) - 1) != 0)
+        return;
+
+    // string offsets are relative to the start of the new format table
+    const char *table = data + offset;
+    const quint64 tableSize = size - offset;
+    auto stringAt = [table, tableSize](quint32 pos) -> const char * {
+        if (pos >= tableSize || !memchr(table + pos, 0, tableSize - pos))
+            return Q_NULLPTR;
+        return table + pos;
+    };
+
+    quint32 count;
+    memcpy(&count, table + 20, sizeof(count));
+    for (quint64 i = 0; i < count && NewHeaderSize + (i + 1) * NewEntrySize <= tableSize; ++i) {
+        const char *entry = table + NewHeaderSize + i * NewEntrySize;
+        quint32 key, value;
+        memcpy(&key, entry + 4, sizeof(key));
+        memcpy(&value, entry + 8, sizeof(value));
+        const char *soName = stringAt(key);
+        const char *path = stringAt(value);
+        if (soName && path)
+            m_libraries[QByteArray(soName)].push_back(QString::fromLocal8Bit(path));
+    }
+}
+
+QStringList LdSoCache::paths(const QByteArray &soName) const
+{
+    return m_libraries.value(soName);
+}
+
+static QStringList expandSearchPaths(const QList<QByteArray> &paths, const QString &origin)
+{
+    QStringList result;
+    foreach (const QByteArray &path, paths) {
+        QString expanded = QString::fromLocal8Bit(path);
+        expanded.replace(QLatin1String("${ORIGIN}"), origin);
+        expanded.replace(QLatin1String("$ORIGIN"), origin);
+        result.push_back(expanded);
+    }
+    return result;
+}
+
+static bool isCompatibleLibrary(const QString &path, const ElfFile &executable)
+{
+    if (!QFile::exists(path))
+        return false;
+    const ElfFile lib(path);
+    return lib.isValid() && lib.elfClass() == executable.elfClass()
+           && lib.machine() == executable.machine();
+}
+
+/** Resolves a DT_NEEDED entry the same way ld.so does, see ld.so(8). */
+static QString resolveLibrary(const QByteArray &name, const ElfFile &executable,
+                              const QStringList &rpath, const QStringList &runpath)
+{
+    if (name.contains('/')) {
+        const QString path = QString::fromLocal8Bit(name);
+        return isCompatibleLibrary(path, executable) ? QFileInfo(path).absoluteFilePath() : QString();
+    }
+
+    QStringList searchPaths = rpath;
+    foreach (const QByteArray &path, qgetenv("LD_LIBRARY_PATH").split(':')) {
+        if (!path.isEmpty())
+            searchPaths.push_back(QString::fromLocal8Bit(path));
+    }
+    searchPaths += runpath;
+    foreach (const QString &searchPath, searchPaths) {
+        const QString path = searchPath + QLatin1Char('/') + QString::fromLocal8Bit(name);
+        if (isCompatibleLibrary(path, executable))
+            return path;
+    }
+
+    foreach (const QString &path, s_ldSoCache()->paths(name)) {
+        if (isCompatibleLibrary(path, executable))
+            return path;
+    }
+
+    QStringList defaultPaths;
+    if (executable.elfClass() == ELFCLASS64)
+        defaultPaths << QStringLiteral("/lib64") << QStringLiteral("/usr/lib64");
+    defaultPaths << QStringLiteral("/lib") << QStringLiteral("/usr/lib");
+    foreach (const QString &defaultPath, defaultPaths) {
+        const QString path = defaultPath + QLatin1Char('/') + QString::fromLocal8Bit(name);
+        if (isCompatibleLibrary(path, executable))
+            return path;
+    }
+
+    return QString();
+}
+
+/** @p dependencies receives the libraries looked at, they affect the result as well. */
+static QString qtCoreFromElf(const QString &path, QStringList &dependencies)
+{
+    const ElfFile executable(path);
+    if (!executable.isValid())
+        return QString();
+
+    // breadth first through the dependencies, DT_RPATH is inherited from the loading objects,
+    // a DT_RUNPATH only hides it for the lookups of the object that has it
+    struct Dependency {
+        QString path;
+        QStringList inheritedRPath;
+    };
+    QList<Dependency> pending;
+    pending.push_back(Dependency());
+    pending.last().path = path;
+    QSet<QString> visited;
+
+    while (!pending.isEmpty()) {
+        const Dependency dep = pending.takeFirst();
+        const ElfFile elf(dep.path);
+        if (!elf.isValid())
+            continue;
+
+        const QString origin = QFileInfo(dep.path).absolutePath();
+        const QStringList runpath = expandSearchPaths(elf.runpath(), origin);
+        // ld.so ignores the own DT_RPATH of an object that has a DT_RUNPATH
+        QStringList rpathChain = dep.inheritedRPath;
+        if (runpath.isEmpty())
+            rpathChain = expandSearchPaths(elf.rpath(), origin) + rpathChain;
+        const QStringList rpath = runpath.isEmpty() ? rpathChain : QStringList();
+
+        const QList<QByteArray> needed = elf.neededLibraries();
+        foreach (const QByteArray &name, needed) {
+            if (ProbeABIDetector::containsQtCore(name)) {
+                dependencies = visited.toList();
+                return resolveLibrary(name, executable, rpath, runpath);
+            }
+        }
+
+        foreach (const QByteArray &name, needed) {
+            const QString libPath = resolveLibrary(name, executable, rpath, runpath);
+            if (libPath.isEmpty() || visited.contains(libPath))
+                continue;
+            visited.insert(libPath);
+            pending.push_back(Dependency());
+            pending.last().path = libPath;
+            pending.last().inheritedRPath = rpathChain;
+        }
+    }
+
+    dependencies = visited.toList();
+    return QString();
+}
+#endif
+
+/** @p dependencies receives the libraries ld.so resolved before QtCore. */
+static QString qtCoreFromLdd(const QString &path, QStringList &dependencies)
 {
     QProcess proc;
     proc.setProcessChannelMode(QProcess::SeparateChannels);
@@ -60,13 +256,14 @@ static QString qtCoreFromLdd(const QString &path)
         if (line.isEmpty())
             break;
 
-        if (ProbeABIDetector::containsQtCore(line)) {
-            const int begin = line.indexOf("=> ");
-            const int end = line.lastIndexOf(" (");
-            if (begin <= 0 || end <= 0 || end <= begin)
-                continue;
-            return QString::fromLocal8Bit(line.mid(begin + 3, end - begin - 3).trimmed());
-        }
+        const int begin = line.indexOf("=> ");
+        const int end = line.lastIndexOf(" (");
+        if (begin <= 0 || end <= 0 || end <= begin)
+            continue;
+        const QByteArray libPath = line.mid(begin + 3, end - begin - 3).trimmed();
+        if (ProbeABIDetector::containsQtCore(line))
+            return QString::fromLocal8Bit(libPath);
+        dependencies.push_back(QString::fromLocal8Bit(libPath));
     }
 
     return QString();
@@ -74,8 +271,31 @@ static QString qtCoreFromLdd(const QString &path)
 
 QString ProbeABIDetector::qtCoreForExecutable(const QString &path) const
 {
-    // TODO: add fast version reading the ELF file directly?
-    return qtCoreFromLdd(path);
+    // the result depends on the library search path too
+    const QString context = QString::fromLocal8Bit(qgetenv("LD_LIBRARY_PATH"));
+    QString qtCorePath = ProbeABICache::instance()->value(ProbeABICache::QtCoreForExecutable,
+                                                          path, context);
+    if (!qtCorePath.isEmpty() && QFile::exists(qtCorePath))
+        return qtCorePath;
+
+    QStringList dependencies;
+#ifdef HAVE_ELF
+    qtCorePath = qtCoreFromElf(path, dependencies);
+    // ld.so knows better in the corner cases we don't cover, e.g. hwcap sub-directories
+    if (qtCorePath.isEmpty()) {
+        dependencies.clear();
+        qtCorePath = qtCoreFromLdd(path, dependencies);
+    }
+#else
+    qtCorePath = qtCoreFromLdd(path, dependencies);
+#endif
+    if (!qtCorePath.isEmpty()) {
+        // any library on the way, or a re-run of ldconfig, might change where QtCore comes from
+        dependencies.push_back(QStringLiteral("/etc/ld.so.cache"));
+        ProbeABICache::instance()->setValue(ProbeABICache::QtCoreForExecutable, path, qtCorePath,
+                                            context, dependencies);
+    }
+    return qtCorePath;
 }
 
 static bool qtCoreFromProc(qint64 pid, QString &path)
@@ -146,56 +366,58 @@ static ProbeABI qtVersionFromExec(const QString &path)
 }
 
 #ifdef HAVE_ELF
-template<typename ElfEHdr>
-static QString archFromELFHeader(const uchar *data, quint64 size)
+static ProbeABI qtVersionFromElf(const ElfFile &f)
 {
-    if (size <= sizeof(ElfEHdr))
-        return QString();
-    const ElfEHdr *hdr = reinterpret_cast<const ElfEHdr *>(data);
-
-    switch (hdr->e_machine) {
-    case EM_386:
-        return QStringLiteral("i686");
-#ifdef EM_X86_64
-    case EM_X86_64:
-        return QStringLiteral("x86_64");
-#endif
-    case EM_ARM:
-        return QStringLiteral("arm");
+    ProbeABI abi;
+    if (!f.isValid())
+        return abi;
+
+    // qt_core_boilerplate(), "This is the QtCore library version [Qt ]X.Y.Z ...", see qtVersionFromExec()
+    static const char marker[] = "QtCore library version ";
+    const QByteArray data = f.data();
+    int pos = data.indexOf(marker);
+    if (pos >= 0) {
+        pos += sizeof(marker) - 1;
+        if (data.mid(pos, 3) == "Qt ")
+            pos += 3;
+        const QList<QByteArray> version = data.mid(pos, 16).split('.');
+        bool majorOk = false, minorOk = false;
+        if (version.size() >= 3) {
+            const int major = version.at(0).toInt(&majorOk);
+            const int minor = version.at(1).toInt(&minorOk);
+            if (majorOk && minorOk) {
+                abi.setQtVersion(major, minor);
+                return abi;
+            }
+        }
     }
 
-    qWarning() << "Unsupported ELF machine type:" << hdr->e_machine;
-    return QString();
+    // symbol versions, such as Qt_5.6 or Qt_5.6.0_PRIVATE_API
+    int major = -1, minor = -1;
+    foreach (const QByteArray &name, f.versionDefinitions()) {
+        if (!name.startsWith("Qt_"))
+            continue;
+        const QList<QByteArray> version = name.mid(3).split('.');
+        if (version.size() < 2)
+            continue;
+        bool majorOk = false, minorOk = false;
+        const int m = version.at(0).toInt(&majorOk);
+        QByteArray minorStr = version.at(1);
+        if (minorStr.indexOf('_') >= 0)
+            minorStr.truncate(minorStr.indexOf('_'));
+        const int n = minorStr.toInt(&minorOk);
+        if (majorOk && minorOk && (m > major || (m == major && n > minor))) {
+            major = m;
+            minor = n;
+        }
+    }
+    if (major >= 0)
+        abi.setQtVersion(major, minor);
+    return abi;
 }
 
 #endif
 
-static QString archFromELF(const QString &path)
-{
-#ifdef HAVE_ELF
-    QFile f(path);
-    if (!f.open(QFile::ReadOnly))
-        return QString();
-
-    const uchar *data = f.map(0, f.size());
-    if (!data || f.size() < EI_NIDENT)
-        return QString();
-
-    if (qstrncmp(reinterpret_cast<const char *>(data), ELFMAG, SELFMAG) != 0) // no ELF signature
-        return QString();
-
-    switch (data[EI_CLASS]) {
-    case ELFCLASS32:
-        return archFromELFHeader<Elf32_Ehdr>(data, f.size());
-    case ELFCLASS64:
-        return archFromELFHeader<Elf64_Ehdr>(data, f.size());
-    }
-#else
-    Q_UNUSED(path);
-#endif
-    return QString();
-}
-
 ProbeABI ProbeABIDetector::detectAbiForQtCore(const QString &path) const
 {
     if (path.isEmpty())
@@ -203,12 +425,18 @@ ProbeABI ProbeABIDetector::detectAbiForQtCore(const QString &path) const
 
     // try to find the version
     ProbeABI abi = qtVersionFromFileName(path);
+#ifdef HAVE_ELF
+    const ElfFile f(path);
+    if (!abi.hasQtVersion())
+        abi = qtVersionFromElf(f);
+#endif
     if (!abi.hasQtVersion())
         abi = qtVersionFromExec(path);
 
     // TODO: architecture detection fallback without elf.h?
-    const QString arch = archFromELF(path);
-    abi.setArchitecture(arch);
+#ifdef HAVE_ELF
+    abi.setArchitecture(f.architecture());
+#endif
 
     return abi;
 }
@@ -30,6 +30,7 @@
 #include "probefinder.h"
 #include "probeabi.h"
 #include "probeabidetector.h"
+#include "probeabicache.h"
 
 #include <common/paths.h>
 
@@ -60,12 +61,24 @@ static QString findProbeInternal(const ProbeABI &probeAbi, const QString &rootPa
                               Paths::libraryExtension();
 
     const QFileInfo wildcarded(probePath);
+
+    // the cached result is valid as long as neither the probe directory content nor the
+    // probe itself changes
+    const QString cachedPath = ProbeABICache::instance()->value(ProbeABICache::ProbeForABI,
+                                                                wildcarded.absolutePath(),
+                                                                wildcarded.fileName());
+    if (!cachedPath.isEmpty() && QFileInfo(cachedPath).isFile())
+        return cachedPath;
+
     const QFileInfo fi
         = QDir(wildcarded.absolutePath()).entryInfoList(QStringList(wildcarded.fileName())).
           value(0);
     const QString canonicalPath = fi.canonicalFilePath();
     if (!fi.isFile() || !fi.isReadable())
         return QString();
+    ProbeABICache::instance()->setValue(ProbeABICache::ProbeForABI, wildcarded.absolutePath(),
+                                        canonicalPath, wildcarded.fileName(),
+                                        QStringList(canonicalPath));
     return canonicalPath;
 }
 
@@ -118,6 +131,21 @@ QVector<ProbeABI> listProbeABIs()
 {
     QVector<ProbeABI> abis;
     const QDir dir(Paths::probePath(QString()));
+
+    const QString cachedIds = ProbeABICache::instance()->value(ProbeABICache::ABIsForProbeDirectory,
+                                                               dir.absolutePath());
+    if (!cachedIds.isEmpty()) {
+        foreach (const QString &id, cachedIds.split(QLatin1Char(';'))) {
+            const ProbeABI abi = ProbeABI::fromString(id);
+            if (abi.isValid())
+                abis.push_back(abi);
+        }
+        return abis;
+    }
+
+    // modifying the content of a sub-directory or a probe doesn't touch the probe directory,
+    // so the cached result depends on those as well
+    QStringList dependencies;
 #if defined(GAMMARAY_INSTALL_QT_LAYOUT)
     const QString filter = QStringLiteral("*gammaray_probe*");
     foreach (const QFileInfo &abiId, dir.entryInfoList(QStringList(filter), QDir::Files)) {
@@ -125,17 +153,29 @@ QVector<ProbeABI> listProbeABIs()
         if (!QLibrary::isLibrary(abiId.fileName())
             && !abiId.fileName().endsWith(Paths::libraryExtension(), Qt::CaseInsensitive))
             continue;
+        dependencies.push_back(abiId.absoluteFilePath());
         const ProbeABI abi = ProbeABI::fromString(abiId.baseName().section(QStringLiteral("-"), 1));
         if (abi.isValid())
             abis.push_back(abi);
     }
 #else
+    const QStringList probeFilter(QLatin1String(GAMMARAY_PROBE_BASENAME "*"));
     foreach (const QString &abiId, dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        const QDir abiDir(dir.absoluteFilePath(abiId));
+        dependencies.push_back(abiDir.absolutePath());
+        foreach (const QFileInfo &probe, abiDir.entryInfoList(probeFilter, QDir::Files))
+            dependencies.push_back(probe.absoluteFilePath());
         const ProbeABI abi = ProbeABI::fromString(abiId);
         if (abi.isValid())
             abis.push_back(abi);
     }
 #endif
+
+    QStringList ids;
+    foreach (const ProbeABI &abi, abis)
+        ids.push_back(abi.id());
+    ProbeABICache::instance()->setValue(ProbeABICache::ABIsForProbeDirectory, dir.absolutePath(),
+                                        ids.join(QStringLiteral(";")), QString(), dependencies);
     return abis;
 }
 }
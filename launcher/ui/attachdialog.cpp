@@ -30,6 +30,7 @@
 #include "attachdialog.h"
 
 #include "launchoptions.h"
+#include "probeabicache.h"
 #include "processfiltermodel.h"
 #include "processmodel.h"
 #include "probeabimodel.h"
@@ -159,6 +160,8 @@ void AttachDialog::updateProcessesFinished()
     if (oldPid != pid())
         ui.view->setCurrentIndex(QModelIndex());
     watcher->deleteLater();
+    // new processes might have needed ABI detection, a no-op otherwise
+    ProbeABICache::instance()->save();
 
     QTimer::singleShot(1000, this, SLOT(updateProcesses()));
 }
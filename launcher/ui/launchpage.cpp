@@ -30,6 +30,7 @@
 #include "launchpage.h"
 #include "ui_launchpage.h"
 #include "launchoptions.h"
+#include "probeabicache.h"
 #include "probefinder.h"
 #include "probeabimodel.h"
 
@@ -190,6 +191,7 @@ void LaunchPage::updateArgumentButtons()
 void LaunchPage::detectABI(const QString &path)
 {
     const ProbeABI abi = m_abiDetector.abiForExecutable(path);
+    ProbeABICache::instance()->save();
     const int index = m_abiModel->indexOfBestMatchingABI(abi);
     if (index >= 0)
         ui->probeBox->setCurrentIndex(index);
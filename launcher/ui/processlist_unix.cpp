@@ -34,23 +34,93 @@
 
 #include <launcher/probeabidetector.h>
 
+#include <QHash>
+#include <QMutex>
 #include <QProcess>
-#include <QDir>
+#include <QVarLengthArray>
 
 #include <algorithm>
+#include <cstring>
 #include <functional>
 
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pwd.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 static GammaRay::ProbeABIDetector s_abiDetector;
 
-static bool isUnixProcessId(const QString &procname)
+static bool isUnixProcessId(const char *procname)
 {
-    for (int i = 0; i != procname.size(); ++i) {
-        if (!procname.at(i).isDigit())
+    if (!*procname)
+        return false;
+    for (; *procname; ++procname) {
+        if (*procname < '0' || *procname > '9')
             return false;
     }
     return true;
 }
 
+namespace {
+// getpwuid_r is not exactly cheap, and there are usually only a handful of distinct users
+class UserNameCache
+{
+public:
+    QString userName(uid_t uid)
+    {
+        QMutexLocker lock(&m_mutex);
+        QHash<uid_t, QString>::const_iterator it = m_names.constFind(uid);
+        if (it != m_names.constEnd())
+            return it.value();
+
+        long bufferSize = sysconf(_SC_GETPW_R_SIZE_MAX);
+        if (bufferSize <= 0)
+            bufferSize = 16384;
+        QVarLengthArray<char, 1024> buffer(bufferSize);
+        struct passwd pwd;
+        struct passwd *result = 0;
+        QString name;
+        if (getpwuid_r(uid, &pwd, buffer.data(), buffer.size(), &result) == 0 && result)
+            name = QString::fromLocal8Bit(pwd.pw_name);
+        else
+            name = QString::number(uid);
+        m_names.insert(uid, name);
+        return name;
+    }
+
+private:
+    QMutex m_mutex;
+    QHash<uid_t, QString> m_names;
+};
+}
+
+Q_GLOBAL_STATIC(UserNameCache, s_userNames)
+
+// Reads the file @p name relative to @p dirFd into @p buffer, which is only ever grown
+// so it can be reused for all processes. Returns the number of bytes read, or -1.
+static int readProcFile(int dirFd, const char *name, QByteArray &buffer)
+{
+    const int fd = ::openat(dirFd, name, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+
+    int size = 0;
+    while (true) {
+        if (buffer.size() - size < 512)
+            buffer.resize(std::max(4096, buffer.size() * 2));
+        const ssize_t n = ::read(fd, buffer.data() + size, buffer.size() - size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        size += n;
+    }
+    ::close(fd);
+    return size;
+}
+
 struct PidAndNameMatch : public std::unary_function<ProcData, bool> {
     explicit PidAndNameMatch(const QString &ppid, const QString &name)
         : m_ppid(ppid)
@@ -120,49 +190,72 @@ static ProcDataList unixProcessListPS(const ProcDataList &previous)
 // it does not exist
 ProcDataList processList(const ProcDataList &previous)
 {
-    const QDir procDir(QStringLiteral("/proc/"));
-    if (!procDir.exists())
+    DIR *procDir = ::opendir("/proc");
+    if (!procDir)
         return unixProcessListPS(previous);
+    const int procFd = dirfd(procDir);
+
+    // ABI detection is by far the most expensive part, only do that for new processes
+    QHash<QString, int> previousIndex;
+    previousIndex.reserve(previous.size());
+    for (int i = 0; i < previous.size(); ++i)
+        previousIndex.insert(previous.at(i).ppid, i);
+
     ProcDataList rc;
-    const QStringList procIds = procDir.entryList();
-    if (procIds.isEmpty())
-        return rc;
-    foreach (const QString &procId, procIds) {
-        if (!isUnixProcessId(procId))
+    QByteArray buffer;
+    while (const dirent *entry = ::readdir(procDir)) {
+        if (!isUnixProcessId(entry->d_name))
+            continue;
+        const int pidFd = ::openat(procFd, entry->d_name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (pidFd < 0)
+            continue; // process may have exited
+
+        struct stat statBuffer;
+        const char *commBegin = 0;
+        const char *commEnd = 0;
+        if (::fstat(pidFd, &statBuffer) == 0) {
+            // "<pid> (<comm>) <state> <ppid> ...", comm can contain spaces and parentheses
+            const int size = readProcFile(pidFd, "stat", buffer);
+            if (size > 0) {
+                const char *data = buffer.constData();
+                commBegin = static_cast<const char *>(memchr(data, '(', size));
+                for (const char *c = data + size - 1; commBegin && c > commBegin; --c) {
+                    if (*c == ')') {
+                        if (c + 2 < data + size)
+                            commEnd = c;
+                        break;
+                    }
+                }
+            }
+        }
+        if (!commEnd) {
+            ::close(pidFd);
             continue;
-        QString filename = QStringLiteral("/proc/");
-        filename += procId;
-        filename += QLatin1String("/stat");
-        QFile file(filename);
-        if (!file.open(QIODevice::ReadOnly))
-            continue;     // process may have exited
-
-        const QStringList data = QString::fromLocal8Bit(file.readAll()).split(' ');
-        ProcData proc;
-        proc.ppid = procId;
-        proc.name = data.at(1);
-        if (proc.name.startsWith(QLatin1Char('(')) && proc.name.endsWith(QLatin1Char(')'))) {
-            proc.name.truncate(proc.name.size() - 1);
-            proc.name.remove(0, 1);
         }
-        proc.state = data.at(2);
-        // PPID is element 3
 
-        proc.user = QFileInfo(file).owner();
-        file.close();
+        ProcData proc;
+        proc.ppid = QString::fromLatin1(entry->d_name);
+        proc.state = QString(QLatin1Char(commEnd[2]));
+        proc.user = s_userNames()->userName(statBuffer.st_uid);
+        proc.name = QString::fromLocal8Bit(commBegin + 1, commEnd - commBegin - 1);
 
-        QFile cmdFile(QLatin1String("/proc/") + procId + QLatin1String("/cmdline"));
-        if (cmdFile.open(QFile::ReadOnly)) {
-            QByteArray cmd = cmdFile.readAll();
-            cmd.replace('\0', ' ');
+        const int size = readProcFile(pidFd, "cmdline", buffer);
+        ::close(pidFd);
+        if (size > 0) {
+            std::replace(buffer.data(), buffer.data() + size, '\0', ' ');
+            const QString cmd = QString::fromLocal8Bit(buffer.constData(), size).trimmed();
             if (!cmd.isEmpty())
-                proc.name = QString::fromLocal8Bit(cmd).trimmed();
+                proc.name = cmd;
         }
-        cmdFile.close();
 
-        proc.abi = s_abiDetector.abiForProcess(procId.toLongLong());
+        const QHash<QString, int>::const_iterator it = previousIndex.constFind(proc.ppid);
+        if (it != previousIndex.constEnd() && previous.at(it.value()).name == proc.name)
+            proc.abi = previous.at(it.value()).abi;
+        else
+            proc.abi = s_abiDetector.abiForProcess(proc.ppid.toLongLong());
 
         rc.push_back(proc);
     }
+    ::closedir(procDir);
     return rc;
 }
@@ -73,41 +73,54 @@ void ProcessModel::setProcesses(const ProcDataList &processes)
     endResetModel();
 }
 
+static bool hasSameContent(const ProcData &l, const ProcData &r)
+{
+    return l.name == r.name && l.image == r.image && l.state == r.state && l.user == r.user
+           && l.abi == r.abi;
+}
+
 void ProcessModel::mergeProcesses(const ProcDataList &processes)
 {
     // sort like m_data
     ProcDataList sortedProcesses = processes;
     std::stable_sort(sortedProcesses.begin(), sortedProcesses.end());
 
-    // iterator over m_data
-    int i = 0;
-
-    foreach (const ProcData &newProc, sortedProcesses) {
-        bool shouldInsert = true;
-        while (i < m_data.count()) {
-            const ProcData &oldProc = m_data.at(i);
-            if (oldProc < newProc) {
-                // remove old proc, seems to be outdated
-                beginRemoveRows(QModelIndex(), i, i);
-                m_data.removeAt(i);
-                endRemoveRows();
-                continue;
-            } else if (newProc == oldProc) {
-                // already contained, hence increment and break
-                ++i;
-                shouldInsert = false;
-                break;
-            } else { // newProc < oldProc
-                // new entry, break and insert it
-                break;
-            }
-        }
-        if (shouldInsert) {
-            beginInsertRows(QModelIndex(), i, i);
-            m_data.insert(i, newProc);
+    // walk both sorted lists at once, only exited and new processes cause row changes,
+    // and those are announced as runs of consecutive rows
+    int i = 0; // iterator over m_data
+    int j = 0; // iterator over sortedProcesses
+    while (i < m_data.size() || j < sortedProcesses.size()) {
+        const bool oldAtEnd = i == m_data.size();
+        const bool newAtEnd = j == sortedProcesses.size();
+        if (newAtEnd || (!oldAtEnd && m_data.at(i) < sortedProcesses.at(j))) {
+            // remove old procs, seems they are outdated
+            int last = i;
+            while (last + 1 < m_data.size()
+                   && (j == sortedProcesses.size() || m_data.at(last + 1) < sortedProcesses.at(j)))
+                ++last;
+            beginRemoveRows(QModelIndex(), i, last);
+            m_data.erase(m_data.begin() + i, m_data.begin() + last + 1);
+            endRemoveRows();
+        } else if (oldAtEnd || sortedProcesses.at(j) < m_data.at(i)) {
+            // new entries, insert them in front of the current old one
+            int last = j;
+            while (last + 1 < sortedProcesses.size()
+                   && (i == m_data.size() || sortedProcesses.at(last + 1) < m_data.at(i)))
+                ++last;
+            beginInsertRows(QModelIndex(), i, i + last - j);
+            for (int k = j; k <= last; ++k)
+                m_data.insert(i + k - j, sortedProcesses.at(k));
             endInsertRows();
-            // let i point to old element again
+            i += last - j + 1;
+            j = last + 1;
+        } else {
+            // already contained, only update the content if that changed
+            if (!hasSameContent(m_data.at(i), sortedProcesses.at(j))) {
+                m_data[i] = sortedProcesses.at(j);
+                emit dataChanged(index(i, 0), index(i, COLUMN_COUNT - 1));
+            }
             ++i;
+            ++j;
         }
     }
 
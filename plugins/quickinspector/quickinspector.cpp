@@ -41,6 +41,7 @@
 #include <core/metaobjectrepository.h>
 #include <core/objecttypefilterproxymodel.h>
 #include <core/probeinterface.h>
+#include <core/probesettings.h>
 #include <core/propertycontroller.h>
 #include <core/remote/server.h>
 #include <core/remote/serverproxymodel.h>
@@ -224,7 +225,7 @@ QuickInspector::QuickInspector(ProbeInterface *probe, QObject *parent)
     : QuickInspectorInterface(parent)
     , m_probe(probe)
     , m_currentSgNode(0)
-    , m_itemModel(new QuickItemModel(this))
+    , m_itemModel(new QuickItemModel(probe, this))
     , m_sgModel(new QuickSceneGraphModel(this))
     , m_itemPropertyController(new PropertyController(QStringLiteral("com.kdab.GammaRay.QuickItem"),
                                                       this))
@@ -263,6 +264,8 @@ QuickInspector::QuickInspector(ProbeInterface *probe, QObject *parent)
     connect(m_itemSelectionModel, &QItemSelectionModel::selectionChanged,
             this, &QuickInspector::itemSelectionChanged);
 
+    m_sgModel->setFrameBudget(ProbeSettings::value(QStringLiteral("QuickSceneGraphFrameBudget"),
+                                                   m_sgModel->frameBudget()).toInt());
     filterProxy = new ServerProxyModel<KRecursiveFilterProxyModel>(this);
     filterProxy->setSourceModel(m_sgModel);
     probe->registerModel(QStringLiteral("com.kdab.GammaRay.QuickSceneGraphModel"), filterProxy);
@@ -271,6 +274,10 @@ QuickInspector::QuickInspector(ProbeInterface *probe, QObject *parent)
     connect(m_sgSelectionModel, &QItemSelectionModel::selectionChanged,
             this, &QuickInspector::sgSelectionChanged);
     connect(m_sgModel, &QuickSceneGraphModel::nodeDeleted, this, &QuickInspector::sgNodeDeleted);
+    connect(m_sgModel, &QuickSceneGraphModel::updated, this, [this]() {
+        setSceneGraphUpdateNodeCount(m_sgModel->lastUpdateNodeCount());
+        setSceneGraphUpdateTime(m_sgModel->lastUpdateTime());
+    });
 
     connect(m_remoteView, &RemoteViewServer::doPickElement, this, &QuickInspector::pickItemAt);
     connect(m_remoteView, &RemoteViewServer::requestUpdate, this, &QuickInspector::slotGrabWindow);
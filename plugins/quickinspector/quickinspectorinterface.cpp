@@ -64,6 +64,8 @@ QDataStream &operator>>(QDataStream &in, QuickInspectorInterface::RenderMode &va
 
 QuickInspectorInterface::QuickInspectorInterface(QObject *parent)
     : QObject(parent)
+    , m_sceneGraphUpdateNodeCount(0)
+    , m_sceneGraphUpdateTime(0)
 {
     ObjectBroker::registerObject<QuickInspectorInterface *>(this);
     qRegisterMetaTypeStreamOperators<Features>();
@@ -74,4 +76,30 @@ QuickInspectorInterface::QuickInspectorInterface(QObject *parent)
 QuickInspectorInterface::~QuickInspectorInterface()
 {
 }
+
+int QuickInspectorInterface::sceneGraphUpdateNodeCount() const
+{
+    return m_sceneGraphUpdateNodeCount;
+}
+
+void QuickInspectorInterface::setSceneGraphUpdateNodeCount(int count)
+{
+    if (count == m_sceneGraphUpdateNodeCount)
+        return;
+    m_sceneGraphUpdateNodeCount = count;
+    emit sceneGraphUpdateStatsChanged();
+}
+
+qint64 QuickInspectorInterface::sceneGraphUpdateTime() const
+{
+    return m_sceneGraphUpdateTime;
+}
+
+void QuickInspectorInterface::setSceneGraphUpdateTime(qint64 nsecs)
+{
+    if (nsecs == m_sceneGraphUpdateTime)
+        return;
+    m_sceneGraphUpdateTime = nsecs;
+    emit sceneGraphUpdateStatsChanged();
+}
 }
@@ -46,6 +46,10 @@ namespace GammaRay {
 class QuickInspectorInterface : public QObject
 {
     Q_OBJECT
+    Q_PROPERTY(int sceneGraphUpdateNodeCount READ sceneGraphUpdateNodeCount
+               WRITE setSceneGraphUpdateNodeCount NOTIFY sceneGraphUpdateStatsChanged)
+    Q_PROPERTY(qint64 sceneGraphUpdateTime READ sceneGraphUpdateTime
+               WRITE setSceneGraphUpdateTime NOTIFY sceneGraphUpdateStatsChanged)
 public:
     enum Feature {
         NoFeatures = 0,
@@ -71,6 +75,17 @@ public:
     explicit QuickInspectorInterface(QObject *parent = 0);
     ~QuickInspectorInterface();
 
+    /** Number of scene graph nodes the scene graph model visited during its last update.
+     *  @since 2.6
+     */
+    int sceneGraphUpdateNodeCount() const;
+    void setSceneGraphUpdateNodeCount(int count);
+    /** Duration of the last update of the scene graph model, in nanoseconds.
+     *  @since 2.6
+     */
+    qint64 sceneGraphUpdateTime() const;
+    void setSceneGraphUpdateTime(qint64 nsecs);
+
 public slots:
     virtual void selectWindow(int index) = 0;
 
@@ -81,6 +96,11 @@ public slots:
 
 signals:
     void features(GammaRay::QuickInspectorInterface::Features features);
+    void sceneGraphUpdateStatsChanged();
+
+private:
+    int m_sceneGraphUpdateNodeCount;
+    qint64 m_sceneGraphUpdateTime;
 };
 }
 
@@ -31,6 +31,7 @@
 
 #include <core/paintanalyzer.h>
 #include <core/probe.h>
+#include <core/signalspycallbackset.h>
 
 #include <QQuickItem>
 #include <QQuickWindow>
@@ -39,18 +40,76 @@
 #include <QQmlEngine>
 #include <QQmlContext>
 #include <QEvent>
+#include <QTimer>
 
 #include <algorithm>
 
 using namespace GammaRay;
 
-QuickItemModel::QuickItemModel(QObject *parent)
+static QuickItemModel *s_itemModel = 0;
+
+QuickItemModel::QuickItemModel(ProbeInterface *probe, QObject *parent)
     : ObjectModelBase<QAbstractItemModel>(parent)
+    , m_dirtyTimer(new QTimer(this))
+    , m_eventMonitor(new QuickEventMonitor(this))
 {
+    // geometry changes trigger bursts of signals across entire sub-trees, announce them per frame
+    m_dirtyTimer->setSingleShot(true);
+    m_dirtyTimer->setInterval(1000 / 60);
+    connect(m_dirtyTimer, SIGNAL(timeout()), this, SLOT(flushDirtyItems()));
+
+    const QMetaObject &mo = QQuickItem::staticMetaObject;
+    m_parentChangedIndex = mo.indexOfSignal("parentChanged(QQuickItem*)");
+    m_windowChangedIndex = mo.indexOfSignal("windowChanged(QQuickWindow*)");
+    m_updateSignalIndexes << mo.indexOfSignal("visibleChanged()")
+                          << mo.indexOfSignal("focusChanged(bool)")
+                          << mo.indexOfSignal("activeFocusChanged(bool)")
+                          << mo.indexOfSignal("widthChanged()")
+                          << mo.indexOfSignal("heightChanged()")
+                          << mo.indexOfSignal("xChanged()")
+                          << mo.indexOfSignal("yChanged()");
+    const QVector<int> allIndexes = QVector<int>(m_updateSignalIndexes)
+                                    << m_parentChangedIndex << m_windowChangedIndex;
+    m_minSignalIndex = *std::min_element(allIndexes.constBegin(), allIndexes.constEnd());
+    m_maxSignalIndex = *std::max_element(allIndexes.constBegin(), allIndexes.constEnd());
+
+    SignalSpyCallbackSet callbacks;
+    callbacks.signalBeginCallback = signalEmitted;
+    probe->registerSignalSpyCallbackSet(callbacks);
+
+    s_itemModel = this;
 }
 
 QuickItemModel::~QuickItemModel()
 {
+    s_itemModel = 0;
+}
+
+void QuickItemModel::signalEmitted(QObject *caller, int methodIndex, void **argv)
+{
+    Q_UNUSED(argv);
+    // this sees every signal emission in the application, reject unrelated ones early
+    QuickItemModel *model = s_itemModel;
+    if (!model || methodIndex < model->m_minSignalIndex || methodIndex > model->m_maxSignalIndex)
+        return;
+    if (model->thread() != QThread::currentThread())
+        return;
+
+    // caller is only dereferenced once we know it is one of our items
+    QQuickItem *item = static_cast<QQuickItem *>(caller);
+    if (!model->m_childParentMap.contains(item))
+        return;
+    model->itemSignalEmitted(item, methodIndex);
+}
+
+void QuickItemModel::itemSignalEmitted(QQuickItem *item, int methodIndex)
+{
+    if (methodIndex == m_parentChangedIndex)
+        itemReparented(item);
+    else if (methodIndex == m_windowChangedIndex)
+        itemWindowChanged(item);
+    else if (m_updateSignalIndexes.contains(methodIndex))
+        markItemDirty(item, FlagsChanged);
 }
 
 void QuickItemModel::setWindow(QQuickWindow *window)
@@ -114,9 +173,11 @@ void QuickItemModel::clear()
 {
     for (QHash<QQuickItem *, QQuickItem *>::const_iterator it = m_childParentMap.constBegin();
          it != m_childParentMap.constEnd(); ++it)
-        disconnect(it.key(), 0, this, 0);
+        disconnectItem(it.key());
     m_childParentMap.clear();
     m_parentChildMap.clear();
+    m_dirtyItems.clear();
+    m_dirtyTimer->stop();
 }
 
 void QuickItemModel::populateFromItem(QQuickItem *item)
@@ -142,21 +203,12 @@ void QuickItemModel::populateFromItem(QQuickItem *item)
 
 void QuickItemModel::connectItem(QQuickItem *item)
 {
-    connect(item, SIGNAL(parentChanged(QQuickItem*)), this, SLOT(itemReparented()));
-    connect(item, SIGNAL(windowChanged(QQuickWindow*)), this, SLOT(itemWindowChanged()));
-    connect(item, SIGNAL(visibleChanged()), this, SLOT(itemUpdated()));
-    connect(item, SIGNAL(focusChanged(bool)), this, SLOT(itemUpdated()));
-    connect(item, SIGNAL(activeFocusChanged(bool)), this, SLOT(itemUpdated()));
-    connect(item, SIGNAL(widthChanged()), this, SLOT(itemUpdated()));
-    connect(item, SIGNAL(heightChanged()), this, SLOT(itemUpdated()));
-    connect(item, SIGNAL(xChanged()), this, SLOT(itemUpdated()));
-    connect(item, SIGNAL(yChanged()), this, SLOT(itemUpdated()));
-    item->installEventFilter(new QuickEventMonitor(this));
+    item->installEventFilter(m_eventMonitor);
 }
 
 void QuickItemModel::disconnectItem(QQuickItem *item)
 {
-    disconnect(item, 0, this, 0);
+    item->removeEventFilter(m_eventMonitor);
 }
 
 QModelIndex QuickItemModel::indexForItem(QQuickItem *item) const
@@ -233,6 +285,8 @@ void QuickItemModel::objectRemoved(QObject *obj)
 
 void QuickItemModel::removeItem(QQuickItem *item, bool danglingPointer)
 {
+    m_dirtyItems.remove(item);
+
     if (!m_childParentMap.contains(item)) { // not an item of our current scene
         Q_ASSERT(!m_parentChildMap.contains(item));
         return;
@@ -265,15 +319,15 @@ void QuickItemModel::doRemoveSubtree(QQuickItem *item, bool danglingPointer)
 {
     m_childParentMap.remove(item);
     m_parentChildMap.remove(item);
+    m_dirtyItems.remove(item);
     if (!danglingPointer) {
         foreach (QQuickItem *child, item->childItems())
             doRemoveSubtree(child, false);
     }
 }
 
-void QuickItemModel::itemReparented()
+void QuickItemModel::itemReparented(QQuickItem *item)
 {
-    QQuickItem *item = qobject_cast<QQuickItem *>(sender());
     if (!item->parentItem()) { // Item was not deleted, but removed from the scene.
         removeItem(item, false);
         return;
@@ -307,48 +361,109 @@ void QuickItemModel::itemReparented()
     endMoveRows();
 }
 
-void QuickItemModel::itemWindowChanged()
+void QuickItemModel::itemWindowChanged(QQuickItem *item)
 {
-    QQuickItem *item = qobject_cast<QQuickItem *>(sender());
     Q_ASSERT(item && (!item->window() || item->window() != m_window));
     removeItem(item);
 }
 
-void QuickItemModel::itemUpdated()
+void QuickItemModel::markItemDirty(QQuickItem *item, int changes)
 {
-    QQuickItem *item = qobject_cast<QQuickItem *>(sender());
+    m_dirtyItems[item] |= changes;
+    if (!m_dirtyTimer->isActive())
+        m_dirtyTimer->start();
+}
 
-    recursivelyUpdateItem(item);
+void QuickItemModel::flushDirtyItems()
+{
+    QHash<QQuickItem *, int> dirtyItems;
+    dirtyItems.swap(m_dirtyItems);
+    if (!m_window)
+        return;
+
+    QHash<QQuickItem *, int> changes;
+    QSet<QQuickItem *> visited;
+    for (QHash<QQuickItem *, int>::const_iterator it = dirtyItems.constBegin();
+         it != dirtyItems.constEnd(); ++it) {
+        if (it.value() & EventReceived)
+            changes[it.key()] |= EventReceived;
+        if (it.value() & FlagsChanged)
+            recursivelyUpdateItem(it.key(), visited, changes);
+    }
+    emitItemChanges(changes);
 }
 
-void QuickItemModel::recursivelyUpdateItem(QQuickItem *item)
+void QuickItemModel::recursivelyUpdateItem(QQuickItem *item, QSet<QQuickItem *> &visited,
+                                           QHash<QQuickItem *, int> &changes)
 {
     if (item->parent() == QObject::parent()) // skip items injected by ourselves
         return;
 
+    // a visited item had its entire sub-tree updated already
+    if (visited.contains(item))
+        return;
+    visited.insert(item);
+
     int oldFlags = m_itemFlags.value(item);
     updateItemFlags(item);
 
     if (oldFlags != m_itemFlags.value(item))
-        updateItem(item, QuickItemModelRole::ItemFlags);
+        changes[item] |= FlagsChanged;
 
     foreach (QQuickItem *child, item->childItems())
-        recursivelyUpdateItem(child);
+        recursivelyUpdateItem(child, visited, changes);
 }
 
-void QuickItemModel::updateItem(QQuickItem *item, int role)
+void QuickItemModel::emitItemChanges(const QHash<QQuickItem *, int> &changes)
 {
-    if (!item || item->window() != m_window)
-        return;
-
-    const QModelIndex left = indexForItem(item);
-    if (!left.isValid())
-        return;
-    const QModelIndex right = left.sibling(left.row(), columnCount() - 1);
+    // group the changed rows by parent, so adjacent siblings can share one dataChanged signal
+    typedef QPair<int, int> RowChanges;
+    QHash<QQuickItem *, QVector<RowChanges> > rowsByParent;
+    for (QHash<QQuickItem *, int>::const_iterator it = changes.constBegin();
+         it != changes.constEnd(); ++it) {
+        QQuickItem *item = it.key();
+        if (item->window() != m_window)
+            continue;
+
+        const QHash<QQuickItem *, QQuickItem *>::const_iterator parentIt
+            = m_childParentMap.constFind(item);
+        if (parentIt == m_childParentMap.constEnd())
+            continue;
+        const QVector<QQuickItem *> siblings = m_parentChildMap.value(parentIt.value());
+        QVector<QQuickItem *>::const_iterator sit
+            = std::lower_bound(siblings.constBegin(), siblings.constEnd(), item);
+        if (sit == siblings.constEnd() || *sit != item)
+            continue;
+        const int row = std::distance(siblings.constBegin(), sit);
+        rowsByParent[parentIt.value()].push_back(qMakePair(row, it.value()));
+    }
 
-    Q_ASSERT(left.isValid());
-    Q_ASSERT(right.isValid());
-    emit dataChanged(left, right, QVector<int>() << role);
+    for (QHash<QQuickItem *, QVector<RowChanges> >::iterator it = rowsByParent.begin();
+         it != rowsByParent.end(); ++it) {
+        const QModelIndex parentIndex = indexForItem(it.key());
+        if (it.key() && !parentIndex.isValid())
+            continue;
+
+        QVector<RowChanges> &rows = it.value();
+        std::sort(rows.begin(), rows.end());
+        for (int first = 0; first < rows.size();) {
+            int last = first;
+            int rangeChanges = rows.at(first).second;
+            while (last + 1 < rows.size() && rows.at(last + 1).first == rows.at(last).first + 1) {
+                ++last;
+                rangeChanges |= rows.at(last).second;
+            }
+
+            QVector<int> roles;
+            if (rangeChanges & FlagsChanged)
+                roles.push_back(QuickItemModelRole::ItemFlags);
+            if (rangeChanges & EventReceived)
+                roles.push_back(QuickItemModelRole::ItemEvent);
+            emit dataChanged(index(rows.at(first).first, 0, parentIndex),
+                             index(rows.at(last).first, columnCount() - 1, parentIndex), roles);
+            first = last + 1;
+        }
+    }
 }
 
 void QuickItemModel::updateItemFlags(QQuickItem *item)
@@ -388,7 +503,9 @@ bool QuickEventMonitor::eventFilter(QObject *obj, QEvent *event)
 {
     if (event->type() != QEvent::DeferredDelete && event->type() != QEvent::Destroy) {
         // exclude some unsafe event types
-        m_model->updateItem(qobject_cast<QQuickItem *>(obj), QuickItemModelRole::ItemEvent);
+        QQuickItem *item = qobject_cast<QQuickItem *>(obj);
+        if (item && m_model->m_childParentMap.contains(item))
+            m_model->markItemDirty(item, QuickItemModel::EventReceived);
     }
 
     return false;
@@ -33,22 +33,27 @@
 
 #include <QHash>
 #include <QPointer>
+#include <QSet>
 #include <QVector>
 
 QT_BEGIN_NAMESPACE
 class QSignalMapper;
 class QQuickItem;
 class QQuickWindow;
+class QTimer;
 QT_END_NAMESPACE
 
 namespace GammaRay {
+class ProbeInterface;
+class QuickEventMonitor;
+
 /** QQ2 item tree model. */
 class QuickItemModel : public ObjectModelBase<QAbstractItemModel>
 {
     Q_OBJECT
 
 public:
-    explicit QuickItemModel(QObject *parent = 0);
+    explicit QuickItemModel(ProbeInterface *probe, QObject *parent = 0);
     ~QuickItemModel();
 
     void setWindow(QQuickWindow *window);
@@ -64,19 +69,34 @@ public slots:
     void objectRemoved(QObject *obj);
 
 private slots:
-    void itemReparented();
-    void itemWindowChanged();
-    void itemUpdated();
+    void flushDirtyItems();
 
 private:
     friend class QuickEventMonitor;
-    void updateItem(QQuickItem *item, int role);
-    void recursivelyUpdateItem(QQuickItem *item);
+
+    /// Pending changes of an item, in m_dirtyItems and when announcing them.
+    enum ItemChange {
+        FlagsChanged = 1,
+        EventReceived = 2
+    };
+
+    /// Signal spy callback, observing the change signals of all items with a single hook.
+    static void signalEmitted(QObject *caller, int methodIndex, void **argv);
+    void itemSignalEmitted(QQuickItem *item, int methodIndex);
+    void itemReparented(QQuickItem *item);
+    void itemWindowChanged(QQuickItem *item);
+
+    /// Schedule @p changes of @p item to be announced with the next flush.
+    void markItemDirty(QQuickItem *item, int changes);
+    void recursivelyUpdateItem(QQuickItem *item, QSet<QQuickItem *> &visited,
+                               QHash<QQuickItem *, int> &changes);
+    /// Emits dataChanged for @p changes, merging adjacent sibling rows into ranges.
+    void emitItemChanges(const QHash<QQuickItem *, int> &changes);
     void updateItemFlags(QQuickItem *item);
     void clear();
     void populateFromItem(QQuickItem *item);
 
-    /// Track all changes to item @p item in this model (parentChanged, windowChanged, ...)
+    /// Track events of item @p item in this model, signals are observed via signalEmitted()
     void connectItem(QQuickItem *item);
 
     /// Untrack item @p item
@@ -102,6 +122,18 @@ private:
     QHash<QQuickItem *, QQuickItem *> m_childParentMap;
     QHash<QQuickItem *, QVector<QQuickItem *> > m_parentChildMap;
     QHash<QQuickItem *, int> m_itemFlags;
+
+    // items with pending changes, flushed at most once per frame
+    QHash<QQuickItem *, int> m_dirtyItems;
+    QTimer *m_dirtyTimer;
+    QuickEventMonitor *m_eventMonitor;
+
+    // absolute method indexes of the QQuickItem signals we observe
+    int m_parentChangedIndex;
+    int m_windowChangedIndex;
+    QVector<int> m_updateSignalIndexes;
+    int m_minSignalIndex;
+    int m_maxSignalIndex;
 };
 
 class QuickEventMonitor : public QObject
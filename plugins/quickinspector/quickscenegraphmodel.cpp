@@ -29,10 +29,14 @@
 #include "quickscenegraphmodel.h"
 
 #include <private/qquickitem_p.h>
+#include <private/qquickwindow_p.h>
 #include "quickitemmodelroles.h"
 
+#include <core/probe.h>
+
 #include <QQuickWindow>
 #include <QThread>
+#include <QTimer>
 #include <QSGNode>
 
 #include <algorithm>
@@ -44,6 +48,10 @@ using namespace GammaRay;
 QuickSceneGraphModel::QuickSceneGraphModel(QObject *parent)
     : ObjectModelBase<QAbstractItemModel>(parent)
     , m_rootNode(0)
+    , m_frameBudget(4)
+    , m_visitedNodes(0)
+    , m_lastUpdateNodeCount(0)
+    , m_lastUpdateTime(0)
 {
 }
 
@@ -56,35 +64,138 @@ void QuickSceneGraphModel::setWindow(QQuickWindow *window)
     beginResetModel();
     clear();
     if (m_window)
-        disconnect(window, SIGNAL(beforeRendering()), this, SLOT(updateSGTree()));
+        disconnect(m_window, 0, this, 0);
     m_window = window;
     m_rootNode = currentRootNode();
     if (m_window && m_rootNode) {
         updateSGTree(false);
         connect(window, SIGNAL(beforeRendering()), this, SLOT(updateSGTree()));
+        connect(window, &QQuickWindow::beforeSynchronizing,
+                this, &QuickSceneGraphModel::collectDirtyItems, Qt::DirectConnection);
     }
 
     endResetModel();
 }
 
+int QuickSceneGraphModel::frameBudget() const
+{
+    return m_frameBudget;
+}
+
+void QuickSceneGraphModel::setFrameBudget(int msecs)
+{
+    m_frameBudget = msecs;
+}
+
+int QuickSceneGraphModel::lastUpdateNodeCount() const
+{
+    return m_lastUpdateNodeCount;
+}
+
+qint64 QuickSceneGraphModel::lastUpdateTime() const
+{
+    return m_lastUpdateTime;
+}
+
 void QuickSceneGraphModel::updateSGTree(bool emitSignals)
 {
+    QElapsedTimer timer;
+    timer.start();
+    m_visitedNodes = 0;
+
     auto root = currentRootNode();
     if (root != m_rootNode) { // everything changed, reset
         beginResetModel();
         clear();
         m_rootNode = root;
         if (m_window && m_rootNode)
-            updateSGTree(false);
+            populateFromRoot();
         endResetModel();
+    } else if (!emitSignals) {
+        populateFromRoot();
     } else {
-        m_childParentMap[m_rootNode] = 0;
-        m_parentChildMap[0].resize(1);
-        m_parentChildMap[0][0] = m_rootNode;
+        updateDirtyItems(timer);
+    }
 
-        populateFromNode(m_rootNode, emitSignals);
-        collectItemNodes(m_window->contentItem());
+    m_lastUpdateNodeCount = m_visitedNodes;
+    m_lastUpdateTime = timer.nsecsElapsed();
+    emit updated();
+}
+
+void QuickSceneGraphModel::populateFromRoot()
+{
+    {
+        // everything is going to be visited anyway
+        QMutexLocker lock(&m_dirtyItemsMutex);
+        m_dirtyItems.clear();
     }
+
+    m_childParentMap[m_rootNode] = 0;
+    m_parentChildMap[0].resize(1);
+    m_parentChildMap[0][0] = m_rootNode;
+
+    populateFromNode(m_rootNode, false);
+    collectItemNodes(m_window->contentItem());
+}
+
+void QuickSceneGraphModel::updateDirtyItems(const QElapsedTimer &timer)
+{
+    QSet<QQuickItem *> dirtyItems;
+    {
+        QMutexLocker lock(&m_dirtyItemsMutex);
+        dirtyItems.swap(m_dirtyItems);
+    }
+
+    for (auto it = dirtyItems.constBegin(); it != dirtyItems.constEnd(); ++it) {
+        if (m_frameBudget > 0 && timer.elapsed() >= m_frameBudget) {
+            // out of time, defer the rest
+            QMutexLocker lock(&m_dirtyItemsMutex);
+            for (; it != dirtyItems.constEnd(); ++it)
+                m_dirtyItems.insert(*it);
+            // the scene might not render again anytime soon
+            QTimer::singleShot(0, this, SLOT(updateSGTree()));
+            break;
+        }
+
+        // items might have been deleted since they were synchronized (or deferred), and their
+        // item nodes might have been replaced or deleted along with them, so look both up again
+        QQuickItem *item = *it;
+        QSGNode *itemNode = Q_NULLPTR;
+        {
+            QMutexLocker lock(Probe::objectLock());
+            // the address might have been reused by an unrelated object meanwhile
+            if (!Probe::instance()->isValidObject(item) || !qobject_cast<QQuickItem *>(item))
+                continue;
+            itemNode = QQuickItemPrivate::get(item)->itemNodeInstance;
+        }
+        if (!itemNode)
+            continue;
+
+        QSGNode *oldItemNode = m_itemItemNodeMap.value(item);
+        if (oldItemNode != itemNode) {
+            m_itemNodeItemMap.remove(oldItemNode);
+            m_itemItemNodeMap[item] = itemNode;
+            m_itemNodeItemMap[itemNode] = item;
+        }
+
+        // not part of our tree yet, this is handled when updating the parent item then
+        if (!m_childParentMap.contains(itemNode))
+            continue;
+        populateFromNode(itemNode, true, true);
+    }
+}
+
+void QuickSceneGraphModel::collectDirtyItems()
+{
+    if (!m_window)
+        return;
+
+    // the dirty list is reset during synchronization, so grab it beforehand
+    QQuickWindowPrivate *winPriv = QQuickWindowPrivate::get(m_window);
+    QMutexLocker lock(&m_dirtyItemsMutex);
+    for (QQuickItem *item = winPriv->dirtyItemList; item;
+         item = QQuickItemPrivate::get(item)->nextDirtyItem)
+        m_dirtyItems.insert(item);
 }
 
 QSGNode *QuickSceneGraphModel::currentRootNode() const
@@ -171,10 +282,12 @@ void QuickSceneGraphModel::clear()
 #define GET_INDEX if (emitSignals && !hasMyIndex) { myIndex = indexForNode(node); hasMyIndex = true; \
 }
 
-void QuickSceneGraphModel::populateFromNode(QSGNode *node, bool emitSignals)
+void QuickSceneGraphModel::populateFromNode(QSGNode *node, bool emitSignals,
+                                            bool skipKnownItemNodes)
 {
     if (!node)
         return;
+    ++m_visitedNodes;
 
     QVector<QSGNode *> &childList = m_parentChildMap[node];
     QVector<QSGNode *> newChildList;
@@ -217,7 +330,8 @@ void QuickSceneGraphModel::populateFromNode(QSGNode *node, bool emitSignals)
                 i = childList.insert(i, *j);
                 if (emitSignals)
                     endMoveRows();
-                populateFromNode(*j, emitSignals);
+                if (!skipKnownItemNodes || !m_itemNodeItemMap.contains(*j))
+                    populateFromNode(*j, emitSignals, skipKnownItemNodes);
             } else { // entirely new
                 if (emitSignals)
                     beginInsertRows(myIndex, idx, idx);
@@ -230,7 +344,9 @@ void QuickSceneGraphModel::populateFromNode(QSGNode *node, bool emitSignals)
             ++i;
             ++j;
         } else { // already known node, no change
-            populateFromNode(*j, emitSignals);
+            // sub-trees of other items are revisited when those are synchronized
+            if (!skipKnownItemNodes || !m_itemNodeItemMap.contains(*j))
+                populateFromNode(*j, emitSignals, skipKnownItemNodes);
             ++i;
             ++j;
         }
@@ -274,7 +390,8 @@ void QuickSceneGraphModel::populateFromNode(QSGNode *node, bool emitSignals)
                 childList.append(*j);
                 if (emitSignals)
                     endMoveRows();
-                populateFromNode(*j, emitSignals);
+                if (!skipKnownItemNodes || !m_itemNodeItemMap.contains(*j))
+                    populateFromNode(*j, emitSignals, skipKnownItemNodes);
                 ++j;
             }
         }
@@ -33,8 +33,11 @@
 
 #include "core/objectmodelbase.h"
 
+#include <QElapsedTimer>
 #include <QHash>
+#include <QMutex>
 #include <QPointer>
+#include <QSet>
 #include <QVector>
 
 QT_BEGIN_NAMESPACE
@@ -44,7 +47,13 @@ class QQuickWindow;
 QT_END_NAMESPACE
 
 namespace GammaRay {
-/** QQ2 scene graph model. */
+/** QQ2 scene graph model.
+ *
+ * After the initial full walk, only the node sub-trees of items that got synchronized
+ * with the scene graph are revisited on updates. Those are found via the dirty item list
+ * of the window right before synchronization, child item sub-trees are only entered
+ * if they are new to the model or dirty themselves.
+ */
 class QuickSceneGraphModel : public ObjectModelBase<QAbstractItemModel>
 {
     Q_OBJECT
@@ -63,8 +72,21 @@ public:
     QQuickItem *itemForSgNode(QSGNode *node) const;
     bool verifyNodeValidity(QSGNode *node);
 
+    /** Upper limit in milliseconds for the time spent on one update, 0 for no limit.
+     *  Remaining dirty sub-trees are deferred to the next update.
+     */
+    int frameBudget() const;
+    void setFrameBudget(int msecs);
+
+    /// number of scene graph nodes visited during the last update
+    int lastUpdateNodeCount() const;
+    /// duration of the last update, in nanoseconds
+    qint64 lastUpdateTime() const;
+
 signals:
     void nodeDeleted(QSGNode *node);
+    /// emitted after each update of the model, see lastUpdateNodeCount() and lastUpdateTime()
+    void updated();
 
 private slots:
     void updateSGTree(bool emitSignals = true);
@@ -72,8 +94,12 @@ private slots:
 private:
     void clear();
     QSGNode *currentRootNode() const;
-    void populateFromNode(QSGNode *node, bool emitSignals);
+    void populateFromRoot();
+    void populateFromNode(QSGNode *node, bool emitSignals, bool skipKnownItemNodes = false);
+    void updateDirtyItems(const QElapsedTimer &timer);
     void collectItemNodes(QQuickItem *item);
+    // called in the render thread while the GUI thread is blocked
+    void collectDirtyItems();
     bool recursivelyFindChild(QSGNode *root, QSGNode *child) const;
     void pruneSubTree(QSGNode *node);
 
@@ -84,6 +110,15 @@ private:
     QHash<QSGNode *, QVector<QSGNode *> > m_parentChildMap;
     QHash<QQuickItem *, QSGNode *> m_itemItemNodeMap;
     QHash<QSGNode *, QQuickItem *> m_itemNodeItemMap;
+
+    // synchronized items, not yet looked at
+    QMutex m_dirtyItemsMutex;
+    QSet<QQuickItem *> m_dirtyItems;
+
+    int m_frameBudget;
+    int m_visitedNodes;
+    int m_lastUpdateNodeCount;
+    qint64 m_lastUpdateTime;
 };
 }
 
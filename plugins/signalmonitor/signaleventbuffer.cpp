@@ -0,0 +1,161 @@
+/*
+  signaleventbuffer.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "signaleventbuffer.h"
+
+#include <algorithm>
+
+using namespace GammaRay;
+
+SignalEventAllocator::SignalEventAllocator()
+    : m_usedBlocks(0)
+{
+}
+
+SignalEventAllocator::~SignalEventAllocator()
+{
+    Q_ASSERT(m_usedBlocks == 0);
+    foreach (qint64 *slab, m_slabs)
+        delete[] slab;
+}
+
+qint64 *SignalEventAllocator::allocate()
+{
+    if (m_freeBlocks.isEmpty()) {
+        qint64 *slab = new qint64[BlockSize * BlocksPerSlab];
+        m_slabs.push_back(slab);
+        m_freeBlocks.reserve(m_freeBlocks.size() + BlocksPerSlab);
+        // hand out blocks from the start of the slab first
+        for (int i = BlocksPerSlab - 1; i >= 0; --i)
+            m_freeBlocks.push_back(slab + i * BlockSize);
+    }
+
+    ++m_usedBlocks;
+    qint64 *block = m_freeBlocks.last();
+    m_freeBlocks.removeLast();
+    return block;
+}
+
+void SignalEventAllocator::release(qint64 *block)
+{
+    Q_ASSERT(m_usedBlocks > 0);
+    --m_usedBlocks;
+    m_freeBlocks.push_back(block);
+}
+
+int SignalEventAllocator::usedBlocks() const
+{
+    return m_usedBlocks;
+}
+
+SignalEventBuffer::SignalEventBuffer(SignalEventAllocator *allocator)
+    : m_allocator(allocator)
+    , m_head(0)
+    , m_size(0)
+{
+}
+
+SignalEventBuffer::~SignalEventBuffer()
+{
+    foreach (qint64 *block, m_blocks)
+        m_allocator->release(block);
+}
+
+void SignalEventBuffer::append(qint64 event)
+{
+    const int pos = m_head + m_size;
+    if (pos == m_blocks.size() * SignalEventAllocator::BlockSize)
+        m_blocks.push_back(m_allocator->allocate());
+    m_blocks.last()[pos % SignalEventAllocator::BlockSize] = event;
+    ++m_size;
+}
+
+int SignalEventBuffer::trimToSize(int count)
+{
+    const int dropped = std::max(0, m_size - count);
+    dropFront(dropped);
+    return dropped;
+}
+
+int SignalEventBuffer::trimBefore(qint64 event)
+{
+    if (m_size == 0 || at(0) >= event)
+        return 0;
+
+    // binary search for the first event to keep
+    int first = 0;
+    int count = m_size;
+    while (count > 0) {
+        const int step = count / 2;
+        if (at(first + step) < event) {
+            first += step + 1;
+            count -= step + 1;
+        } else {
+            count = step;
+        }
+    }
+    dropFront(first);
+    return first;
+}
+
+QVector<qint64> SignalEventBuffer::toVector() const
+{
+    QVector<qint64> events;
+    events.reserve(m_size);
+    int remaining = m_size;
+    int offset = m_head;
+    foreach (const qint64 *block, m_blocks) {
+        const int n = std::min(remaining, SignalEventAllocator::BlockSize - offset);
+        for (int i = 0; i < n; ++i)
+            events.push_back(block[offset + i]);
+        remaining -= n;
+        offset = 0;
+    }
+    return events;
+}
+
+void SignalEventBuffer::dropFront(int count)
+{
+    Q_ASSERT(count >= 0 && count <= m_size);
+    m_size -= count;
+    m_head += count;
+
+    int unusedBlocks = m_head / SignalEventAllocator::BlockSize;
+    if (m_size == 0) {
+        // keep the last block around, we are likely to see more events soon
+        unusedBlocks = m_blocks.size() - 1;
+        m_head = 0;
+    }
+    if (unusedBlocks <= 0)
+        return;
+
+    for (int i = 0; i < unusedBlocks; ++i)
+        m_allocator->release(m_blocks.at(i));
+    m_blocks.remove(0, unusedBlocks);
+    if (m_size > 0)
+        m_head -= unusedBlocks * SignalEventAllocator::BlockSize;
+}
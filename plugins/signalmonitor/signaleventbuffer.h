@@ -0,0 +1,125 @@
+/*
+  signaleventbuffer.h
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GAMMARAY_SIGNALEVENTBUFFER_H
+#define GAMMARAY_SIGNALEVENTBUFFER_H
+
+#include <QVector>
+
+namespace GammaRay {
+/** Hands out fixed size blocks for signal events, carved out of larger slabs.
+ *
+ * Released blocks are kept on a free list and reused, so event buffers that
+ * continuously drop their oldest events do not cause any heap traffic.
+ */
+class SignalEventAllocator
+{
+public:
+    enum {
+        BlockSize = 256 // events per block
+    };
+
+    SignalEventAllocator();
+    ~SignalEventAllocator();
+
+    qint64 *allocate();
+    void release(qint64 *block);
+
+    /** Number of blocks currently handed out. */
+    int usedBlocks() const;
+
+private:
+    Q_DISABLE_COPY(SignalEventAllocator)
+    enum {
+        BlocksPerSlab = 64 // 128kB slabs
+    };
+
+    QVector<qint64 *> m_slabs;
+    QVector<qint64 *> m_freeBlocks;
+    int m_usedBlocks;
+};
+
+/** FIFO of signal events of a single object, with storage from a SignalEventAllocator.
+ *
+ * Events are expected to be appended in ascending order, so the oldest ones can
+ * be dropped from the front to keep the buffer within its configured bounds.
+ */
+class SignalEventBuffer
+{
+public:
+    explicit SignalEventBuffer(SignalEventAllocator *allocator);
+    ~SignalEventBuffer();
+
+    int size() const
+    {
+        return m_size;
+    }
+
+    bool isEmpty() const
+    {
+        return m_size == 0;
+    }
+
+    qint64 at(int i) const
+    {
+        Q_ASSERT(i >= 0 && i < m_size);
+        const int pos = m_head + i;
+        const int blockSize = SignalEventAllocator::BlockSize;
+        return m_blocks.at(pos / blockSize)[pos % blockSize];
+    }
+
+    qint64 last() const
+    {
+        return at(m_size - 1);
+    }
+
+    void append(qint64 event);
+
+    /** Drops the oldest events until at most @p count are left.
+     *  Returns the number of dropped events.
+     */
+    int trimToSize(int count);
+
+    /** Drops all events smaller than @p event.
+     *  Returns the number of dropped events.
+     */
+    int trimBefore(qint64 event);
+
+    QVector<qint64> toVector() const;
+
+private:
+    Q_DISABLE_COPY(SignalEventBuffer)
+    void dropFront(int count);
+
+    SignalEventAllocator *m_allocator;
+    QVector<qint64 *> m_blocks;
+    int m_head; // offset of the oldest event in the first block
+    int m_size;
+};
+}
+
+#endif // GAMMARAY_SIGNALEVENTBUFFER_H
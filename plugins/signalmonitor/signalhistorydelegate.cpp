@@ -37,6 +37,7 @@
 #include <QPainter>
 #include <QTimer>
 
+#include <algorithm>
 #include <limits>
 
 using namespace GammaRay;
@@ -55,6 +56,8 @@ SignalHistoryDelegate::SignalHistoryDelegate(QObject *parent)
     SignalMonitorInterface *iface = ObjectBroker::object<SignalMonitorInterface *>();
     connect(iface, SIGNAL(clock(qlonglong)), this, SLOT(onServerClockChanged(qlonglong)));
     iface->sendClockUpdates(true);
+    connect(iface, SIGNAL(eventsAppended(QByteArray)), this, SLOT(onEventsAppended(QByteArray)));
+    iface->sendEventUpdates(true);
 }
 
 void SignalHistoryDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option,
@@ -67,8 +70,7 @@ void SignalHistoryDelegate::paint(QPainter *painter, const QStyleOptionViewItem
     const qint64 endTime = startTime + interval;
 
     const QAbstractItemModel * const model = index.model();
-    const QVector<qint64> &events
-        = model->data(index, SignalHistoryModel::EventsRole).value<QVector<qint64> >();
+    const QVector<qint64> events = this->events(index);
     const qint64 t0
         = qMax(static_cast<qint64>(0),
                model->data(index, SignalHistoryModel::StartTimeRole).value<qint64>() - startTime);
@@ -135,6 +137,36 @@ void SignalHistoryDelegate::onServerClockChanged(qint64 msecs)
     emit totalIntervalChanged();
 }
 
+void SignalHistoryDelegate::onEventsAppended(const QByteArray &batch)
+{
+    SignalEventBatchReader reader(batch);
+    if (reader.isReset())
+        m_events.clear();
+
+    int itemId, droppedEvents, appendedEvents;
+    while (reader.readItem(itemId, droppedEvents, appendedEvents)) {
+        QVector<qint64> &events = m_events[itemId];
+        events.remove(0, std::min(droppedEvents, events.size()));
+        events.reserve(events.size() + appendedEvents);
+        for (int i = 0; i < appendedEvents; ++i) {
+            qint64 event;
+            if (!reader.readEvent(events.isEmpty() ? 0 : events.last(), event)) {
+                qWarning() << "Received malformed signal history update.";
+                return;
+            }
+            events.push_back(event);
+        }
+    }
+}
+
+QVector<qint64> SignalHistoryDelegate::events(const QModelIndex &index) const
+{
+    const QVariant itemId = index.data(SignalHistoryModel::ItemIdRole);
+    if (!itemId.isValid())
+        return QVector<qint64>();
+    return m_events.value(itemId.toInt());
+}
+
 void SignalHistoryDelegate::setActive(bool active)
 {
     if (m_updateTimer->isActive() != active) {
@@ -154,9 +186,7 @@ bool SignalHistoryDelegate::isActive() const
 
 QString SignalHistoryDelegate::toolTipAt(const QModelIndex &index, int position, int width)
 {
-    const QAbstractItemModel * const model = index.model();
-    const QVector<qint64> &events
-        = model->data(index, SignalHistoryModel::EventsRole).value<QVector<qint64> >();
+    const QVector<qint64> events = this->events(index);
 
     const qint64 t = m_visibleInterval * position / width + m_visibleOffset;
     qint64 dtMin = std::numeric_limits<qint64>::max();
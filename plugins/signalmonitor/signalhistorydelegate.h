@@ -29,7 +29,9 @@
 #ifndef GAMMARAY_SIGNALHISTORYDELEGATE_H
 #define GAMMARAY_SIGNALHISTORYDELEGATE_H
 
+#include <QHash>
 #include <QStyledItemDelegate>
+#include <QVector>
 
 namespace GammaRay {
 class SignalHistoryDelegate : public QStyledItemDelegate
@@ -71,12 +73,16 @@ signals:
 private slots:
     void onUpdateTimeout();
     void onServerClockChanged(qlonglong msecs);
+    void onEventsAppended(const QByteArray &batch);
 
 private:
+    QVector<qint64> events(const QModelIndex &index) const;
+
     QTimer * const m_updateTimer;
     qint64 m_visibleOffset;
     qint64 m_visibleInterval;
     qint64 m_totalInterval;
+    QHash<int, QVector<qint64> > m_events; // by SignalHistoryModel::ItemIdRole
 };
 } // namespace GammaRay
 
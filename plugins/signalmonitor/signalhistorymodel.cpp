@@ -38,6 +38,9 @@
 #include <QMutex>
 #include <QSet>
 #include <QThread>
+#include <QTimer>
+
+#include <algorithm>
 
 using namespace GammaRay;
 
@@ -80,7 +83,20 @@ static void signal_begin_callback(QObject *caller, int method_index, void **argv
 
 SignalHistoryModel::SignalHistoryModel(ProbeInterface *probe, QObject *parent)
     : QAbstractTableModel(parent)
+    , m_updateTimer(new QTimer(this))
+    , m_expireTimer(new QTimer(this))
+    , m_maximumEventCount(10000)
+    , m_maximumEventAge(0)
+    , m_streamEvents(false)
 {
+    // emissions easily happen thousands of times per second, announce them in batches
+    m_updateTimer->setSingleShot(true);
+    m_updateTimer->setInterval(1000 / 25);
+    connect(m_updateTimer, SIGNAL(timeout()), this, SLOT(emitPendingChanges()));
+
+    m_expireTimer->setInterval(1000);
+    connect(m_expireTimer, SIGNAL(timeout()), this, SLOT(expireEvents()));
+
     connect(probe->probe(), SIGNAL(objectCreated(QObject*)), this, SLOT(onObjectAdded(QObject*)));
     connect(probe->probe(), SIGNAL(objectDestroyed(QObject*)), this,
             SLOT(onObjectRemoved(QObject*)));
@@ -95,6 +111,58 @@ SignalHistoryModel::SignalHistoryModel(ProbeInterface *probe, QObject *parent)
 SignalHistoryModel::~SignalHistoryModel()
 {
     s_historyModel = 0;
+    qDeleteAll(m_tracedObjects);
+}
+
+int SignalHistoryModel::maximumEventCount() const
+{
+    return m_maximumEventCount;
+}
+
+void SignalHistoryModel::setMaximumEventCount(int count)
+{
+    m_maximumEventCount = std::max(1, count);
+    for (int i = 0; i < m_tracedObjects.size(); ++i) {
+        Item *data = m_tracedObjects.at(i);
+        const int dropped = data->events.trimToSize(m_maximumEventCount);
+        if (dropped > 0) {
+            eventsDropped(data, dropped);
+            markDirty(i);
+        }
+    }
+}
+
+qint64 SignalHistoryModel::maximumEventAge() const
+{
+    return m_maximumEventAge;
+}
+
+void SignalHistoryModel::setMaximumEventAge(qint64 msecs)
+{
+    m_maximumEventAge = std::max<qint64>(0, msecs);
+    if (m_maximumEventAge > 0) {
+        m_expireTimer->start();
+        expireEvents();
+    } else {
+        m_expireTimer->stop();
+    }
+}
+
+void SignalHistoryModel::setEventStreamingEnabled(bool enabled)
+{
+    m_streamEvents = enabled;
+    if (!enabled)
+        return;
+
+    // start over with a complete snapshot, the receiver might have missed earlier batches
+    SignalEventBatchWriter batch(true);
+    for (int i = 0; i < m_tracedObjects.size(); ++i) {
+        Item *data = m_tracedObjects.at(i);
+        data->unsentEvents = data->events.size();
+        data->droppedEvents = 0;
+        writeEvents(batch, i);
+    }
+    emit eventsAppended(batch.data());
 }
 
 int SignalHistoryModel::rowCount(const QModelIndex &parent) const
@@ -136,13 +204,15 @@ QVariant SignalHistoryModel::data(const QModelIndex &index, int role) const
 
     case EventColumn:
         if (role == EventsRole)
-            return QVariant::fromValue(item(index)->events);
+            return QVariant::fromValue(item(index)->events.toVector());
         if (role == StartTimeRole)
             return item(index)->startTime;
         if (role == EndTimeRole)
             return item(index)->endTime();
         if (role == SignalMapRole)
-            return QVariant::fromValue(item(index)->signalNames);
+            return QVariant::fromValue(m_signalNames.value(item(index)->metaObject));
+        if (role == ItemIdRole)
+            return index.row();
 
         break;
     }
@@ -169,7 +239,8 @@ QVariant SignalHistoryModel::headerData(int section, Qt::Orientation orientation
 QMap< int, QVariant > SignalHistoryModel::itemData(const QModelIndex &index) const
 {
     QMap<int, QVariant> d = QAbstractItemModel::itemData(index);
-    d.insert(EventsRole, data(index, EventsRole));
+    // events are transferred incrementally via eventsAppended() instead
+    d.insert(ItemIdRole, data(index, ItemIdRole));
     d.insert(StartTimeRole, data(index, StartTimeRole));
     d.insert(EndTimeRole, data(index, EndTimeRole));
     d.insert(SignalMapRole, data(index, SignalMapRole));
@@ -188,7 +259,7 @@ void SignalHistoryModel::onObjectAdded(QObject *object)
 
     beginInsertRows(QModelIndex(), m_tracedObjects.size(), m_tracedObjects.size());
 
-    Item * const data = new Item(object);
+    Item * const data = new Item(object, &m_eventAllocator);
     m_itemIndex.insert(object, m_tracedObjects.size());
     m_tracedObjects.push_back(data);
 
@@ -208,7 +279,7 @@ void SignalHistoryModel::onObjectRemoved(QObject *object)
     Item *data = m_tracedObjects.at(itemIndex);
     Q_ASSERT(data->object == object);
     data->object = 0;
-    emit dataChanged(index(itemIndex, EventColumn), index(itemIndex, EventColumn));
+    markDirty(itemIndex);
 }
 
 void SignalHistoryModel::onSignalEmitted(QObject *sender, int signalIndex)
@@ -223,8 +294,9 @@ void SignalHistoryModel::onSignalEmitted(QObject *sender, int signalIndex)
 
     Item *data = m_tracedObjects.at(itemIndex);
     Q_ASSERT(data->object == sender);
-    // ensure the item is known
-    if (signalIndex > 0 && !data->signalNames.contains(signalIndex)) {
+    // ensure the item is known, names are shared by all objects of the same type
+    QHash<int, QByteArray> &signalNames = m_signalNames[data->metaObject];
+    if (signalIndex > 0 && !signalNames.contains(signalIndex)) {
         // protect dereferencing of sender here
         QMutexLocker lock(Probe::objectLock());
         if (!Probe::instance()->isValidObject(sender))
@@ -235,16 +307,102 @@ void SignalHistoryModel::onSignalEmitted(QObject *sender, int signalIndex)
 #else
                                       .methodSignature();
 #endif
-        data->signalNames.insert(signalIndex, internString(signalName));
+        signalNames.insert(signalIndex, internString(signalName));
+    }
+
+    data->events.append((timestamp << 16) | signalIndex);
+    ++data->unsentEvents;
+    eventsDropped(data, data->events.trimToSize(m_maximumEventCount));
+    if (m_maximumEventAge > 0 && timestamp > m_maximumEventAge)
+        eventsDropped(data, data->events.trimBefore((timestamp - m_maximumEventAge) << 16));
+    markDirty(itemIndex);
+}
+
+void SignalHistoryModel::eventsDropped(Item *data, int count)
+{
+    // the oldest events are dropped first, the receiver has those already unless it has none
+    const int sentEvents = data->events.size() + count - data->unsentEvents;
+    const int droppedSentEvents = std::min(count, sentEvents);
+    data->droppedEvents += droppedSentEvents;
+    data->unsentEvents -= count - droppedSentEvents;
+}
+
+void SignalHistoryModel::writeEvents(SignalEventBatchWriter &batch, int itemIndex)
+{
+    Item *data = m_tracedObjects.at(itemIndex);
+    if (data->unsentEvents == 0 && data->droppedEvents == 0)
+        return;
+
+    const int first = data->events.size() - data->unsentEvents;
+    batch.beginItem(itemIndex, data->droppedEvents, data->unsentEvents,
+                    first > 0 ? data->events.at(first - 1) : 0);
+    for (int i = first; i < data->events.size(); ++i)
+        batch.addEvent(data->events.at(i));
+    data->unsentEvents = 0;
+    data->droppedEvents = 0;
+}
+
+void SignalHistoryModel::markDirty(int itemIndex)
+{
+    Item *data = m_tracedObjects.at(itemIndex);
+    if (data->dirty)
+        return;
+    data->dirty = true;
+    m_dirtyItems.push_back(itemIndex);
+    if (!m_updateTimer->isActive())
+        m_updateTimer->start();
+}
+
+void SignalHistoryModel::emitPendingChanges()
+{
+    std::sort(m_dirtyItems.begin(), m_dirtyItems.end());
+
+    // send the events first, so they are there when the receiver repaints
+    if (m_streamEvents) {
+        SignalEventBatchWriter batch;
+        foreach (int itemIndex, m_dirtyItems)
+            writeEvents(batch, itemIndex);
+        if (!batch.isEmpty())
+            emit eventsAppended(batch.data());
     }
 
-    data->events.push_back((timestamp << 16) | signalIndex);
-    emit dataChanged(index(itemIndex, EventColumn), index(itemIndex, EventColumn));
+    for (int i = 0; i < m_dirtyItems.size();) {
+        const int first = m_dirtyItems.at(i);
+        int last = first;
+        m_tracedObjects.at(first)->dirty = false;
+        for (++i; i < m_dirtyItems.size() && m_dirtyItems.at(i) == last + 1; ++i) {
+            ++last;
+            m_tracedObjects.at(last)->dirty = false;
+        }
+        emit dataChanged(index(first, EventColumn), index(last, EventColumn));
+    }
+    m_dirtyItems.clear();
+}
+
+void SignalHistoryModel::expireEvents()
+{
+    const qint64 timestamp = RelativeClock::sinceAppStart()->mSecs();
+    if (timestamp <= m_maximumEventAge)
+        return;
+    const qint64 limit = (timestamp - m_maximumEventAge) << 16;
+    for (int i = 0; i < m_tracedObjects.size(); ++i) {
+        Item *data = m_tracedObjects.at(i);
+        const int dropped = data->events.trimBefore(limit);
+        if (dropped > 0) {
+            eventsDropped(data, dropped);
+            markDirty(i);
+        }
+    }
 }
 
-SignalHistoryModel::Item::Item(QObject *obj)
+SignalHistoryModel::Item::Item(QObject *obj, SignalEventAllocator *allocator)
     : object(obj)
+    , metaObject(obj->metaObject())
+    , events(allocator)
     , startTime(RelativeClock::sinceAppStart()->mSecs())
+    , dirty(false)
+    , unsentEvents(0)
+    , droppedEvents(0)
 {
     objectName = Util::shortDisplayString(object);
     objectType = internString(QByteArray(obj->metaObject()->className()));
@@ -29,6 +29,8 @@
 #ifndef GAMMARAY_SIGNALHISTORYMODEL_H
 #define GAMMARAY_SIGNALHISTORYMODEL_H
 
+#include "signaleventbuffer.h"
+
 #include <common/objectmodel.h>
 
 #include <QAbstractTableModel>
@@ -37,8 +39,13 @@
 #include <QMetaMethod>
 #include <QByteArray>
 
+QT_BEGIN_NAMESPACE
+class QTimer;
+QT_END_NAMESPACE
+
 namespace GammaRay {
 class ProbeInterface;
+class SignalEventBatchWriter;
 
 class SignalHistoryModel : public QAbstractTableModel
 {
@@ -47,15 +54,18 @@ class SignalHistoryModel : public QAbstractTableModel
 private:
     struct Item
     {
-        Item(QObject *obj);
+        Item(QObject *obj, SignalEventAllocator *allocator);
 
         QObject *object; // never dereference, might be invalid!
-        QHash<int, QByteArray> signalNames;
+        const QMetaObject *metaObject; // key into m_signalNames
         QString objectName;
         QByteArray objectType;
         QIcon decoration;
-        QVector<qint64> events;
+        SignalEventBuffer events;
         const qint64 startTime; // FIXME: make them all methods
+        bool dirty; // has pending changes not yet announced via dataChanged
+        int unsentEvents; // newest events not yet streamed via eventsAppended
+        int droppedEvents; // already streamed events dropped since
         qint64 endTime() const;
 
         qint64 timestamp(int i) const { return SignalHistoryModel::timestamp(events.at(i)); }
@@ -73,7 +83,8 @@ public:
         EventsRole = ObjectModel::UserRole + 1,
         StartTimeRole,
         EndTimeRole,
-        SignalMapRole
+        SignalMapRole,
+        ItemIdRole ///< stable identifier of the object used by eventsAppended() @since 2.6
     };
 
     explicit SignalHistoryModel(ProbeInterface *probe, QObject *parent = 0);
@@ -89,17 +100,53 @@ public:
     static qint64 timestamp(qint64 ev) { return ev >> 16; }
     static int signalIndex(qint64 ev) { return ev & 0xffff; }
 
+    /** Maximum number of events kept per object, older ones are discarded.
+     *  @since 2.6
+     */
+    int maximumEventCount() const;
+    void setMaximumEventCount(int count);
+
+    /** Maximum age of kept events in milliseconds, 0 means unlimited.
+     *  @since 2.6
+     */
+    qint64 maximumEventAge() const;
+    void setMaximumEventAge(qint64 msecs);
+
+    /** Enables eventsAppended(), which is emitted right away with all recorded events.
+     *  @since 2.6
+     */
+    void setEventStreamingEnabled(bool enabled);
+
+signals:
+    /** Events recorded since the last emission, encoded by SignalEventBatchWriter.
+     *  @since 2.6
+     */
+    void eventsAppended(const QByteArray &batch);
+
 private:
     Item *item(const QModelIndex &index) const;
+    void markDirty(int itemIndex);
+    void eventsDropped(Item *data, int count);
+    void writeEvents(SignalEventBatchWriter &batch, int itemIndex);
 
 private slots:
     void onObjectAdded(QObject *object);
     void onObjectRemoved(QObject *object);
     void onSignalEmitted(QObject *sender, int signalIndex);
+    void emitPendingChanges();
+    void expireEvents();
 
 private:
+    SignalEventAllocator m_eventAllocator;
     QVector<Item *> m_tracedObjects;
     QHash<QObject *, int> m_itemIndex;
+    QHash<const QMetaObject *, QHash<int, QByteArray> > m_signalNames;
+    QVector<int> m_dirtyItems;
+    QTimer *m_updateTimer;
+    QTimer *m_expireTimer;
+    int m_maximumEventCount;
+    qint64 m_maximumEventAge;
+    bool m_streamEvents;
 };
 } // namespace GammaRay
 
@@ -31,6 +31,7 @@
 #include "relativeclock.h"
 #include "signalmonitorcommon.h"
 
+#include <core/probesettings.h>
 #include <core/remote/serverproxymodel.h>
 
 #include <QTimer>
@@ -42,10 +43,15 @@ SignalMonitor::SignalMonitor(ProbeInterface *probe, QObject *parent)
 {
     StreamOperators::registerSignalMonitorStreamOperators();
 
-    SignalHistoryModel *model = new SignalHistoryModel(probe, this);
+    m_model = new SignalHistoryModel(probe, this);
+    m_model->setMaximumEventCount(ProbeSettings::value(QStringLiteral("SignalHistoryMaximumEvents"),
+                                                       m_model->maximumEventCount()).toInt());
+    m_model->setMaximumEventAge(ProbeSettings::value(QStringLiteral("SignalHistoryMaximumAge"),
+                                                     0).toLongLong());
+    connect(m_model, SIGNAL(eventsAppended(QByteArray)), this, SIGNAL(eventsAppended(QByteArray)));
     auto proxy = new ServerProxyModel<QSortFilterProxyModel>(this);
     proxy->setDynamicSortFilter(true);
-    proxy->setSourceModel(model);
+    proxy->setSourceModel(m_model);
     probe->registerModel(QStringLiteral("com.kdab.GammaRay.SignalHistoryModel"), proxy);
 
     m_clock = new QTimer(this);
@@ -71,6 +77,11 @@ void SignalMonitor::sendClockUpdates(bool enabled)
         m_clock->stop();
 }
 
+void SignalMonitor::sendEventUpdates(bool enabled)
+{
+    m_model->setEventStreamingEnabled(enabled);
+}
+
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
 Q_EXPORT_PLUGIN(SignalMonitorFactory)
 #endif
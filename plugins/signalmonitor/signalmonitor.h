@@ -38,6 +38,8 @@ class QTimer;
 QT_END_NAMESPACE
 
 namespace GammaRay {
+class SignalHistoryModel;
+
 class SignalMonitor : public SignalMonitorInterface
 {
     Q_OBJECT
@@ -48,11 +50,13 @@ public:
 
 public slots:
     void sendClockUpdates(bool enabled) Q_DECL_OVERRIDE;
+    void sendEventUpdates(bool enabled) Q_DECL_OVERRIDE;
 
 private slots:
     void timeout();
 
 private:
+    SignalHistoryModel *m_model;
     QTimer *m_clock;
 };
 
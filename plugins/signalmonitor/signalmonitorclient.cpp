@@ -46,3 +46,9 @@ void SignalMonitorClient::sendClockUpdates(bool enabled)
     Endpoint::instance()->invokeObject(objectName(), "sendClockUpdates",
                                        QVariantList() << QVariant::fromValue(enabled));
 }
+
+void SignalMonitorClient::sendEventUpdates(bool enabled)
+{
+    Endpoint::instance()->invokeObject(objectName(), "sendEventUpdates",
+                                       QVariantList() << QVariant::fromValue(enabled));
+}
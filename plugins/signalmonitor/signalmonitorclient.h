@@ -42,6 +42,7 @@ public:
 
 public slots:
     void sendClockUpdates(bool enabled) Q_DECL_OVERRIDE;
+    void sendEventUpdates(bool enabled) Q_DECL_OVERRIDE;
 };
 }
 
@@ -37,3 +37,98 @@ void GammaRay::StreamOperators::registerSignalMonitorStreamOperators()
     qRegisterMetaTypeStreamOperators<QVector<qlonglong> >();
     qRegisterMetaTypeStreamOperators<QHash<int, QByteArray> >();
 }
+
+static qint64 eventTimestamp(qint64 event)
+{
+    return event >> 16;
+}
+
+SignalEventBatchWriter::SignalEventBatchWriter(bool reset)
+    : m_previousTimestamp(0)
+    , m_itemCount(0)
+{
+    m_data.append(char(reset ? 1 : 0));
+}
+
+void SignalEventBatchWriter::beginItem(int itemId, int droppedEvents, int appendedEvents,
+                                       qint64 previousEvent)
+{
+    writeVarint(itemId);
+    writeVarint(droppedEvents);
+    writeVarint(appendedEvents);
+    m_previousTimestamp = eventTimestamp(previousEvent);
+    ++m_itemCount;
+}
+
+void SignalEventBatchWriter::addEvent(qint64 event)
+{
+    const qint64 timestamp = eventTimestamp(event);
+    const qint64 delta = timestamp - m_previousTimestamp;
+    // zigzag encoding, the clock is not guaranteed to be monotonic
+    writeVarint((quint64(delta) << 1) ^ quint64(delta >> 63));
+    writeVarint(event & 0xffff);
+    m_previousTimestamp = timestamp;
+}
+
+bool SignalEventBatchWriter::isEmpty() const
+{
+    return m_itemCount == 0;
+}
+
+QByteArray SignalEventBatchWriter::data() const
+{
+    return m_data;
+}
+
+void SignalEventBatchWriter::writeVarint(quint64 value)
+{
+    while (value >= 0x80) {
+        m_data.append(char(value | 0x80));
+        value >>= 7;
+    }
+    m_data.append(char(value));
+}
+
+SignalEventBatchReader::SignalEventBatchReader(const QByteArray &data)
+    : m_data(data)
+    , m_pos(1)
+{
+}
+
+bool SignalEventBatchReader::isReset() const
+{
+    return !m_data.isEmpty() && m_data.at(0) == 1;
+}
+
+bool SignalEventBatchReader::readItem(int &itemId, int &droppedEvents, int &appendedEvents)
+{
+    quint64 id, dropped, appended;
+    if (!readVarint(id) || !readVarint(dropped) || !readVarint(appended))
+        return false;
+    itemId = int(id);
+    droppedEvents = int(dropped);
+    appendedEvents = int(appended);
+    return true;
+}
+
+bool SignalEventBatchReader::readEvent(qint64 previousEvent, qint64 &event)
+{
+    quint64 zigzag, signalIndex;
+    if (!readVarint(zigzag) || !readVarint(signalIndex))
+        return false;
+    const qint64 delta = qint64(zigzag >> 1) ^ -qint64(zigzag & 1);
+    event = ((eventTimestamp(previousEvent) + delta) << 16) | qint64(signalIndex & 0xffff);
+    return true;
+}
+
+bool SignalEventBatchReader::readVarint(quint64 &value)
+{
+    value = 0;
+    for (int shift = 0; m_pos < m_data.size() && shift < 64; shift += 7) {
+        const uchar byte = m_data.at(m_pos++);
+        value |= quint64(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
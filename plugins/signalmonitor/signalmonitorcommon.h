@@ -45,6 +45,59 @@ namespace GammaRay {
 namespace StreamOperators {
 void registerSignalMonitorStreamOperators();
 }
+
+/** Writes incremental signal history updates, see SignalMonitorInterface::eventsAppended().
+ *
+ * A batch starts with a flag byte, which is 1 if the batch replaces everything that
+ * has been sent before. Then follows a record for each changed object: its item id,
+ * the number of events to drop from the front of its history, the number of appended
+ * events, and finally the appended events. Of those, the timestamp is sent as a
+ * zigzag varint relative to the preceding event of the same object, the signal index
+ * as a varint. Events are the packed values used by SignalHistoryModel.
+ *
+ * @since 2.6
+ */
+class SignalEventBatchWriter
+{
+public:
+    explicit SignalEventBatchWriter(bool reset = false);
+
+    /** @p previousEvent is the last event of the item the receiver already has, or 0. */
+    void beginItem(int itemId, int droppedEvents, int appendedEvents, qint64 previousEvent);
+    void addEvent(qint64 event);
+
+    bool isEmpty() const;
+    QByteArray data() const;
+
+private:
+    void writeVarint(quint64 value);
+
+    QByteArray m_data;
+    qint64 m_previousTimestamp;
+    int m_itemCount;
+};
+
+/** Reads batches created by SignalEventBatchWriter. */
+class SignalEventBatchReader
+{
+public:
+    explicit SignalEventBatchReader(const QByteArray &data);
+
+    bool isReset() const;
+
+    /** Returns @c false at the end of the batch. */
+    bool readItem(int &itemId, int &droppedEvents, int &appendedEvents);
+    /** Reads the next appended event of the current item, @p previousEvent is the
+     *  preceding one, or 0 if there is none. Returns @c false if the batch is malformed.
+     */
+    bool readEvent(qint64 previousEvent, qint64 &event);
+
+private:
+    bool readVarint(quint64 &value);
+
+    const QByteArray m_data;
+    int m_pos;
+};
 }
 
 #endif // GAMMARAY_SIGNALMONITORCOMMON_H
@@ -41,9 +41,17 @@ public:
 
 public slots:
     virtual void sendClockUpdates(bool enabled) = 0;
+    /** Enables eventsAppended(), starting with a batch containing all events recorded so far.
+     *  @since 2.6
+     */
+    virtual void sendEventUpdates(bool enabled) = 0;
 
 signals:
     void clock(qlonglong msecs);
+    /** Newly recorded signal events, encoded by SignalEventBatchWriter.
+     *  @since 2.6
+     */
+    void eventsAppended(const QByteArray &batch);
 };
 }
 
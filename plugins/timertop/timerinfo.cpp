@@ -32,15 +32,12 @@
 #include <core/util.h>
 
 #include <QObject>
+#include <QStringList>
 
 using namespace GammaRay;
 
-static const int maxTimeoutEvents = 1000;
-static const int maxTimeSpan = 10000;
-
 TimerInfo::TimerInfo(QObject *timer)
     : m_type(QQmlTimerType)
-    , m_totalWakeups(0)
     , m_timer(timer)
     , m_timerId(-1)
     , m_lastReceiver(0)
@@ -53,7 +50,6 @@ TimerInfo::TimerInfo(QObject *timer)
 
 TimerInfo::TimerInfo(int timerId)
     : m_type(QObjectType)
-    , m_totalWakeups(0)
     , m_timerId(timerId)
 {
 }
@@ -63,16 +59,9 @@ TimerInfo::Type TimerInfo::type() const
     return m_type;
 }
 
-void TimerInfo::addEvent(const TimeoutEvent &timeoutEvent)
+void TimerInfo::addStatistics(const TimerStatistics &statistics)
 {
-    m_timeoutEvents.append(timeoutEvent);
-    removeOldEvents();
-    m_totalWakeups++;
-}
-
-int TimerInfo::numEvents() const
-{
-    return m_timeoutEvents.size();
+    m_statistics.merge(statistics);
 }
 
 QObject *TimerInfo::timerObject() const
@@ -92,32 +81,11 @@ int TimerInfo::timerId() const
     return m_timerId;
 }
 
-FunctionCallTimer *TimerInfo::functionCallTimer()
-{
-    return &m_functionCallTimer;
-}
-
 QString TimerInfo::wakeupsPerSec() const
 {
-    int totalWakeups = 0;
-    int start = 0;
-    int end = m_timeoutEvents.size() - 1;
-    for (int i = end; i >= 0; i--) {
-        const TimeoutEvent &event = m_timeoutEvents.at(i);
-        if (event.timeStamp.msecsTo(QTime::currentTime()) > maxTimeSpan) {
-            start = i;
-            break;
-        }
-        totalWakeups++;
-    }
-
-    if (totalWakeups > 0 && end > start) {
-        const QTime startTime = m_timeoutEvents[start].timeStamp;
-        const QTime endTime = m_timeoutEvents[end].timeStamp;
-        const int timeSpan = startTime.msecsTo(endTime);
-        const float wakeupsPerSec = totalWakeups / (float)timeSpan * 1000.0f;
+    const double wakeupsPerSec = m_statistics.wakeupsPerSec(TimerStatistics::currentTime());
+    if (wakeupsPerSec > 0)
         return QString::number(wakeupsPerSec, 'f', 1);
-    }
     return QStringLiteral("0");
 }
 
@@ -126,18 +94,9 @@ QString TimerInfo::timePerWakeup() const
     if (m_type == QObjectType)
         return QStringLiteral("N/A");
 
-    int totalWakeups = 0;
-    int totalTime = 0;
-    for (int i = m_timeoutEvents.size() - 1; i >= 0; i--) {
-        const TimeoutEvent &event = m_timeoutEvents.at(i);
-        if (event.timeStamp.msecsTo(QTime::currentTime()) > maxTimeSpan)
-            break;
-        totalWakeups++;
-        totalTime += event.executionTime;
-    }
-
-    if (totalWakeups > 0)
-        return QString::number(totalTime / (float)totalWakeups, 'f', 1);
+    const double timePerWakeup = m_statistics.timePerWakeup(TimerStatistics::currentTime());
+    if (timePerWakeup >= 0)
+        return QString::number(timePerWakeup, 'f', 1);
     return QStringLiteral("N/A");
 }
 
@@ -146,18 +105,35 @@ QString TimerInfo::maxWakeupTime() const
     if (m_type == QObjectType)
         return QStringLiteral("N/A");
 
-    int max = 0;
-    for (int i = 0; i < m_timeoutEvents.size(); i++) {
-        const TimeoutEvent &event = m_timeoutEvents.at(i);
-        if (event.executionTime > max)
-            max = event.executionTime;
+    return QString::number(m_statistics.maxTime);
+}
+
+QString TimerInfo::wakeupTimeDistribution() const
+{
+    if (m_type == QObjectType || m_statistics.timedCount == 0)
+        return QString();
+
+    QStringList lines;
+    for (int i = 0; i < TimerStatistics::HistogramSize; ++i) {
+        const quint32 count = m_statistics.histogram[i];
+        if (count == 0)
+            continue;
+        const QString percentage
+            = QString::number(100.0 * count / m_statistics.timedCount, 'f', 1);
+        if (i == 0)
+            lines.push_back(TimerModel::tr("< 1 uSecs: %1%").arg(percentage));
+        else if (i == TimerStatistics::HistogramSize - 1)
+            lines.push_back(TimerModel::tr(">= %1 uSecs: %2%").arg(1 << (i - 1)).arg(percentage));
+        else
+            lines.push_back(TimerModel::tr("%1 - %2 uSecs: %3%")
+                            .arg(1 << (i - 1)).arg((1 << i) - 1).arg(percentage));
     }
-    return QString::number(max);
+    return lines.join(QStringLiteral("\n"));
 }
 
 int TimerInfo::totalWakeups() const
 {
-    return m_totalWakeups;
+    return int(m_statistics.count);
 }
 
 QString TimerInfo::state() const
@@ -194,12 +170,6 @@ QString TimerInfo::state() const
     return QString();
 }
 
-void TimerInfo::removeOldEvents()
-{
-    if (m_timeoutEvents.size() > maxTimeoutEvents)
-        m_timeoutEvents.removeFirst();
-}
-
 void TimerInfo::setLastReceiver(QObject *receiver)
 {
     m_lastReceiver = receiver;
@@ -28,12 +28,11 @@
 #ifndef GAMMARAY_TIMERTOP_TIMERINFO_H
 #define GAMMARAY_TIMERTOP_TIMERINFO_H
 
-#include "functioncalltimer.h"
+#include "timerstatistics.h"
 
 #include <QSharedPointer>
 #include <QPointer>
 #include <QTimer>
-#include <QTime>
 #include <QMetaType>
 
 namespace GammaRay {
@@ -46,44 +45,33 @@ public:
         QQmlTimerType
     };
 
-    struct TimeoutEvent
-    {
-        QTime timeStamp;
-        int executionTime;
-    };
-
     explicit TimerInfo(QObject *timer);
     explicit TimerInfo(int timerId);
     Type type() const;
-    void addEvent(const TimeoutEvent &timeoutEvent);
+    void addStatistics(const TimerStatistics &statistics);
     void setLastReceiver(QObject *receiver);
-    int numEvents() const;
     QTimer *timer() const;
     QObject *timerObject() const;
     int timerId() const;
-    FunctionCallTimer *functionCallTimer();
     QString wakeupsPerSec() const;
     QString timePerWakeup() const;
     QString maxWakeupTime() const;
+    QString wakeupTimeDistribution() const;
     int totalWakeups() const;
     QString state() const;
     QString displayName() const;
 
 private:
     Type m_type;
-    int m_totalWakeups;
+    TimerStatistics m_statistics;
 
     // Only for QTimer/QQmlTimers timers
     QPointer<QObject> m_timer;
 
     int m_timerId;
-    FunctionCallTimer m_functionCallTimer;
-    QList<TimeoutEvent> m_timeoutEvents;
 
     // Only for free timers, QObject that received the timeout event
     QPointer<QObject> m_lastReceiver;
-
-    void removeOldEvents();
 };
 
 typedef QSharedPointer<TimerInfo> TimerInfoPtr;
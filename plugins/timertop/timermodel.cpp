@@ -26,6 +26,7 @@
   along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include "timermodel.h"
+#include "timerstatistics.h"
 
 #include <core/probeinterface.h>
 #include <core/signalspycallbackset.h>
@@ -34,23 +35,24 @@
 #include <QMetaMethod>
 #include <QCoreApplication>
 #include <QTimerEvent>
-#include <QThread>
-
-#include <iostream>
-
-static const char timerInfoPropertyName[] = "GammaRay TimerInfo";
 
 using namespace GammaRay;
-using namespace std;
 
 static TimerModel *s_timerModel = 0;
 
+static int loadRelaxed(const QAtomicInt &value)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+    return value.load();
+#else
+    return value;
+#endif
+}
+
 static bool processCallback()
 {
-    ///TODO: multi-threading support
-    if (!TimerModel::isInitialized() || QThread::currentThread() != qApp->thread())
-        return false;
-    return true;
+    // timeouts are recorded into per-thread statistics, so this is safe in any thread
+    return TimerModel::isInitialized();
 }
 
 static void signal_begin_callback(QObject *caller, int method_index, void **argv)
@@ -59,10 +61,6 @@ static void signal_begin_callback(QObject *caller, int method_index, void **argv
     if (!processCallback())
         return;
 
-    ///TODO: support threads living in other threads
-    if (caller->thread() != qApp->thread())
-        return;
-
     TimerModel::instance()->preSignalActivate(caller, method_index);
 }
 
@@ -84,7 +82,6 @@ TimerModel::TimerModel(QObject *parent)
     , m_qmlTimerTriggeredIndex(-1)
 {
     m_pendingChanedRowsTimer->setInterval(5000);
-    m_pendingChanedRowsTimer->setSingleShot(true);
     connect(m_pendingChanedRowsTimer, SIGNAL(timeout()), this, SLOT(flushEmitPendingChangedRows()));
 }
 
@@ -109,14 +106,14 @@ TimerModel *TimerModel::instance()
 TimerInfoPtr TimerModel::findOrCreateFreeTimerInfo(int timerId)
 {
     // First, return the timer info if it already exists
-    foreach (const TimerInfoPtr &freeTimer, m_freeTimers) {
-        if (freeTimer->timerId() == timerId)
-            return freeTimer;
-    }
+    const QHash<int, int>::const_iterator it = m_freeTimerRows.constFind(timerId);
+    if (it != m_freeTimerRows.constEnd())
+        return m_freeTimers.at(it.value());
 
     // Create a new free timer, and emit the correct update signals
     TimerInfoPtr timerInfo(new TimerInfo(timerId));
     beginInsertRows(QModelIndex(), rowCount(), rowCount());
+    m_freeTimerRows.insert(timerId, m_freeTimers.size());
     m_freeTimers.append(timerInfo);
     endInsertRows();
     return timerInfo;
@@ -127,40 +124,35 @@ TimerInfoPtr TimerModel::findOrCreateQTimerTimerInfo(QObject *timer)
     if (!timer)
         return TimerInfoPtr();
 
-    QVariant timerInfoVariant = timer->property(timerInfoPropertyName);
-    if (!timerInfoVariant.isValid()) {
-        const TimerInfoPtr info = TimerInfoPtr(new TimerInfo(timer));
-        if (m_qmlTimerTriggeredIndex < 0 && info->type() == TimerInfo::QQmlTimerType)
-            m_qmlTimerTriggeredIndex = timer->metaObject()->indexOfMethod("triggered()");
-        timerInfoVariant.setValue(info);
-        if (timer->thread() == QThread::currentThread()) // ### FIXME: we shouldn't use setProperty() in the first place...
-            timer->setProperty(timerInfoPropertyName, timerInfoVariant);
+    TimerInfoPtr &timerInfo = m_timers[timer];
+    // the address might have been reused by a new timer before we got to clean up
+    if (!timerInfo || timerInfo->timerObject() != timer) {
+        timerInfo = TimerInfoPtr(new TimerInfo(timer));
+        // QQmlTimer is not known before QtQml shows up, and its index never changes after that
+        if (loadRelaxed(m_qmlTimerTriggeredIndex) < 0
+            && timerInfo->type() == TimerInfo::QQmlTimerType)
+            m_qmlTimerTriggeredIndex.testAndSetRelaxed(
+                -1, timer->metaObject()->indexOfMethod("triggered()"));
     }
-
-    const TimerInfoPtr timerInfo = timerInfoVariant.value<TimerInfoPtr>();
-    Q_ASSERT(timerInfo->timerObject() == timer);
     return timerInfo;
 }
 
-TimerInfoPtr TimerModel::findOrCreateQTimerTimerInfo(int timerId)
+QObject *TimerModel::sourceObject(int row) const
 {
-    for (int row = 0; row < m_sourceModel->rowCount(); row++) {
-        const QModelIndex sourceIndex = m_sourceModel->index(row, 0);
-        QObject * const timerObject = sourceIndex.data(ObjectModel::ObjectRole).value<QObject *>();
-        QTimer * const timer = qobject_cast<QTimer *>(timerObject);
-        if (timer && timer->timerId() == timerId)
-            return findOrCreateQTimerTimerInfo(timer);
-    }
+    const QModelIndex sourceIndex = m_sourceModel->index(row, 0);
+    return sourceIndex.data(ObjectModel::ObjectRole).value<QObject *>();
+}
 
-    return TimerInfoPtr();
+void TimerModel::indexSourceRows(int start, int end)
+{
+    for (int row = start; row <= end; ++row)
+        findOrCreateQTimerTimerInfo(sourceObject(row));
 }
 
 TimerInfoPtr TimerModel::findOrCreateTimerInfo(const QModelIndex &index)
 {
     if (index.row() < m_sourceModel->rowCount()) {
-        const QModelIndex sourceIndex = m_sourceModel->index(index.row(), 0);
-        QObject * const timerObject = sourceIndex.data(ObjectModel::ObjectRole).value<QObject *>();
-        return findOrCreateQTimerTimerInfo(timerObject);
+        return findOrCreateQTimerTimerInfo(sourceObject(index.row()));
     } else {
         const int freeListIndex = index.row() - m_sourceModel->rowCount();
         Q_ASSERT(freeListIndex >= 0);
@@ -170,79 +162,24 @@ TimerInfoPtr TimerModel::findOrCreateTimerInfo(const QModelIndex &index)
     return TimerInfoPtr();
 }
 
-int TimerModel::rowFor(QObject *timer)
-{
-    for (int i = 0; i < rowCount(); i++) {
-        const TimerInfoPtr timerInfo = findOrCreateTimerInfo(index(i, 0));
-        if (timerInfo && timerInfo->timerObject() == timer)
-            return i;
-    }
-    return -1;
-}
-
+// called from any thread, must not touch anything but the thread's own statistics shard
 void TimerModel::preSignalActivate(QObject *caller, int methodIndex)
 {
     if (!(methodIndex == m_timeoutIndex && qobject_cast<QTimer *>(caller))
-        && !(methodIndex == m_qmlTimerTriggeredIndex && caller->inherits("QQmlTimer")))
-        return;
-
-    const TimerInfoPtr timerInfo = findOrCreateQTimerTimerInfo(caller);
-
-    if (!timerInfo) {
-        // Ok, likely a GammaRay timer
-        // cout << "TimerModel::preSignalActivate(): Unable to find timer "
-        // << (void*)timer << " (" << timer->objectName().toStdString() << ")!" << endl;
+        && !(methodIndex == loadRelaxed(m_qmlTimerTriggeredIndex)
+             && caller->inherits("QQmlTimer")))
         return;
-    }
-
-    if (!timerInfo->functionCallTimer()->start()) {
-        cout << "TimerModel::preSignalActivate(): Recursive timeout for timer "
-             << (void *)caller << " (" << caller->objectName().toStdString() << ")!" << endl;
-        return;
-    }
 
-    m_currentSignals[caller] = timerInfo;
+    TimerStatisticsShard::beginTimeout(caller, methodIndex);
 }
 
 void TimerModel::postSignalActivate(QObject *caller, int methodIndex)
 {
-    QHash<QObject *, TimerInfoPtr>::iterator it = m_currentSignals.find(caller);
-    if (it == m_currentSignals.end()) {
-        // Ok, likely a GammaRay timer
-        // cout << "TimerModel::postSignalActivate(): Unable to find timer "
-        // << (void*)caller << " (" << caller->objectName().toStdString() << ")!" << endl;
+    // caller might be dangling already, only its address is used
+    if (methodIndex != m_timeoutIndex && methodIndex != loadRelaxed(m_qmlTimerTriggeredIndex))
         return;
-    }
-
-    const TimerInfoPtr timerInfo = *it;
-    Q_ASSERT(timerInfo);
 
-    if (!(timerInfo->type() == TimerInfo::QTimerType && methodIndex == m_timeoutIndex)
-        && !(timerInfo->type() == TimerInfo::QQmlTimerType
-             && methodIndex == m_qmlTimerTriggeredIndex))
-        return;
-
-    m_currentSignals.erase(it);
-
-    if (!timerInfo->timerObject()) {
-        // timer got killed in a slot
-        return;
-    }
-
-    Q_ASSERT(caller == timerInfo->timerObject());
-
-    if (!timerInfo->functionCallTimer()->active()) {
-        cout << "TimerModel::postSignalActivate(): Timer not active: "
-             << (void *)caller << " (" << caller->objectName().toStdString() << ")!" << endl;
-        return;
-    }
-
-    TimerInfo::TimeoutEvent event;
-    event.timeStamp = QTime::currentTime();
-    event.executionTime = timerInfo->functionCallTimer()->stop();
-    timerInfo->addEvent(event);
-    const int row = rowFor(timerInfo->timerObject());
-    emitTimerObjectChanged(row);
+    TimerStatisticsShard::endTimeout(caller, methodIndex);
 }
 
 void TimerModel::setProbe(ProbeInterface *probe)
@@ -254,6 +191,9 @@ void TimerModel::setProbe(ProbeInterface *probe)
     callbacks.signalEndCallback = signal_end_callback;
 
     probe->registerSignalSpyCallbackSet(callbacks);
+
+    connect(probe->probe(), SIGNAL(objectsDestroyed(QVector<QObject*>)),
+            this, SLOT(slotObjectsDestroyed(QVector<QObject*>)));
 }
 
 void TimerModel::setSourceModel(QAbstractItemModel *sourceModel)
@@ -266,7 +206,7 @@ void TimerModel::setSourceModel(QAbstractItemModel *sourceModel)
     connect(m_sourceModel, SIGNAL(rowsAboutToBeInserted(QModelIndex,int,int)),
             this, SLOT(slotBeginInsertRows(QModelIndex,int,int)));
     connect(m_sourceModel, SIGNAL(rowsInserted(QModelIndex,int,int)),
-            this, SLOT(slotEndInsertRows()));
+            this, SLOT(slotEndInsertRows(QModelIndex,int,int)));
     connect(m_sourceModel, SIGNAL(rowsAboutToBeRemoved(QModelIndex,int,int)),
             this, SLOT(slotBeginRemoveRows(QModelIndex,int,int)));
     connect(m_sourceModel, SIGNAL(rowsRemoved(QModelIndex,int,int)),
@@ -280,7 +220,9 @@ void TimerModel::setSourceModel(QAbstractItemModel *sourceModel)
     connect(m_sourceModel, SIGNAL(layoutChanged()),
             this, SLOT(slotEndReset()));
 
+    indexSourceRows(0, m_sourceModel->rowCount() - 1);
     endResetModel();
+    m_pendingChanedRowsTimer->start();
 }
 
 int TimerModel::columnCount(const QModelIndex &parent) const
@@ -324,6 +266,15 @@ QVariant TimerModel::data(const QModelIndex &index, int role) const
         case LastRole:
             break;
         }
+    } else if (role == Qt::ToolTipRole && index.isValid()
+               && (index.column() == TimePerWakeupRole - FirstRole - 1
+                   || index.column() == MaxTimePerWakeupRole - FirstRole - 1)) {
+        const TimerInfoPtr timerInfo = const_cast<TimerModel *>(this)->findOrCreateTimerInfo(index);
+        if (timerInfo) {
+            const QString distribution = timerInfo->wakeupTimeDistribution();
+            if (!distribution.isEmpty())
+                return distribution;
+        }
     }
     return QVariant();
 }
@@ -359,9 +310,10 @@ bool TimerModel::eventFilter(QObject *watched, QEvent *event)
     if (event->type() == QEvent::Timer) {
         QTimerEvent * const timerEvent = static_cast<QTimerEvent *>(event);
 
-        // If there is a QTimer associated with this timer ID, don't handle it here, it will be handled
-        // by the signal hooks for QTimer::timeout()
-        if (findOrCreateQTimerTimerInfo(timerEvent->timerId()))
+        // If this is the timer of a QTimer, don't handle it here, it will be handled
+        // by the signal hooks for QTimer::timeout(). QTimers receive their own timer events.
+        const QTimer * const timer = qobject_cast<QTimer *>(watched);
+        if (timer && timer->timerId() == timerEvent->timerId())
             return false;
 
         // check if object is owned by GammaRay itself
@@ -369,13 +321,9 @@ bool TimerModel::eventFilter(QObject *watched, QEvent *event)
             return false;
 
         const TimerInfoPtr timerInfo = findOrCreateFreeTimerInfo(timerEvent->timerId());
-        TimerInfo::TimeoutEvent timeoutEvent;
-        timeoutEvent.timeStamp = QTime::currentTime();
-        timeoutEvent.executionTime = -1;
-        timerInfo->addEvent(timeoutEvent);
-
         timerInfo->setLastReceiver(watched);
-        emitFreeTimerChanged(m_freeTimers.indexOf(timerInfo));
+        TimerStatisticsShard::addTimeout(
+            TimerStatisticsShard::freeTimerKey(timerEvent->timerId()), -1);
     }
     return false;
 }
@@ -399,8 +347,10 @@ void TimerModel::slotBeginInsertRows(const QModelIndex &parent, int start, int e
     beginInsertRows(QModelIndex(), start, end);
 }
 
-void TimerModel::slotEndInsertRows()
+void TimerModel::slotEndInsertRows(const QModelIndex &parent, int start, int end)
 {
+    Q_UNUSED(parent);
+    indexSourceRows(start, end);
     endInsertRows();
 }
 
@@ -413,33 +363,57 @@ void TimerModel::slotBeginReset()
 
 void TimerModel::slotEndReset()
 {
+    // keep the statistics of timers that are still around
+    const QHash<QObject *, TimerInfoPtr> oldTimers = m_timers;
+    m_timers.clear();
+    for (int row = 0; row < m_sourceModel->rowCount(); ++row) {
+        QObject *timer = sourceObject(row);
+        const TimerInfoPtr timerInfo = oldTimers.value(timer);
+        if (timerInfo && timerInfo->timerObject() == timer)
+            m_timers.insert(timer, timerInfo);
+        else
+            findOrCreateQTimerTimerInfo(timer);
+    }
     endResetModel();
 }
 
-void TimerModel::emitTimerObjectChanged(int row)
+void TimerModel::slotObjectsDestroyed(const QVector<QObject *> &objects)
 {
-    if (row < 0 || row >= rowCount())
-        return;
-
-    m_pendingChangedTimerObjects.insert(row);
-    if (!m_pendingChanedRowsTimer->isActive())
-        m_pendingChanedRowsTimer->start();
+    foreach (QObject *obj, objects)
+        m_timers.remove(obj);
 }
 
-void TimerModel::emitFreeTimerChanged(int row)
+void TimerModel::flushEmitPendingChangedRows()
 {
-    if (row < 0 || row >= m_freeTimers.count())
-        return;
+    QHash<quintptr, TimerStatistics> statistics;
+    TimerStatisticsShard::takeAll(statistics);
+    for (QHash<quintptr, TimerStatistics>::const_iterator it = statistics.constBegin();
+         it != statistics.constEnd(); ++it) {
+        QObject *timer = TimerStatisticsShard::keyObject(it.key());
+        if (!timer) {
+            const int row = m_freeTimerRows.value(TimerStatisticsShard::keyTimerId(it.key()), -1);
+            if (row < 0)
+                continue;
+            m_freeTimers.at(row)->addStatistics(it.value());
+            m_pendingChangedFreeTimers.insert(row);
+            continue;
+        }
 
-    m_pendingChangedFreeTimers.insert(row);
-    if (!m_pendingChanedRowsTimer->isActive())
-        m_pendingChanedRowsTimer->start();
-}
+        // timers not in the source model, e.g. our own ones, are not known here
+        const QHash<QObject *, TimerInfoPtr>::const_iterator timerIt = m_timers.constFind(timer);
+        if (timerIt == m_timers.constEnd() || timerIt.value()->timerObject() != timer)
+            continue;
+        timerIt.value()->addStatistics(it.value());
+        m_pendingChangedTimerObjects.insert(timer);
+    }
 
-void TimerModel::flushEmitPendingChangedRows()
-{
-    foreach (int row, m_pendingChangedTimerObjects)
-        emit dataChanged(index(row, 0), index(row, LastRole - FirstRole - 2));
+    // resolving rows is a linear search, so only do that once per flush rather than per wakeup
+    if (!m_pendingChangedTimerObjects.isEmpty()) {
+        for (int row = 0; row < m_sourceModel->rowCount(); ++row) {
+            if (m_pendingChangedTimerObjects.contains(sourceObject(row)))
+                emit dataChanged(index(row, 0), index(row, LastRole - FirstRole - 2));
+        }
+    }
     m_pendingChangedTimerObjects.clear();
 
     foreach (int row, m_pendingChangedFreeTimers)
@@ -33,6 +33,7 @@
 #include <common/modelroles.h>
 
 #include <QAbstractTableModel>
+#include <QAtomicInt>
 #include <QSet>
 
 QT_BEGIN_NAMESPACE
@@ -89,17 +90,15 @@ private slots:
     void slotBeginRemoveRows(const QModelIndex &parent, int start, int end);
     void slotEndRemoveRows();
     void slotBeginInsertRows(const QModelIndex &parent, int start, int end);
-    void slotEndInsertRows();
+    void slotEndInsertRows(const QModelIndex &parent, int start, int end);
     void slotBeginReset();
     void slotEndReset();
+    void slotObjectsDestroyed(const QVector<QObject *> &objects);
     void flushEmitPendingChangedRows();
 
 private:
     explicit TimerModel(QObject *parent = 0);
 
-    // Finds only QTimers based on the timer ID, not free timers.
-    TimerInfoPtr findOrCreateQTimerTimerInfo(int timerId);
-
     // Finds both QTimer and free timers
     TimerInfoPtr findOrCreateTimerInfo(const QModelIndex &index);
 
@@ -109,22 +108,24 @@ private:
     // Finds QObject timers
     TimerInfoPtr findOrCreateFreeTimerInfo(int timerId);
 
-    int rowFor(QObject *timer);
-    void emitTimerObjectChanged(int row);
-    void emitFreeTimerChanged(int row);
+    QObject *sourceObject(int row) const;
+    void indexSourceRows(int start, int end);
 
     QAbstractItemModel *m_sourceModel;
+    // all of the following is only accessed from the GUI thread
+    QHash<QObject *, TimerInfoPtr> m_timers;
     QList<TimerInfoPtr> m_freeTimers;
+    QHash<int, int> m_freeTimerRows; // timer id -> index into m_freeTimers
     ProbeInterface *m_probe;
-    // current timer signals that are being processed
-    QHash<QObject *, TimerInfoPtr> m_currentSignals;
     // pending dataChanged() signals
-    QSet<int> m_pendingChangedTimerObjects;
+    QSet<QObject *> m_pendingChangedTimerObjects;
     QSet<int> m_pendingChangedFreeTimers;
     QTimer *m_pendingChanedRowsTimer;
     // the method index of the timeout() signal of a QTimer
     const int m_timeoutIndex;
-    int m_qmlTimerTriggeredIndex;
+    // the method index of QQmlTimer::triggered(), set from the GUI thread once a QQmlTimer
+    // shows up, but read by the signal spy callbacks from any thread
+    QAtomicInt m_qmlTimerTriggeredIndex;
 };
 }
 
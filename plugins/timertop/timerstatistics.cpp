@@ -0,0 +1,313 @@
+/*
+  timerstatistics.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "timerstatistics.h"
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QThread>
+#include <QThreadStorage>
+#include <QVector>
+
+#include <algorithm>
+
+using namespace GammaRay;
+
+namespace {
+struct MonotonicClock
+{
+    MonotonicClock()
+    {
+        timer.start();
+    }
+
+    QElapsedTimer timer;
+};
+}
+
+Q_GLOBAL_STATIC(MonotonicClock, s_clock)
+
+TimerStatistics::TimerStatistics()
+    : count(0)
+    , timedCount(0)
+    , totalTime(0)
+    , maxTime(0)
+    , firstSecond(-1)
+{
+    std::fill(histogram, histogram + HistogramSize, 0);
+    std::fill(bucketSecond, bucketSecond + RateWindow, -1);
+    std::fill(bucketCount, bucketCount + RateWindow, 0);
+    std::fill(bucketTimedCount, bucketTimedCount + RateWindow, 0);
+    std::fill(bucketTime, bucketTime + RateWindow, 0);
+}
+
+void TimerStatistics::addTimeout(qint64 timestamp, int executionTime)
+{
+    const qint64 second = timestamp / 1000;
+    if (firstSecond < 0)
+        firstSecond = second;
+    ++count;
+
+    const int slot = second % RateWindow;
+    if (bucketSecond[slot] != second) {
+        bucketSecond[slot] = second;
+        bucketCount[slot] = 0;
+        bucketTimedCount[slot] = 0;
+        bucketTime[slot] = 0;
+    }
+    ++bucketCount[slot];
+
+    if (executionTime < 0)
+        return;
+    ++timedCount;
+    totalTime += executionTime;
+    maxTime = std::max(maxTime, executionTime);
+    int bucket = 0;
+    while (bucket < HistogramSize - 1 && (executionTime >> bucket) > 0)
+        ++bucket;
+    ++histogram[bucket];
+    ++bucketTimedCount[slot];
+    bucketTime[slot] += executionTime;
+}
+
+void TimerStatistics::merge(const TimerStatistics &other)
+{
+    count += other.count;
+    timedCount += other.timedCount;
+    totalTime += other.totalTime;
+    maxTime = std::max(maxTime, other.maxTime);
+    if (other.firstSecond >= 0 && (firstSecond < 0 || other.firstSecond < firstSecond))
+        firstSecond = other.firstSecond;
+    for (int i = 0; i < HistogramSize; ++i)
+        histogram[i] += other.histogram[i];
+
+    for (int i = 0; i < RateWindow; ++i) {
+        if (other.bucketSecond[i] < bucketSecond[i])
+            continue;
+        if (other.bucketSecond[i] > bucketSecond[i]) {
+            bucketSecond[i] = other.bucketSecond[i];
+            bucketCount[i] = 0;
+            bucketTimedCount[i] = 0;
+            bucketTime[i] = 0;
+        }
+        bucketCount[i] += other.bucketCount[i];
+        bucketTimedCount[i] += other.bucketTimedCount[i];
+        bucketTime[i] += other.bucketTime[i];
+    }
+}
+
+double TimerStatistics::wakeupsPerSec(qint64 timestamp) const
+{
+    if (firstSecond < 0)
+        return 0;
+
+    const qint64 second = timestamp / 1000;
+    const qint64 windowStart = std::max(firstSecond, second - RateWindow + 1);
+    quint64 wakeups = 0;
+    for (int i = 0; i < RateWindow; ++i) {
+        if (bucketSecond[i] >= windowStart && bucketSecond[i] <= second)
+            wakeups += bucketCount[i];
+    }
+    // the current second is incomplete, don't extrapolate from less than a second though
+    const qint64 span = std::max<qint64>(1000, timestamp - windowStart * 1000);
+    return wakeups * 1000.0 / span;
+}
+
+double TimerStatistics::timePerWakeup(qint64 timestamp) const
+{
+    const qint64 second = timestamp / 1000;
+    quint64 wakeups = 0;
+    qint64 time = 0;
+    for (int i = 0; i < RateWindow; ++i) {
+        if (bucketSecond[i] > second - RateWindow && bucketSecond[i] <= second) {
+            wakeups += bucketTimedCount[i];
+            time += bucketTime[i];
+        }
+    }
+    if (wakeups == 0)
+        return -1;
+    return double(time) / wakeups;
+}
+
+qint64 TimerStatistics::currentTime()
+{
+    return s_clock()->timer.elapsed();
+}
+
+namespace GammaRay {
+struct TimerStatisticsShardHandle
+{
+    TimerStatisticsShardHandle()
+        : shard(new TimerStatisticsShard)
+    {
+    }
+
+    ~TimerStatisticsShardHandle()
+    {
+        // ownership is with the GUI thread, which still needs to merge the last results
+        shard->m_orphaned.fetchAndStoreRelease(1);
+    }
+
+    TimerStatisticsShard *shard;
+};
+}
+
+static QThreadStorage<TimerStatisticsShardHandle *> s_localShard;
+Q_GLOBAL_STATIC(QMutex, s_shardsMutex)
+Q_GLOBAL_STATIC(QVector<TimerStatisticsShard *>, s_shards)
+
+TimerStatisticsShard::TimerStatisticsShard()
+    : m_activeBuffer(0)
+    , m_busy(0)
+    , m_orphaned(0)
+{
+}
+
+TimerStatisticsShard *TimerStatisticsShard::local(bool create)
+{
+    if (!s_localShard.hasLocalData()) {
+        if (!create)
+            return 0;
+        TimerStatisticsShardHandle *handle = new TimerStatisticsShardHandle;
+        {
+            QMutexLocker lock(s_shardsMutex());
+            s_shards()->push_back(handle->shard);
+        }
+        s_localShard.setLocalData(handle);
+    }
+    return s_localShard.localData()->shard;
+}
+
+void TimerStatisticsShard::beginTimeout(QObject *timer, int methodIndex)
+{
+    TimerStatisticsShard *shard = local(true);
+    ActiveTimeout timeout;
+    timeout.timer = timer;
+    timeout.methodIndex = methodIndex;
+    shard->m_activeTimeouts.append(timeout);
+    shard->m_activeTimeouts.last().callTimer.start();
+}
+
+void TimerStatisticsShard::endTimeout(QObject *timer, int methodIndex)
+{
+    TimerStatisticsShard *shard = local(false);
+    if (!shard)
+        return;
+
+    // usually the innermost one, unless an emission ended without us noticing
+    for (int i = shard->m_activeTimeouts.size() - 1; i >= 0; --i) {
+        ActiveTimeout &timeout = shard->m_activeTimeouts[i];
+        if (timeout.timer != timer || timeout.methodIndex != methodIndex)
+            continue;
+        const int executionTime = timeout.callTimer.stop();
+        shard->m_activeTimeouts.resize(i);
+        shard->record(objectKey(timer), TimerStatistics::currentTime(), executionTime);
+        return;
+    }
+}
+
+void TimerStatisticsShard::addTimeout(quintptr key, int executionTime)
+{
+    local(true)->record(key, TimerStatistics::currentTime(), executionTime);
+}
+
+void TimerStatisticsShard::record(quintptr key, qint64 timestamp, int executionTime)
+{
+    // announce the write before looking at the active buffer, see takeActiveBuffer()
+    m_busy.fetchAndStoreOrdered(1);
+    m_buffers[m_activeBuffer.fetchAndAddOrdered(0)][key].addTimeout(timestamp, executionTime);
+    m_busy.fetchAndStoreRelease(0);
+}
+
+void TimerStatisticsShard::takeActiveBuffer(QHash<quintptr, TimerStatistics> &statistics)
+{
+    const int previous = m_activeBuffer.fetchAndAddOrdered(0);
+    m_activeBuffer.fetchAndStoreOrdered(1 - previous);
+    // a write that started before the switch might still go to the previous buffer
+    while (m_busy.fetchAndAddOrdered(0))
+        QThread::yieldCurrentThread();
+    mergeBuffer(m_buffers[previous], statistics);
+}
+
+void TimerStatisticsShard::mergeBuffer(QHash<quintptr, TimerStatistics> &buffer,
+                                       QHash<quintptr, TimerStatistics> &statistics)
+{
+    for (QHash<quintptr, TimerStatistics>::iterator it = buffer.begin(); it != buffer.end();) {
+        // idle for an entire period, the timer is probably gone
+        if (it.value().count == 0) {
+            it = buffer.erase(it);
+            continue;
+        }
+        statistics[it.key()].merge(it.value());
+        it.value() = TimerStatistics();
+        ++it;
+    }
+}
+
+void TimerStatisticsShard::takeAll(QHash<quintptr, TimerStatistics> &statistics)
+{
+    QMutexLocker lock(s_shardsMutex());
+    QVector<TimerStatisticsShard *> &shards = *s_shards();
+    for (QVector<TimerStatisticsShard *>::iterator it = shards.begin(); it != shards.end();) {
+        TimerStatisticsShard *shard = *it;
+        if (shard->m_orphaned.fetchAndAddOrdered(0)) {
+            // the owning thread is gone, so both buffers are final
+            mergeBuffer(shard->m_buffers[0], statistics);
+            mergeBuffer(shard->m_buffers[1], statistics);
+            delete shard;
+            it = shards.erase(it);
+        } else {
+            shard->takeActiveBuffer(statistics);
+            ++it;
+        }
+    }
+}
+
+quintptr TimerStatisticsShard::objectKey(QObject *timer)
+{
+    return reinterpret_cast<quintptr>(timer);
+}
+
+quintptr TimerStatisticsShard::freeTimerKey(int timerId)
+{
+    // objects are aligned, so the lowest bit tells both kinds apart
+    return (quintptr(timerId) << 1) | 1;
+}
+
+QObject *TimerStatisticsShard::keyObject(quintptr key)
+{
+    if (key & 1)
+        return 0;
+    return reinterpret_cast<QObject *>(key);
+}
+
+int TimerStatisticsShard::keyTimerId(quintptr key)
+{
+    if (!(key & 1))
+        return -1;
+    return int(key >> 1);
+}
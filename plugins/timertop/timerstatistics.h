@@ -0,0 +1,130 @@
+/*
+  timerstatistics.h
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GAMMARAY_TIMERTOP_TIMERSTATISTICS_H
+#define GAMMARAY_TIMERTOP_TIMERSTATISTICS_H
+
+#include "functioncalltimer.h"
+
+#include <QAtomicInt>
+#include <QHash>
+#include <QVarLengthArray>
+
+QT_BEGIN_NAMESPACE
+class QObject;
+QT_END_NAMESPACE
+
+namespace GammaRay {
+/** Accumulated timeouts of a single timer, fixed size so it can be updated without allocations. */
+struct TimerStatistics
+{
+    enum {
+        HistogramSize = 20, // bucket i > 0 counts execution times from 2^(i-1) to 2^i - 1 us
+        RateWindow = 10 // seconds covered by the wakeup rate and the recent execution time
+    };
+
+    TimerStatistics();
+
+    /** @p executionTime is in microseconds, or -1 if unknown. */
+    void addTimeout(qint64 timestamp, int executionTime);
+    void merge(const TimerStatistics &other);
+
+    /** Wakeups per second during the last RateWindow seconds before @p timestamp. */
+    double wakeupsPerSec(qint64 timestamp) const;
+    /** Average execution time during the last RateWindow seconds before @p timestamp. */
+    double timePerWakeup(qint64 timestamp) const;
+
+    /** Milliseconds on a monotonic clock shared by all threads. */
+    static qint64 currentTime();
+
+    quint64 count;
+    quint64 timedCount; // timeouts with known execution time
+    qint64 totalTime;
+    int maxTime;
+    qint64 firstSecond;
+    quint32 histogram[HistogramSize];
+    // per second ring, each slot stores which second it currently holds
+    qint64 bucketSecond[RateWindow];
+    quint32 bucketCount[RateWindow];
+    quint32 bucketTimedCount[RateWindow];
+    qint64 bucketTime[RateWindow];
+};
+
+/** Per-thread collection of TimerStatistics, written without locks by its thread.
+ *
+ * The owning thread records into one of two buffers, while the GUI thread periodically
+ * switches it to the other one and merges the previously active buffer. Entries are
+ * reset in place rather than removed, so recording does not allocate in the steady state.
+ */
+class TimerStatisticsShard
+{
+public:
+    /** Any thread. Pairs the start of a timeout emission with its end. */
+    static void beginTimeout(QObject *timer, int methodIndex);
+    static void endTimeout(QObject *timer, int methodIndex);
+
+    /** Any thread. @p executionTime is in microseconds, or -1 if unknown. */
+    static void addTimeout(quintptr key, int executionTime);
+
+    /** GUI thread. Merges and resets the statistics of all threads, by key. */
+    static void takeAll(QHash<quintptr, TimerStatistics> &statistics);
+
+    static quintptr objectKey(QObject *timer);
+    static quintptr freeTimerKey(int timerId);
+    /** Returns the timer object of @p key, or 0 for a free timer key. */
+    static QObject *keyObject(quintptr key);
+    /** Returns the timer id of @p key, or -1 for a timer object key. */
+    static int keyTimerId(quintptr key);
+
+private:
+    TimerStatisticsShard();
+    Q_DISABLE_COPY(TimerStatisticsShard)
+    friend struct TimerStatisticsShardHandle;
+
+    static TimerStatisticsShard *local(bool create);
+    void record(quintptr key, qint64 timestamp, int executionTime);
+    void takeActiveBuffer(QHash<quintptr, TimerStatistics> &statistics);
+    static void mergeBuffer(QHash<quintptr, TimerStatistics> &buffer,
+                            QHash<quintptr, TimerStatistics> &statistics);
+
+    struct ActiveTimeout
+    {
+        QObject *timer;
+        int methodIndex;
+        FunctionCallTimer callTimer;
+    };
+
+    QHash<quintptr, TimerStatistics> m_buffers[2];
+    QAtomicInt m_activeBuffer; // written by the GUI thread only
+    QAtomicInt m_busy; // written by the owning thread only
+    QAtomicInt m_orphaned;
+    // owning thread only
+    QVarLengthArray<ActiveTimeout, 8> m_activeTimeouts;
+};
+}
+
+#endif // GAMMARAY_TIMERTOP_TIMERSTATISTICS_H
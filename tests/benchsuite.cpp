@@ -27,18 +27,81 @@
 */
 
 #include "benchsuite.h"
+#include "common/message.h"
+#include "common/streamcompressor.h"
+#include "core/chunkedsortedvector.h"
+#include "core/pointerset.h"
 #include "core/probe.h"
 #include "core/util.h"
 
+#include "lz4/lz4.h" // 3rdparty
+
 #include <QtTestGui>
 
+#include <QBuffer>
 #include <QLabel>
+#include <QThread>
 #include <QTreeView>
 
 QTEST_MAIN(GammaRay::BenchSuite)
 
 using namespace GammaRay;
 
+// simulates Probe::m_validObjects usage: a large set of long-lived objects, and a stream
+// of short-lived ones that get looked up a few times between creation and destruction
+template<typename Set>
+static void churnObjects(Set &set, QVector<quint64> &storage, int liveCount)
+{
+    const int churnCount = storage.size() / 2 - liveCount;
+    for (int i = 0; i < liveCount; ++i)
+        set.insert(&storage[2 * i]);
+
+    QVector<int> destructionOrder;
+    destructionOrder.reserve(churnCount);
+    for (int i = 0; i < churnCount; ++i)
+        destructionOrder.push_back(liveCount + (i * 7919) % churnCount);
+
+    QBENCHMARK {
+        for (int i = 0; i < churnCount; ++i) {
+            quint64 *obj = &storage[2 * (liveCount + i)];
+            set.insert(obj);
+            set.contains(obj);
+            set.contains(obj);
+            set.contains(&storage[2 * ((i * 6151) % liveCount)]);
+        }
+        foreach (int i, destructionOrder) {
+            set.contains(&storage[2 * i]);
+            set.remove(&storage[2 * i]);
+        }
+    }
+}
+
+namespace {
+// creates and destroys short-lived objects, as a worker thread pool would
+class ObjectChurnThread : public QThread
+{
+public:
+    explicit ObjectChurnThread(int iterations)
+        : m_iterations(iterations)
+    {
+    }
+
+protected:
+    void run() Q_DECL_OVERRIDE
+    {
+        for (int i = 0; i < m_iterations; ++i) {
+            QObject *obj = new QObject;
+            Probe::objectAdded(obj, true);
+            Probe::objectRemoved(obj);
+            delete obj;
+        }
+    }
+
+private:
+    int m_iterations;
+};
+}
+
 void BenchSuite::iconForObject()
 {
     QWidget widget;
@@ -77,3 +140,273 @@ void BenchSuite::probe_objectAdded()
     qDeleteAll(objects);
     delete Probe::instance();
 }
+
+void BenchSuite::probe_objectAddedContended_data()
+{
+    QTest::addColumn<bool>("lockFree");
+
+    QTest::newRow("locked") << false;
+    QTest::newRow("lock-free") << true;
+}
+
+void BenchSuite::probe_objectAddedContended()
+{
+    QFETCH(bool, lockFree);
+
+    Probe::createProbe(false);
+    Probe::instance()->m_lockFreeObjectTracking = lockFree;
+
+    static const int NUM_THREADS = 12;
+    static const int NUM_OBJECTS = 10000;
+    QVector<QThread *> threads;
+    threads.reserve(NUM_THREADS);
+    for (int i = 0; i < NUM_THREADS; ++i)
+        threads << new ObjectChurnThread(NUM_OBJECTS);
+
+    QBENCHMARK_ONCE {
+        foreach (QThread *thread, threads)
+            thread->start();
+        foreach (QThread *thread, threads)
+            thread->wait();
+    }
+
+    qDeleteAll(threads);
+    QCoreApplication::processEvents();
+    delete Probe::instance();
+}
+
+void BenchSuite::probe_objectBurst_data()
+{
+    QTest::addColumn<int>("numObjects");
+
+    QTest::newRow("10k") << 10000;
+    QTest::newRow("100k") << 100000;
+}
+
+void BenchSuite::probe_objectBurst()
+{
+    QFETCH(int, numObjects);
+
+    Probe::createProbe(false);
+
+    // a few wide parents, similar to the widget trees built during application startup
+    QVector<QObject *> objects;
+    objects.reserve(numObjects);
+    for (int i = 0; i < numObjects; ++i)
+        objects << new QObject(i >= 16 ? objects.at(i % 16) : Q_NULLPTR);
+
+    // one event loop pass ingesting the whole burst into the object list and tree models
+    QBENCHMARK_ONCE {
+        foreach (QObject *obj, objects)
+            Probe::objectAdded(obj);
+        Probe::instance()->processQueuedObjectChanges();
+    }
+
+    qDeleteAll(objects.constBegin(), objects.constBegin() + 16);
+    QCoreApplication::processEvents();
+    delete Probe::instance();
+}
+
+void BenchSuite::validObjects_data()
+{
+    QTest::addColumn<bool>("pointerSet");
+
+    QTest::newRow("QSet") << false;
+    QTest::newRow("PointerSet") << true;
+}
+
+void BenchSuite::validObjects()
+{
+    QFETCH(bool, pointerSet);
+
+    static const int NUM_LIVE_OBJECTS = 400000;
+    static const int NUM_CHURNED_OBJECTS = 50000;
+    // QObject instances are 16 byte apart at best
+    QVector<quint64> storage(2 * (NUM_LIVE_OBJECTS + NUM_CHURNED_OBJECTS));
+
+    if (pointerSet) {
+        PointerSet<quint64> set;
+        churnObjects(set, storage, NUM_LIVE_OBJECTS);
+    } else {
+        QSet<quint64 *> set;
+        churnObjects(set, storage, NUM_LIVE_OBJECTS);
+    }
+}
+
+static int insertSorted(QVector<quint64 *> &objects, quint64 *obj)
+{
+    QVector<quint64 *>::iterator it = std::lower_bound(objects.begin(), objects.end(), obj);
+    const int row = std::distance(objects.begin(), it);
+    objects.insert(it, obj);
+    return row;
+}
+
+static int insertSorted(ChunkedSortedVector<quint64> &objects, quint64 *obj)
+{
+    return objects.insert(obj);
+}
+
+static quint64 *sortedAt(const QVector<quint64 *> &objects, int row)
+{
+    return objects.at(row);
+}
+
+static quint64 *sortedAt(const ChunkedSortedVector<quint64> &objects, int row)
+{
+    return objects.at(row);
+}
+
+static void removeSorted(QVector<quint64 *> &objects, quint64 *obj)
+{
+    objects.erase(std::lower_bound(objects.begin(), objects.end(), obj));
+}
+
+static void removeSorted(ChunkedSortedVector<quint64> &objects, quint64 *obj)
+{
+    objects.remove(obj);
+}
+
+// simulates ObjectListModel::m_objects usage: object churn on top of a large set of
+// long-lived objects, with the row lookups the model signals trigger
+template<typename Container>
+static void churnSortedObjects(Container &objects, QVector<quint64> &storage, int liveCount)
+{
+    for (int i = 0; i < liveCount; ++i)
+        insertSorted(objects, &storage[2 * i]);
+
+    static const int NUM_CHURNED_OBJECTS = 20000;
+    quint32 rnd = 42;
+    QBENCHMARK_ONCE {
+        for (int i = 0; i < NUM_CHURNED_OBJECTS; ++i) {
+            rnd = rnd * 1664525 + 1013904223;
+            quint64 *obj = &storage[2 * (rnd % liveCount) + 1];
+            const int row = insertSorted(objects, obj);
+            if (sortedAt(objects, row) != obj)
+                QFAIL("inconsistent row");
+            removeSorted(objects, obj);
+        }
+    }
+}
+
+void BenchSuite::sortedObjects_data()
+{
+    QTest::addColumn<bool>("chunked");
+    QTest::addColumn<int>("numObjects");
+
+    QTest::newRow("QVector 10k") << false << 10000;
+    QTest::newRow("QVector 100k") << false << 100000;
+    QTest::newRow("QVector 1M") << false << 1000000;
+    QTest::newRow("ChunkedSortedVector 10k") << true << 10000;
+    QTest::newRow("ChunkedSortedVector 100k") << true << 100000;
+    QTest::newRow("ChunkedSortedVector 1M") << true << 1000000;
+}
+
+void BenchSuite::sortedObjects()
+{
+    QFETCH(bool, chunked);
+    QFETCH(int, numObjects);
+
+    QVector<quint64> storage(2 * numObjects);
+    if (chunked) {
+        ChunkedSortedVector<quint64> objects;
+        churnSortedObjects(objects, storage, numObjects);
+    } else {
+        QVector<quint64 *> objects;
+        objects.reserve(numObjects + 1);
+        churnSortedObjects(objects, storage, numObjects);
+    }
+}
+
+void BenchSuite::messageCompression_data()
+{
+    QTest::addColumn<int>("mode");
+    QTest::newRow("uncompressed") << 0;
+    QTest::newRow("independent") << 1;
+    QTest::newRow("streaming") << 2;
+}
+
+void BenchSuite::messageCompression()
+{
+    QFETCH(int, mode);
+
+    // model content replies as produced by scrolling through the object list
+    static const char *classNames[] = {
+        "QObject", "QTimer", "QWidget", "QLabel", "QThread", "QTreeView", "QAction",
+        "QQuickItem", "QQuickRectangle", "QQuickText", "QSortFilterProxyModel"
+    };
+    const int classCount = sizeof(classNames) / sizeof(classNames[0]);
+    QList<Message *> messages;
+    int rawSize = 0;
+    for (int i = 0; i < 2000; ++i) {
+        Message *msg = new Message(42, Protocol::ModelContentReply);
+        msg->payload() << quint32(20);
+        for (int row = 0; row < 20; ++row) {
+            const int objectNumber = i * 20 + row;
+            const QString className = QLatin1String(classNames[objectNumber % classCount]);
+            const QString address
+                = QStringLiteral("0x%1").arg(0x1a2b000 + objectNumber * 48, 0, 16);
+            QMap<int, QVariant> itemData;
+            itemData.insert(Qt::DisplayRole, className + QLatin1Char(' ') + address);
+            itemData.insert(Qt::ToolTipRole,
+                            QStringLiteral("<p style='white-space:pre'>Object name: %1\n"
+                                           "Type: %2\nParent: %3</p>")
+                            .arg(address, className, QLatin1String(classNames[0])));
+            itemData.insert(Qt::UserRole + 1, objectNumber);
+            msg->payload() << Protocol::fromQModelIndex(QModelIndex()) << itemData
+                           << qint32(Qt::ItemIsEnabled | Qt::ItemIsSelectable);
+        }
+        rawSize += msg->size();
+        messages.push_back(msg);
+    }
+
+    int wireSize = 0;
+    if (mode == 1) {
+        // what Message does per message without a negotiated stream, see compress() there
+        QVector<QByteArray> payloads;
+        foreach (const Message *msg, messages) {
+            const QByteArray data = msg->toByteArray();
+            payloads.push_back(data.mid(data.size() - msg->size()));
+        }
+        const int headerSize = messages.first()->toByteArray().size() - messages.first()->size();
+        QByteArray compressed;
+        QByteArray uncompressed;
+        QBENCHMARK {
+            wireSize = 0;
+            foreach (const QByteArray &payload, payloads) {
+                compressed.resize(LZ4_compressBound(payload.size()));
+                const int size = LZ4_compress_default(payload.constData(), compressed.data(),
+                                                      payload.size(), compressed.size());
+                QVERIFY(size > 0);
+                wireSize += headerSize + int(sizeof(qint32)) + size;
+                uncompressed.resize(payload.size());
+                QCOMPARE(LZ4_decompress_safe(compressed.constData(), uncompressed.data(), size,
+                                             uncompressed.size()), payload.size());
+            }
+        }
+    } else {
+        StreamCompressor compressor;
+        StreamDecompressor decompressor;
+        QBENCHMARK {
+            compressor.reset();
+            decompressor.reset();
+            wireSize = 0;
+            QByteArray wire;
+            QBuffer buffer(&wire);
+            buffer.open(QIODevice::ReadWrite);
+            foreach (const Message *msg, messages) {
+                const QByteArray data = msg->toByteArray(mode == 0 ? Q_NULLPTR : &compressor);
+                wireSize += data.size();
+                buffer.write(data);
+            }
+            buffer.seek(0);
+            while (Message::canReadMessage(&buffer)) {
+                const Message msg = Message::readMessage(&buffer, &decompressor);
+                QVERIFY(msg.size() > 0);
+            }
+        }
+    }
+    if (mode != 0)
+        QVERIFY(wireSize < rawSize);
+
+    qDeleteAll(messages);
+}
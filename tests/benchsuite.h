@@ -39,6 +39,16 @@ class BenchSuite : public QObject
 private slots:
     void iconForObject();
     void probe_objectAdded();
+    void probe_objectAddedContended_data();
+    void probe_objectAddedContended();
+    void probe_objectBurst_data();
+    void probe_objectBurst();
+    void validObjects_data();
+    void validObjects();
+    void sortedObjects_data();
+    void sortedObjects();
+    void messageCompression_data();
+    void messageCompression();
 };
 }
 
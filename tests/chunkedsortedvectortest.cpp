@@ -0,0 +1,119 @@
+/*
+  chunkedsortedvectortest.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "core/chunkedsortedvector.h"
+
+#include <QtTest/qtest.h>
+#include <QObject>
+#include <QVector>
+
+#include <algorithm>
+
+using namespace GammaRay;
+
+class ChunkedSortedVectorTest : public QObject
+{
+    Q_OBJECT
+private slots:
+    void testInsertRemove()
+    {
+        int storage[3];
+        ChunkedSortedVector<int> v;
+        QVERIFY(v.isEmpty());
+        QCOMPARE(v.lowerBound(&storage[1]), 0);
+        QCOMPARE(v.indexOf(&storage[1]), -1);
+        QVERIFY(!v.remove(&storage[1]));
+
+        QCOMPARE(v.insert(&storage[1]), 0);
+        QCOMPARE(v.insert(&storage[1]), -1);
+        QCOMPARE(v.insert(&storage[2]), 1);
+        QCOMPARE(v.insert(&storage[0]), 0);
+        QCOMPARE(v.size(), 3);
+        QCOMPARE(v.at(1), &storage[1]);
+        QCOMPARE(v.indexOf(&storage[2]), 2);
+
+        const ChunkedSortedVector<int> copy = v;
+        v.remove(0, 2);
+        QCOMPARE(v.size(), 1);
+        QCOMPARE(v.at(0), &storage[2]);
+        QCOMPARE(copy.size(), 3);
+        QCOMPARE(copy.at(0), &storage[0]);
+
+        QVERIFY(v.remove(&storage[2]));
+        QVERIFY(v.isEmpty());
+        QVERIFY(!v.contains(&storage[2]));
+    }
+
+    void testChurn()
+    {
+        // compare against a sorted QVector with a deterministic mix of operations,
+        // large enough to split and merge chunks many times
+        QVector<int> storage(20000);
+        ChunkedSortedVector<int> v;
+        QVector<int *> ref;
+        quint32 rnd = 42;
+        for (int i = 0; i < 100000; ++i) {
+            rnd = rnd * 1664525 + 1013904223;
+            int *ptr = &storage[(rnd >> 8) % storage.size()];
+            QVector<int *>::iterator it = std::lower_bound(ref.begin(), ref.end(), ptr);
+            const bool contained = it != ref.end() && *it == ptr;
+            const int row = std::distance(ref.begin(), it);
+            switch (rnd % 4) {
+            case 0:
+            case 1:
+                QCOMPARE(v.insert(ptr), contained ? -1 : row);
+                if (!contained)
+                    ref.insert(it, ptr);
+                break;
+            case 2:
+                QCOMPARE(v.remove(ptr), contained);
+                if (contained)
+                    ref.erase(it);
+                break;
+            case 3:
+                if (!ref.isEmpty() && (rnd >> 20) % 100 == 0) {
+                    const int count = std::min<int>((rnd >> 4) % 600, ref.size() - row);
+                    v.remove(row, count);
+                    ref.remove(row, count);
+                }
+                QCOMPARE(v.lowerBound(ptr), row);
+                break;
+            }
+            QCOMPARE(v.size(), ref.size());
+        }
+
+        QCOMPARE(v.toVector(), ref);
+        for (int row = 0; row < ref.size(); ++row) {
+            QCOMPARE(v.at(row), ref.at(row));
+            QCOMPARE(v.indexOf(ref.at(row)), row);
+        }
+    }
+};
+
+QTEST_MAIN(ChunkedSortedVectorTest)
+
+#include "chunkedsortedvectortest.moc"
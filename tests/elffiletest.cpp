@@ -0,0 +1,203 @@
+/*
+  elffiletest.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <config-gammaray.h>
+
+#include <launcher/elffile.h>
+
+#include <QtTest/qtest.h>
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <QLibraryInfo>
+#include <QObject>
+#include <QTemporaryFile>
+
+#ifdef HAVE_ELF_H
+#include <elf.h>
+#endif
+#if defined(HAVE_SYS_ELF_H) && !defined(HAVE_ELF_H)
+#include <sys/elf.h>
+#endif
+
+#include <cstring>
+
+using namespace GammaRay;
+
+class ElfFileTest : public QObject
+{
+    Q_OBJECT
+private:
+    static QByteArray qtCoreName(const ElfFile &elf)
+    {
+        foreach (const QByteArray &lib, elf.neededLibraries()) {
+            if (lib.startsWith("libQt") && lib.contains("Core.so"))
+                return lib;
+        }
+        return QByteArray();
+    }
+
+    static QByteArray readFile(const QString &fileName)
+    {
+        QFile file(fileName);
+        if (!file.open(QFile::ReadOnly))
+            return QByteArray();
+        return file.readAll();
+    }
+
+    template<typename Ehdr>
+    static void setProgramHeaderOffset(QByteArray &content, quint64 offset)
+    {
+        Ehdr hdr;
+        memcpy(&hdr, content.constData(), sizeof(hdr));
+        hdr.e_phoff = offset;
+        memcpy(content.data(), &hdr, sizeof(hdr));
+    }
+
+private slots:
+    void testExecutable()
+    {
+        const ElfFile elf(QCoreApplication::applicationFilePath());
+        QVERIFY(elf.isValid());
+        QCOMPARE(elf.elfClass(), sizeof(void *) == 8 ? int(ELFCLASS64) : int(ELFCLASS32));
+        QVERIFY(elf.machine() != 0);
+        QVERIFY(!elf.data().isEmpty());
+
+        // we are linked against QtCore, and nothing ends up in there twice
+        QVERIFY(!qtCoreName(elf).isEmpty());
+        const QList<QByteArray> needed = elf.neededLibraries();
+        QCOMPARE(needed.count(qtCoreName(elf)), 1);
+        foreach (const QByteArray &lib, needed)
+            QVERIFY(!lib.isEmpty());
+    }
+
+    void testQtCore()
+    {
+        const ElfFile exe(QCoreApplication::applicationFilePath());
+        const QString path = QLibraryInfo::location(QLibraryInfo::LibrariesPath) + QLatin1Char('/')
+                             + QString::fromLocal8Bit(qtCoreName(exe));
+        if (!QFileInfo(path).isFile())
+            QSKIP("QtCore not found in its installation location");
+
+        const ElfFile elf(path);
+        QVERIFY(elf.isValid());
+        QCOMPARE(elf.elfClass(), exe.elfClass());
+        QCOMPARE(elf.machine(), exe.machine());
+        QVERIFY(!elf.neededLibraries().isEmpty());
+        QVERIFY(qtCoreName(elf).isEmpty());
+
+        // Qt comes with symbol versions, such as Qt_5, Qt_5.6 or Qt_5_PRIVATE_API
+        const QByteArray prefix = "Qt_" + QByteArray::number(QT_VERSION >> 16);
+        bool foundVersion = false;
+        foreach (const QByteArray &version, elf.versionDefinitions()) {
+            QVERIFY(!version.isEmpty());
+            if (version.startsWith(prefix))
+                foundVersion = true;
+        }
+        QVERIFY(foundVersion);
+    }
+
+    void testInvalidFile_data()
+    {
+        QTest::addColumn<QByteArray>("content");
+
+        QTest::newRow("empty") << QByteArray();
+        QTest::newRow("not ELF") << QByteArray(1024, 'x');
+        QTest::newRow("truncated ident") << QByteArray(ELFMAG).left(SELFMAG);
+        QTest::newRow("truncated header") << readFile(QCoreApplication::applicationFilePath())
+                                             .left(EI_NIDENT + 4);
+    }
+
+    void testInvalidFile()
+    {
+        QFETCH(QByteArray, content);
+
+        QTemporaryFile file;
+        QVERIFY(file.open());
+        QCOMPARE(file.write(content), qint64(content.size()));
+        file.flush();
+
+        const ElfFile elf(file.fileName());
+        QVERIFY(!elf.isValid());
+        QVERIFY(elf.neededLibraries().isEmpty());
+        QVERIFY(elf.versionDefinitions().isEmpty());
+        QVERIFY(elf.architecture().isEmpty());
+        QVERIFY(ElfFile(QStringLiteral("/does/not/exist")).neededLibraries().isEmpty());
+    }
+
+    void testTruncatedFile()
+    {
+        const ElfFile exe(QCoreApplication::applicationFilePath());
+        const QByteArray content = readFile(QCoreApplication::applicationFilePath());
+        QVERIFY(!content.isEmpty());
+
+        // cuts through the header, the program headers, the dynamic section, the string table...
+        for (int i = 1; i < 64; ++i) {
+            const int size = content.size() * i / 64;
+            QTemporaryFile file;
+            QVERIFY(file.open());
+            file.write(content.constData(), size);
+            file.flush();
+
+            // whatever is still found has to be correct
+            const ElfFile elf(file.fileName());
+            foreach (const QByteArray &lib, elf.neededLibraries())
+                QVERIFY(exe.neededLibraries().contains(lib));
+            foreach (const QByteArray &version, elf.versionDefinitions())
+                QVERIFY(exe.versionDefinitions().contains(version));
+        }
+    }
+
+    void testCorruptFile()
+    {
+        QByteArray content = readFile(QCoreApplication::applicationFilePath());
+        QVERIFY(content.size() > int(sizeof(Elf64_Ehdr)));
+
+        // program headers pointing out of the file, that leaves nothing to parse
+        if (content.at(EI_CLASS) == ELFCLASS64)
+            setProgramHeaderOffset<Elf64_Ehdr>(content, content.size());
+        else
+            setProgramHeaderOffset<Elf32_Ehdr>(content, content.size());
+
+        QTemporaryFile file;
+        QVERIFY(file.open());
+        file.write(content);
+        file.flush();
+
+        const ElfFile elf(file.fileName());
+        QVERIFY(elf.isValid());
+        QVERIFY(elf.neededLibraries().isEmpty());
+        QVERIFY(elf.rpath().isEmpty());
+        QVERIFY(elf.runpath().isEmpty());
+        QVERIFY(elf.versionDefinitions().isEmpty());
+    }
+};
+
+QTEST_MAIN(ElfFileTest)
+
+#include "elffiletest.moc"
@@ -0,0 +1,134 @@
+/*
+  objecttreemodeltest.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <probe/hooks.h>
+#include <probe/probecreator.h>
+#include <core/probe.h>
+#include <common/objectbroker.h>
+
+#include <QtTest/qtest.h>
+#include <QAbstractItemModel>
+#include <QObject>
+#include <QThread>
+
+using namespace GammaRay;
+
+class ObjectFactory : public QObject
+{
+    Q_OBJECT
+public:
+    ObjectFactory()
+        : root(0) {}
+
+public slots:
+    void createTree()
+    {
+        root = new QObject;
+        objects.push_back(root);
+        for (int i = 0; i < 10; ++i) {
+            QObject *child = new QObject(root);
+            objects.push_back(child);
+            for (int j = 0; j < 3; ++j)
+                objects.push_back(new QObject(child));
+        }
+    }
+
+    void destroyTree()
+    {
+        delete root;
+        root = 0;
+        objects.clear();
+    }
+
+public:
+    QObject *root;
+    QVector<QObject *> objects;
+};
+
+class ObjectTreeModelTest : public QObject
+{
+    Q_OBJECT
+private:
+    void createProbe()
+    {
+        qputenv("GAMMARAY_ProbePath", QCoreApplication::applicationDirPath().toUtf8());
+        Hooks::installHooks();
+        Probe::startupHookReceived();
+        new ProbeCreator(ProbeCreator::Create);
+        QTest::qWait(1); // event loop re-entry
+    }
+
+    static QModelIndex indexForObject(QAbstractItemModel *model, QObject *obj,
+                                      const QModelIndex &parent = QModelIndex())
+    {
+        for (int row = 0; row < model->rowCount(parent); ++row) {
+            const QModelIndex index = model->index(row, 0, parent);
+            if (index.internalPointer() == obj)
+                return index;
+            const QModelIndex childIndex = indexForObject(model, obj, index);
+            if (childIndex.isValid())
+                return childIndex;
+        }
+        return QModelIndex();
+    }
+
+private slots:
+    void testDestroySubtreeBatch()
+    {
+        createProbe();
+        QAbstractItemModel *model
+            = ObjectBroker::model(QStringLiteral("com.kdab.GammaRay.ObjectTree"));
+        QVERIFY(model);
+
+        // objects destroyed in a secondary thread are reported in a single batch,
+        // containing the parents as well as their children
+        QThread thread;
+        ObjectFactory factory;
+        factory.moveToThread(&thread);
+        thread.start();
+
+        for (int i = 0; i < 20; ++i) {
+            QMetaObject::invokeMethod(&factory, "createTree", Qt::BlockingQueuedConnection);
+            QTest::qWait(1); // event loop re-entry
+            // this also covers objects reusing the addresses of ones destroyed previously
+            foreach (QObject *obj, factory.objects)
+                QVERIFY(indexForObject(model, obj).isValid());
+
+            QObject *root = factory.root;
+            QMetaObject::invokeMethod(&factory, "destroyTree", Qt::BlockingQueuedConnection);
+            QTest::qWait(1);
+            QVERIFY(!indexForObject(model, root).isValid());
+        }
+
+        thread.quit();
+        thread.wait();
+    }
+};
+
+QTEST_MAIN(ObjectTreeModelTest)
+
+#include "objecttreemodeltest.moc"
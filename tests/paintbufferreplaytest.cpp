@@ -0,0 +1,142 @@
+/*
+  paintbufferreplaytest.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <core/paintbufferreplay.h>
+
+#include <QtTest/qtest.h>
+#include <QObject>
+#include <QPainter>
+
+using namespace GammaRay;
+
+class PaintBufferReplayTest : public QObject
+{
+    Q_OBJECT
+private:
+    static QPaintBuffer createBuffer()
+    {
+        QPaintBuffer buffer;
+        buffer.setBoundingRect(QRectF(0, 0, 64, 48));
+        QPainter p(&buffer);
+        for (int i = 0; i < 40; ++i) {
+            p.save();
+            p.translate(i % 7, i % 5);
+            p.setPen(QColor::fromHsv((i * 37) % 360, 255, 255));
+            p.setBrush(QColor::fromHsv((i * 53) % 360, 200, 200, 128));
+            p.drawRect(QRect(i % 30, i % 20, 20, 15));
+            if (i % 3 == 0)
+                p.setClipRect(QRect(0, 0, 40, 30));
+            p.drawEllipse(QRect(i % 25, i % 15, 12, 10));
+            if (i % 4 != 0) // leave some of the saved states open
+                p.restore();
+        }
+        p.end();
+        return buffer;
+    }
+
+    static QImage renderDirectly(const QPaintBuffer &buffer, int end)
+    {
+        QImage image(buffer.boundingRect().size().toSize(), QImage::Format_ARGB32);
+        image.fill(Qt::transparent);
+        QPainter painter(&image);
+        int depth = buffer.processCommands(&painter, 0, end);
+        for (; depth > 0; --depth)
+            painter.restore();
+        painter.end();
+        return image;
+    }
+
+    static QVector<QImage> renderAllDirectly(const QPaintBuffer &buffer)
+    {
+        QVector<QImage> images;
+        for (int end = 0; end <= buffer.frameEndIndex(0); ++end)
+            images.push_back(renderDirectly(buffer, end));
+        return images;
+    }
+
+private slots:
+    void testStepping()
+    {
+        const QPaintBuffer buffer = createBuffer();
+        const QVector<QImage> expected = renderAllDirectly(buffer);
+        const int commandCount = expected.size() - 1;
+        QVERIFY(commandCount > 100);
+
+        PaintBufferReplay replay;
+        replay.setCheckpointInterval(16);
+        replay.setPaintBuffer(buffer);
+
+        for (int end = 0; end <= commandCount; ++end)
+            QCOMPARE(replay.render(end), expected.at(end));
+        for (int end = commandCount; end >= 0; --end)
+            QCOMPARE(replay.render(end), expected.at(end));
+    }
+
+    void testRandomAccess()
+    {
+        const QPaintBuffer buffer = createBuffer();
+        const QVector<QImage> expected = renderAllDirectly(buffer);
+        const int commandCount = expected.size() - 1;
+
+        PaintBufferReplay replay;
+        replay.setCheckpointInterval(7);
+        // room for only two keyframes, forcing evictions
+        replay.setCacheSize(2 * 64 * 48 * 4);
+        replay.setPaintBuffer(buffer);
+
+        int end = 0;
+        for (int i = 0; i < 200; ++i) {
+            end = (end * 31 + 17) % (commandCount + 1);
+            QCOMPARE(replay.render(end), expected.at(end));
+        }
+        QCOMPARE(replay.render(commandCount + 10), expected.at(commandCount));
+    }
+
+    void testBufferChange()
+    {
+        PaintBufferReplay replay;
+        QVERIFY(replay.render(10).isNull());
+
+        const QPaintBuffer buffer = createBuffer();
+        replay.setPaintBuffer(buffer);
+        const int commandCount = buffer.frameEndIndex(0);
+        QCOMPARE(replay.render(commandCount), renderDirectly(buffer, commandCount));
+
+        QPaintBuffer other;
+        other.setBoundingRect(QRectF(0, 0, 16, 16));
+        QPainter p(&other);
+        p.fillRect(QRect(0, 0, 8, 8), Qt::red);
+        p.end();
+        replay.setPaintBuffer(other);
+        QCOMPARE(replay.render(other.frameEndIndex(0)),
+                 renderDirectly(other, other.frameEndIndex(0)));
+    }
+};
+
+QTEST_MAIN(PaintBufferReplayTest)
+
+#include "paintbufferreplaytest.moc"
@@ -0,0 +1,102 @@
+/*
+  pointersettest.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "core/pointerset.h"
+
+#include <QtTest/qtest.h>
+#include <QObject>
+#include <QSet>
+#include <QVector>
+
+using namespace GammaRay;
+
+class PointerSetTest : public QObject
+{
+    Q_OBJECT
+private slots:
+    void testInsertRemove()
+    {
+        int a, b;
+        PointerSet<int> set;
+        QVERIFY(set.isEmpty());
+        QVERIFY(!set.contains(&a));
+        QVERIFY(!set.remove(&a));
+
+        QVERIFY(set.insert(&a));
+        QVERIFY(!set.insert(&a));
+        QCOMPARE(set.size(), 1);
+        QVERIFY(set.contains(&a));
+        QVERIFY(!set.contains(&b));
+
+        QVERIFY(set.insert(&b));
+        QVERIFY(set.remove(&a));
+        QVERIFY(!set.remove(&a));
+        QVERIFY(!set.contains(&a));
+        QVERIFY(set.contains(&b));
+        QCOMPARE(set.size(), 1);
+
+        set.clear();
+        QVERIFY(set.isEmpty());
+        QVERIFY(!set.contains(&b));
+    }
+
+    void testChurn()
+    {
+        // compare against QSet with a deterministic mix of operations, across several rehashes
+        QVector<int> storage(20000);
+        PointerSet<int> set;
+        QSet<int *> ref;
+        quint32 rnd = 42;
+        for (int i = 0; i < 200000; ++i) {
+            rnd = rnd * 1664525 + 1013904223;
+            int *ptr = &storage[(rnd >> 8) % storage.size()];
+            switch (rnd % 3) {
+            case 0:
+                QCOMPARE(set.insert(ptr), !ref.contains(ptr));
+                ref.insert(ptr);
+                break;
+            case 1:
+                QCOMPARE(set.remove(ptr), ref.remove(ptr));
+                break;
+            case 2:
+                QCOMPARE(set.contains(ptr), ref.contains(ptr));
+                break;
+            }
+            QCOMPARE(set.size(), ref.size());
+        }
+
+        foreach (int *ptr, ref)
+            QVERIFY(set.contains(ptr));
+        set.reserve(storage.size());
+        foreach (int *ptr, ref)
+            QVERIFY(set.contains(ptr));
+    }
+};
+
+QTEST_MAIN(PointerSetTest)
+
+#include "pointersettest.moc"
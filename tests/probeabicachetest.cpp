@@ -0,0 +1,227 @@
+/*
+  probeabicachetest.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <launcher/probeabicache.h>
+
+#include <QtTest/qtest.h>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QObject>
+#include <QTemporaryDir>
+
+using namespace GammaRay;
+
+class ProbeABICacheTest : public QObject
+{
+    Q_OBJECT
+private:
+    static void writeFile(const QString &fileName, const QByteArray &data,
+                          QIODevice::OpenMode mode = QIODevice::WriteOnly)
+    {
+        QFile file(fileName);
+        QVERIFY(file.open(mode));
+        QCOMPARE(file.write(data), qint64(data.size()));
+    }
+
+    // not next to the data files, replacing it would modify their directory otherwise
+    QString cacheFile() const
+    {
+        return m_dir->path() + QStringLiteral("/cache/probeabi.cache");
+    }
+
+    QString dataFile(const QString &name) const
+    {
+        return m_dir->path() + QLatin1Char('/') + name;
+    }
+
+    QTemporaryDir *m_dir;
+
+private slots:
+    void init()
+    {
+        m_dir = new QTemporaryDir;
+        QVERIFY(m_dir->isValid());
+        QVERIFY(QDir().mkpath(QFileInfo(cacheFile()).absolutePath()));
+        writeFile(dataFile(QStringLiteral("libQt5Core.so")), "qtcore");
+        writeFile(dataFile(QStringLiteral("gammaray_probe.so")), "probe");
+    }
+
+    void cleanup()
+    {
+        delete m_dir;
+        m_dir = 0;
+    }
+
+    void testMiss()
+    {
+        ProbeABICache cache(cacheFile());
+        const QString qtCore = dataFile(QStringLiteral("libQt5Core.so"));
+        QVERIFY(cache.value(ProbeABICache::ABIForQtCore, qtCore).isNull());
+
+        cache.setValue(ProbeABICache::ABIForQtCore, qtCore, QStringLiteral("qt5_6-x86_64"));
+        QVERIFY(cache.value(ProbeABICache::ABIForQtCore, dataFile(QStringLiteral("nope")))
+                .isNull());
+        QVERIFY(cache.value(ProbeABICache::QtCoreForExecutable, qtCore).isNull());
+        QVERIFY(cache.value(ProbeABICache::ABIForQtCore, qtCore, QStringLiteral("ctx")).isNull());
+
+        // files that don't exist are not cached at all
+        cache.setValue(ProbeABICache::ABIForQtCore, dataFile(QStringLiteral("nope")),
+                       QStringLiteral("qt5_6-x86_64"));
+        QVERIFY(cache.value(ProbeABICache::ABIForQtCore, dataFile(QStringLiteral("nope")))
+                .isNull());
+    }
+
+    void testHit()
+    {
+        const QString qtCore = dataFile(QStringLiteral("libQt5Core.so"));
+        const QString probe = dataFile(QStringLiteral("gammaray_probe.so"));
+        {
+            ProbeABICache cache(cacheFile());
+            cache.setValue(ProbeABICache::ABIForQtCore, qtCore, QStringLiteral("qt5_6-x86_64"));
+            cache.setValue(ProbeABICache::ABIsForProbeDirectory, m_dir->path(),
+                           QStringLiteral("qt5_6-x86_64"), QString(), QStringList(probe));
+            QCOMPARE(cache.value(ProbeABICache::ABIForQtCore, qtCore),
+                     QStringLiteral("qt5_6-x86_64"));
+            // saved on destruction
+        }
+        QVERIFY(QFile::exists(cacheFile()));
+
+        ProbeABICache cache(cacheFile());
+        QCOMPARE(cache.value(ProbeABICache::ABIForQtCore, qtCore), QStringLiteral("qt5_6-x86_64"));
+        QCOMPARE(cache.value(ProbeABICache::ABIsForProbeDirectory, m_dir->path()),
+                 QStringLiteral("qt5_6-x86_64"));
+    }
+
+    void testInvalidation()
+    {
+        const QString qtCore = dataFile(QStringLiteral("libQt5Core.so"));
+        const QString probe = dataFile(QStringLiteral("gammaray_probe.so"));
+        const QString probeDir = dataFile(QStringLiteral("probes"));
+        QVERIFY(QDir().mkpath(probeDir));
+        {
+            ProbeABICache cache(cacheFile());
+            cache.setValue(ProbeABICache::ABIForQtCore, qtCore, QStringLiteral("qt5_6-x86_64"));
+            cache.setValue(ProbeABICache::ABIsForProbeDirectory, probeDir,
+                           QStringLiteral("qt5_6-x86_64"), QString(), QStringList(probe));
+        }
+
+        // modifying a dependency only invalidates the entry depending on it
+        writeFile(probe, "modified", QIODevice::Append);
+        {
+            ProbeABICache cache(cacheFile());
+            QVERIFY(cache.value(ProbeABICache::ABIsForProbeDirectory, probeDir).isNull());
+            QCOMPARE(cache.value(ProbeABICache::ABIForQtCore, qtCore),
+                     QStringLiteral("qt5_6-x86_64"));
+        }
+
+        writeFile(qtCore, "modified", QIODevice::Append);
+        {
+            ProbeABICache cache(cacheFile());
+            QVERIFY(cache.value(ProbeABICache::ABIForQtCore, qtCore).isNull());
+
+            // also applies to not yet saved entries
+            cache.setValue(ProbeABICache::ABIForQtCore, qtCore, QStringLiteral("qt5_7-x86_64"));
+            QCOMPARE(cache.value(ProbeABICache::ABIForQtCore, qtCore),
+                     QStringLiteral("qt5_7-x86_64"));
+            QVERIFY(QFile::remove(qtCore));
+            QVERIFY(cache.value(ProbeABICache::ABIForQtCore, qtCore).isNull());
+        }
+
+        // a dependency that didn't exist before and shows up later
+        const QString newProbe = dataFile(QStringLiteral("gammaray_probe-qt5_7.so"));
+        {
+            ProbeABICache cache(cacheFile());
+            cache.setValue(ProbeABICache::ABIsForProbeDirectory, probeDir,
+                           QStringLiteral("qt5_6-x86_64"), QString(), QStringList(newProbe));
+            QCOMPARE(cache.value(ProbeABICache::ABIsForProbeDirectory, probeDir),
+                     QStringLiteral("qt5_6-x86_64"));
+        }
+        writeFile(newProbe, "probe");
+        ProbeABICache cache(cacheFile());
+        QVERIFY(cache.value(ProbeABICache::ABIsForProbeDirectory, probeDir).isNull());
+    }
+
+    void testCorruptFile_data()
+    {
+        QTest::addColumn<QByteArray>("content");
+
+        QTest::newRow("empty") << QByteArray();
+        QTest::newRow("garbage") << QByteArray(1024, 'x');
+        QTest::newRow("zeros") << QByteArray(1024, '\0');
+    }
+
+    void testCorruptFile()
+    {
+        QFETCH(QByteArray, content);
+        writeFile(cacheFile(), content);
+
+        const QString qtCore = dataFile(QStringLiteral("libQt5Core.so"));
+        {
+            ProbeABICache cache(cacheFile());
+            QVERIFY(cache.value(ProbeABICache::ABIForQtCore, qtCore).isNull());
+            cache.setValue(ProbeABICache::ABIForQtCore, qtCore, QStringLiteral("qt5_6-x86_64"));
+        }
+
+        // replaced by a valid one
+        ProbeABICache cache(cacheFile());
+        QCOMPARE(cache.value(ProbeABICache::ABIForQtCore, qtCore), QStringLiteral("qt5_6-x86_64"));
+    }
+
+    void testTruncatedFile()
+    {
+        const QString qtCore = dataFile(QStringLiteral("libQt5Core.so"));
+        const QString probe = dataFile(QStringLiteral("gammaray_probe.so"));
+        {
+            ProbeABICache cache(cacheFile());
+            cache.setValue(ProbeABICache::ABIForQtCore, qtCore, QStringLiteral("qt5_6-x86_64"));
+            cache.setValue(ProbeABICache::ABIsForProbeDirectory, m_dir->path(),
+                           QStringLiteral("qt5_6-x86_64"), QString(), QStringList(probe));
+        }
+
+        QFile file(cacheFile());
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        const QByteArray content = file.readAll();
+        file.close();
+        QVERIFY(!content.isEmpty());
+
+        // whatever is left must either be found intact, or not at all
+        for (int size = content.size() - 1; size >= 0; --size) {
+            writeFile(cacheFile(), content.left(size));
+            ProbeABICache cache(cacheFile());
+            const QString abi = cache.value(ProbeABICache::ABIForQtCore, qtCore);
+            QVERIFY(abi.isEmpty() || abi == QLatin1String("qt5_6-x86_64"));
+            const QString abis = cache.value(ProbeABICache::ABIsForProbeDirectory, m_dir->path());
+            QVERIFY(abis.isEmpty() || abis == QLatin1String("qt5_6-x86_64"));
+        }
+    }
+};
+
+QTEST_MAIN(ProbeABICacheTest)
+
+#include "probeabicachetest.moc"
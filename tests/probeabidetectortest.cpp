@@ -33,6 +33,9 @@
 
 #include <QtTest/qtest.h>
 #include <QObject>
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+#include <QStandardPaths>
+#endif
 
 using namespace GammaRay;
 
@@ -40,10 +43,22 @@ class ProbeABIDetectorTest : public QObject
 {
     Q_OBJECT
 private slots:
+    void initTestCase()
+    {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+        // keep the persistent detection cache away from the user's one
+        QStandardPaths::setTestModeEnabled(true);
+#endif
+    }
+
     void testDetectExecutable()
     {
         ProbeABIDetector detector;
-        QVERIFY(!detector.qtCoreForExecutable(QCoreApplication::applicationFilePath()).isEmpty());
+        const QString qtCore = detector.qtCoreForExecutable(QCoreApplication::applicationFilePath());
+        QVERIFY(!qtCore.isEmpty());
+        QVERIFY(ProbeABIDetector::containsQtCore(qtCore.toUtf8()));
+        // second run is answered by the cache
+        QCOMPARE(detector.qtCoreForExecutable(QCoreApplication::applicationFilePath()), qtCore);
         const ProbeABI abi = detector.abiForExecutable(QCoreApplication::applicationFilePath());
         QCOMPARE(abi.id(), QStringLiteral(GAMMARAY_PROBE_ABI));
     }
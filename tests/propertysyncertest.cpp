@@ -38,6 +38,7 @@ using namespace GammaRay;
 class MyObject : public QObject
 {
     Q_PROPERTY(int intProp READ intProp WRITE setIntProp NOTIFY intPropChanged)
+    Q_PROPERTY(QString stringProp READ stringProp WRITE setStringProp NOTIFY stringPropChanged)
     Q_OBJECT
 public:
     explicit MyObject(QObject *parent = 0)
@@ -52,11 +53,22 @@ public:
         emit intPropChanged();
     }
 
+    QString stringProp() { return p2; }
+    void setStringProp(const QString &s)
+    {
+        if (p2 == s)
+            return;
+        p2 = s;
+        emit stringPropChanged();
+    }
+
 signals:
     void intPropChanged();
+    void stringPropChanged();
 
 private:
     int p1;
+    QString p2;
 };
 
 class PropertySyncerTest : public QObject
@@ -133,11 +145,14 @@ private slots:
 
         // regular sync on changes on one side
         serverObj.setIntProp(42);
+        QCOMPARE(m_server2ClientCount, 1);
+        QTest::qWait(1); // event loop re-entry
         QCOMPARE(m_server2ClientCount, 2);
         QCOMPARE(clientObj->intProp(), 42);
 
         QCOMPARE(m_client2ServerCount, 1);
         clientObj->setIntProp(23);
+        QTest::qWait(1);
         QCOMPARE(serverObj.intProp(), 23);
         QCOMPARE(m_client2ServerCount, 2);
         QCOMPARE(m_server2ClientCount, 2);
@@ -146,7 +161,77 @@ private slots:
         m_server->setObjectEnabled(42, false);
         delete clientObj;
         serverObj.setIntProp(26);
+        QTest::qWait(1);
+        QCOMPARE(m_server2ClientCount, 2);
+
+        delete m_client;
+        m_client = 0;
+        delete m_server;
+        m_server = 0;
+    }
+
+    void testBatching()
+    {
+        m_server2ClientCount = 0;
+        m_client2ServerCount = 0;
+
+        MyObject serverObj1, serverObj2;
+        m_server = new PropertySyncer(this);
+        connect(m_server, SIGNAL(message(GammaRay::Message)), this,
+                SLOT(server2client(GammaRay::Message)));
+        m_server->setAddress(1);
+        m_server->addObject(42, &serverObj1);
+        m_server->addObject(43, &serverObj2);
+        m_server->setObjectEnabled(42, true);
+        m_server->setObjectEnabled(43, true);
+
+        MyObject clientObj1, clientObj2;
+        m_client = new PropertySyncer(this);
+        connect(m_client, SIGNAL(message(GammaRay::Message)), this,
+                SLOT(client2server(GammaRay::Message)));
+        m_client->setAddress(1);
+        m_client->addObject(42, &clientObj1);
+        m_client->addObject(43, &clientObj2);
+        m_client->setObjectEnabled(42, true);
+        m_client->setObjectEnabled(43, true);
+
+        // a burst of changes on several objects results in a single message with the latest values
+        for (int i = 0; i < 10; ++i) {
+            serverObj1.setIntProp(i);
+            serverObj2.setStringProp(QString::number(i));
+        }
+        serverObj1.setStringProp(QStringLiteral("foo"));
+        QCOMPARE(m_server2ClientCount, 0);
+        QTest::qWait(1);
+        QCOMPARE(m_server2ClientCount, 1);
+        QCOMPARE(clientObj1.intProp(), 9);
+        QCOMPARE(clientObj1.stringProp(), QStringLiteral("foo"));
+        QCOMPARE(clientObj2.intProp(), 0);
+        QCOMPARE(clientObj2.stringProp(), QStringLiteral("9"));
+        QCOMPARE(m_client2ServerCount, 0); // no echo of the received values
+
+        // explicit flush, e.g. to retain the order with other messages
+        serverObj2.setIntProp(5);
+        m_server->flushPendingChanges();
+        QCOMPARE(m_server2ClientCount, 2);
+        QCOMPARE(clientObj2.intProp(), 5);
+        QTest::qWait(1);
         QCOMPARE(m_server2ClientCount, 2);
+
+        // remote changes replace pending local ones
+        clientObj1.setIntProp(100);
+        serverObj1.setIntProp(200);
+        m_server->flushPendingChanges();
+        QCOMPARE(clientObj1.intProp(), 200);
+        QTest::qWait(1);
+        QCOMPARE(serverObj1.intProp(), 200);
+        QCOMPARE(clientObj1.intProp(), 200);
+        QCOMPARE(m_client2ServerCount, 0);
+
+        delete m_client;
+        m_client = 0;
+        delete m_server;
+        m_server = 0;
     }
 
 private:
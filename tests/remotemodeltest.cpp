@@ -231,6 +231,62 @@ private slots:
         QCOMPARE(i11.data().toString(), QStringLiteral("entry11"));
     }
 
+    void testTableRemoteModel()
+    {
+        auto tableModel = new QStandardItemModel(10, 3, this);
+        for (int row = 0; row < tableModel->rowCount(); ++row) {
+            for (int column = 0; column < tableModel->columnCount(); ++column) {
+                auto item = new QStandardItem(QStringLiteral("cell%1%2").arg(row).arg(column));
+                if (column == 1)
+                    item->setToolTip(QStringLiteral("tooltip%1").arg(row));
+                if (row == 2)
+                    item->setEnabled(false);
+                tableModel->setItem(row, column, item);
+            }
+        }
+
+        FakeRemoteModelServer server(QStringLiteral("com.kdab.GammaRay.UnitTest.TableModel"), this);
+        server.setModel(tableModel);
+        server.modelMonitored(true);
+
+        FakeRemoteModel client(QStringLiteral("com.kdab.GammaRay.UnitTest.TableModel"), this);
+        connect(&server, SIGNAL(message(GammaRay::Message)), &client,
+                SLOT(newMessage(GammaRay::Message)));
+        connect(&client, SIGNAL(message(GammaRay::Message)), &server,
+                SLOT(newRequest(GammaRay::Message)));
+
+        QCOMPARE(client.rowCount(), 0);
+        QTest::qWait(1);
+        QCOMPARE(client.rowCount(), 10);
+        QCOMPARE(client.columnCount(), 3);
+
+        // a block, and a few cells with gaps in between
+        QVector<QModelIndex> indexes;
+        for (int row = 1; row <= 3; ++row) {
+            for (int column = 0; column < 3; ++column)
+                indexes.push_back(client.index(row, column));
+        }
+        indexes.push_back(client.index(5, 1));
+        indexes.push_back(client.index(7, 0));
+        indexes.push_back(client.index(7, 2));
+        foreach (const QModelIndex &index, indexes)
+            index.data(); // need an event loop entry for the data retrieval
+        QTest::qWait(1);
+
+        foreach (const QModelIndex &index, indexes) {
+            QCOMPARE(index.data().toString(),
+                     QStringLiteral("cell%1%2").arg(index.row()).arg(index.column()));
+            if (index.column() == 1)
+                QCOMPARE(index.data(Qt::ToolTipRole).toString(),
+                         QStringLiteral("tooltip%1").arg(index.row()));
+            else
+                QVERIFY(!index.data(Qt::ToolTipRole).isValid());
+            QCOMPARE((index.flags() & Qt::ItemIsEnabled) == 0, index.row() == 2);
+        }
+        QVERIFY(client.index(7, 1).data(RemoteModel::LoadingState).value<RemoteModel::NodeStates>()
+                & RemoteModel::Empty);
+    }
+
     // this should not make a difference if the above works, however it broke massively with Qt 5.4...
     void testSortProxy()
     {
@@ -0,0 +1,169 @@
+/*
+  signaleventbuffertest.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "plugins/signalmonitor/signaleventbuffer.h"
+#include "plugins/signalmonitor/signalmonitorcommon.h"
+
+#include <QtTest/qtest.h>
+#include <QObject>
+#include <QVector>
+
+using namespace GammaRay;
+
+class SignalEventBufferTest : public QObject
+{
+    Q_OBJECT
+private slots:
+    void testAppend()
+    {
+        SignalEventAllocator allocator;
+        {
+            SignalEventBuffer buffer(&allocator);
+            QVERIFY(buffer.isEmpty());
+
+            QVector<qint64> ref;
+            for (int i = 0; i < 3 * SignalEventAllocator::BlockSize + 7; ++i) {
+                buffer.append(i);
+                ref.push_back(i);
+            }
+            QCOMPARE(buffer.size(), ref.size());
+            QCOMPARE(buffer.last(), ref.last());
+            QCOMPARE(buffer.toVector(), ref);
+            QCOMPARE(allocator.usedBlocks(), 4);
+        }
+        QCOMPARE(allocator.usedBlocks(), 0);
+    }
+
+    void testTrimToSize()
+    {
+        SignalEventAllocator allocator;
+        SignalEventBuffer buffer(&allocator);
+        QVector<qint64> ref;
+        for (int i = 0; i < 10000; ++i) {
+            buffer.append(i);
+            ref.push_back(i);
+            if (ref.size() > 1000)
+                ref.remove(0);
+            QCOMPARE(buffer.trimToSize(1000), i < 1000 ? 0 : 1);
+            QCOMPARE(buffer.size(), ref.size());
+            QCOMPARE(buffer.at(0), ref.first());
+        }
+        QCOMPARE(buffer.toVector(), ref);
+        // memory stays bounded as well
+        QVERIFY(allocator.usedBlocks() <= 1000 / SignalEventAllocator::BlockSize + 2);
+
+        QCOMPARE(buffer.trimToSize(0), 1000);
+        QVERIFY(buffer.isEmpty());
+        QCOMPARE(allocator.usedBlocks(), 1);
+        buffer.append(42);
+        QCOMPARE(buffer.toVector(), QVector<qint64>() << 42);
+    }
+
+    void testTrimBefore()
+    {
+        SignalEventAllocator allocator;
+        SignalEventBuffer buffer(&allocator);
+        QCOMPARE(buffer.trimBefore(10), 0);
+        for (int i = 0; i < 1000; ++i)
+            buffer.append(i * 2);
+
+        QCOMPARE(buffer.trimBefore(0), 0);
+        QCOMPARE(buffer.trimBefore(601), 301);
+        QCOMPARE(buffer.size(), 699);
+        QCOMPARE(buffer.at(0), qint64(602));
+        QCOMPARE(buffer.trimBefore(602), 0);
+        QCOMPARE(buffer.trimBefore(100000), 699);
+        QVERIFY(buffer.isEmpty());
+    }
+
+    void testSharedAllocator()
+    {
+        SignalEventAllocator allocator;
+        SignalEventBuffer a(&allocator);
+        SignalEventBuffer b(&allocator);
+        for (int i = 0; i < 5 * SignalEventAllocator::BlockSize; ++i) {
+            a.append(i);
+            b.append(-i);
+            a.trimToSize(SignalEventAllocator::BlockSize);
+        }
+        QCOMPARE(a.size(), int(SignalEventAllocator::BlockSize));
+        QCOMPARE(a.at(0), qint64(4 * SignalEventAllocator::BlockSize));
+        QCOMPARE(b.size(), 5 * SignalEventAllocator::BlockSize);
+        for (int i = 0; i < b.size(); ++i)
+            QCOMPARE(b.at(i), qint64(-i));
+    }
+
+    void testBatchRoundTrip()
+    {
+        // timestamp << 16 | signal index, including a clock going backwards
+        const QVector<qint64> events = QVector<qint64>()
+                                       << ((Q_INT64_C(1000) << 16) | 3)
+                                       << ((Q_INT64_C(1000) << 16) | 0xffff)
+                                       << ((Q_INT64_C(1001) << 16) | 1)
+                                       << ((Q_INT64_C(900) << 16) | 2)
+                                       << ((Q_INT64_C(123456789) << 16) | 300);
+
+        SignalEventBatchWriter writer;
+        QVERIFY(writer.isEmpty());
+        writer.beginItem(7, 2, events.size(), (Q_INT64_C(999) << 16) | 5);
+        foreach (qint64 event, events)
+            writer.addEvent(event);
+        writer.beginItem(100000, 0, 1, 0);
+        writer.addEvent(events.first());
+        QVERIFY(!writer.isEmpty());
+        // one or two bytes per event for small timestamp increments
+        QVERIFY(writer.data().size() < 40);
+
+        SignalEventBatchReader reader(writer.data());
+        QVERIFY(!reader.isReset());
+        int itemId, dropped, appended;
+        QVERIFY(reader.readItem(itemId, dropped, appended));
+        QCOMPARE(itemId, 7);
+        QCOMPARE(dropped, 2);
+        QCOMPARE(appended, events.size());
+        qint64 previous = (Q_INT64_C(999) << 16) | 5;
+        foreach (qint64 event, events) {
+            qint64 decoded;
+            QVERIFY(reader.readEvent(previous, decoded));
+            QCOMPARE(decoded, event);
+            previous = decoded;
+        }
+        QVERIFY(reader.readItem(itemId, dropped, appended));
+        QCOMPARE(itemId, 100000);
+        QCOMPARE(appended, 1);
+        qint64 decoded;
+        QVERIFY(reader.readEvent(0, decoded));
+        QCOMPARE(decoded, events.first());
+        QVERIFY(!reader.readItem(itemId, dropped, appended));
+
+        QVERIFY(SignalEventBatchReader(SignalEventBatchWriter(true).data()).isReset());
+    }
+};
+
+QTEST_MAIN(SignalEventBufferTest)
+
+#include "signaleventbuffertest.moc"
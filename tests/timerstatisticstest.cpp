@@ -0,0 +1,173 @@
+/*
+  timerstatisticstest.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "plugins/timertop/timerstatistics.h"
+
+#include <QtTest/qtest.h>
+#include <QObject>
+#include <QThread>
+
+using namespace GammaRay;
+
+namespace {
+class TimeoutThread : public QThread
+{
+public:
+    explicit TimeoutThread(int timeouts)
+        : m_timeouts(timeouts)
+    {
+    }
+
+protected:
+    void run() Q_DECL_OVERRIDE
+    {
+        for (int i = 0; i < m_timeouts; ++i)
+            TimerStatisticsShard::addTimeout(TimerStatisticsShard::freeTimerKey(i % 4), i % 100);
+    }
+
+private:
+    int m_timeouts;
+};
+}
+
+class TimerStatisticsTest : public QObject
+{
+    Q_OBJECT
+private slots:
+    void testAddTimeout()
+    {
+        TimerStatistics stats;
+        QCOMPARE(stats.wakeupsPerSec(0), 0.0);
+        QCOMPARE(stats.timePerWakeup(0), -1.0);
+
+        stats.addTimeout(0, 0);
+        stats.addTimeout(100, 1);
+        stats.addTimeout(200, 3);
+        stats.addTimeout(300, 1000000);
+        stats.addTimeout(400, -1);
+        QCOMPARE(stats.count, quint64(5));
+        QCOMPARE(stats.timedCount, quint64(4));
+        QCOMPARE(stats.maxTime, 1000000);
+        QCOMPARE(stats.histogram[0], quint32(1));
+        QCOMPARE(stats.histogram[1], quint32(1));
+        QCOMPARE(stats.histogram[2], quint32(1));
+        QCOMPARE(stats.histogram[TimerStatistics::HistogramSize - 1], quint32(1));
+        QCOMPARE(stats.timePerWakeup(500), 1000004 / 4.0);
+        QCOMPARE(stats.wakeupsPerSec(500), 5.0);
+    }
+
+    void testRateWindow()
+    {
+        TimerStatistics stats;
+        for (qint64 t = 0; t < 30000; t += 100)
+            stats.addTimeout(t, 10);
+        QCOMPARE(stats.count, quint64(300));
+        // only the last RateWindow seconds count
+        QCOMPARE(stats.wakeupsPerSec(29999), 100 * 1000.0 / (29999 - 20000));
+        QCOMPARE(stats.timePerWakeup(29999), 10.0);
+        // idle for longer than the window
+        QCOMPARE(stats.wakeupsPerSec(60000), 0.0);
+        QCOMPARE(stats.timePerWakeup(60000), -1.0);
+    }
+
+    void testMerge()
+    {
+        TimerStatistics a, b, ref;
+        for (qint64 t = 0; t < 20000; t += 250) {
+            (t % 500 ? a : b).addTimeout(t, int(t % 700));
+            ref.addTimeout(t, int(t % 700));
+        }
+        a.merge(b);
+        QCOMPARE(a.count, ref.count);
+        QCOMPARE(a.totalTime, ref.totalTime);
+        QCOMPARE(a.maxTime, ref.maxTime);
+        QCOMPARE(a.firstSecond, ref.firstSecond);
+        for (int i = 0; i < TimerStatistics::HistogramSize; ++i)
+            QCOMPARE(a.histogram[i], ref.histogram[i]);
+        QCOMPARE(a.wakeupsPerSec(20000), ref.wakeupsPerSec(20000));
+        QCOMPARE(a.timePerWakeup(20000), ref.timePerWakeup(20000));
+    }
+
+    void testKeys()
+    {
+        QObject obj;
+        const quintptr objKey = TimerStatisticsShard::objectKey(&obj);
+        QCOMPARE(TimerStatisticsShard::keyObject(objKey), &obj);
+        QCOMPARE(TimerStatisticsShard::keyTimerId(objKey), -1);
+        const quintptr freeKey = TimerStatisticsShard::freeTimerKey(42);
+        QVERIFY(!TimerStatisticsShard::keyObject(freeKey));
+        QCOMPARE(TimerStatisticsShard::keyTimerId(freeKey), 42);
+    }
+
+    void testShards()
+    {
+        QHash<quintptr, TimerStatistics> stats;
+        TimerStatisticsShard::takeAll(stats);
+        stats.clear();
+
+        QObject timer;
+        TimerStatisticsShard::beginTimeout(&timer, 1);
+        TimerStatisticsShard::beginTimeout(&timer, 2);
+        TimerStatisticsShard::endTimeout(&timer, 2);
+        TimerStatisticsShard::endTimeout(&timer, 1);
+        // not started, ignored
+        TimerStatisticsShard::endTimeout(&timer, 1);
+
+        const int threadCount = 4;
+        const int timeouts = 100000;
+        QVector<TimeoutThread *> threads;
+        for (int i = 0; i < threadCount; ++i) {
+            threads.push_back(new TimeoutThread(timeouts));
+            threads.last()->start();
+        }
+        // collect concurrently to the recording threads
+        bool running = true;
+        while (running) {
+            TimerStatisticsShard::takeAll(stats);
+            running = false;
+            foreach (TimeoutThread *thread, threads)
+                running |= !thread->isFinished();
+        }
+        foreach (TimeoutThread *thread, threads)
+            thread->wait();
+        qDeleteAll(threads);
+        TimerStatisticsShard::takeAll(stats);
+
+        QCOMPARE(stats.size(), 5);
+        QCOMPARE(stats.value(TimerStatisticsShard::objectKey(&timer)).count, quint64(2));
+        QCOMPARE(stats.value(TimerStatisticsShard::objectKey(&timer)).timedCount, quint64(2));
+        quint64 total = 0;
+        for (int i = 0; i < 4; ++i)
+            total += stats.value(TimerStatisticsShard::freeTimerKey(i)).count;
+        QCOMPARE(total, quint64(threadCount * timeouts));
+        QCOMPARE(stats.value(TimerStatisticsShard::freeTimerKey(0)).maxTime, 96);
+    }
+};
+
+QTEST_MAIN(TimerStatisticsTest)
+
+#include "timerstatisticstest.moc"
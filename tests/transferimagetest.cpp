@@ -0,0 +1,177 @@
+/*
+  transferimagetest.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <common/transferimage.h>
+
+#include <QtTest/qtest.h>
+#include <QBuffer>
+#include <QObject>
+#include <QPainter>
+
+using namespace GammaRay;
+
+Q_DECLARE_METATYPE(GammaRay::TransferImage::TileCodec)
+
+class TransferImageTest : public QObject
+{
+    Q_OBJECT
+private:
+    static QImage createImage(const QColor &color)
+    {
+        // deliberately not a multiple of the tile size
+        QImage img(300, 130, QImage::Format_ARGB32_Premultiplied);
+        img.fill(color.rgba());
+        return img;
+    }
+
+    static QByteArray serialize(const TransferImage &image)
+    {
+        QByteArray data;
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::WriteOnly);
+        QDataStream stream(&buffer);
+        stream << image;
+        return data;
+    }
+
+    static TransferImage deserialize(const QByteArray &data)
+    {
+        QDataStream stream(data);
+        TransferImage image;
+        stream >> image;
+        return image;
+    }
+
+private slots:
+    void testRoundTrip_data()
+    {
+        QTest::addColumn<TransferImage::TileCodec>("codec");
+        QTest::newRow("raw") << TransferImage::RawCodec;
+        QTest::newRow("lz4") << TransferImage::Lz4Codec;
+        QTest::newRow("png") << TransferImage::PngCodec;
+    }
+
+    void testRoundTrip()
+    {
+        QFETCH(TransferImage::TileCodec, codec);
+
+        QImage img = createImage(Qt::red);
+        QPainter p(&img);
+        p.fillRect(10, 20, 200, 50, Qt::blue);
+        p.end();
+
+        TransferImage source(img);
+        source.setTileCodec(codec);
+        const TransferImage dest = deserialize(serialize(source));
+        QVERIFY(!dest.isDelta());
+        QCOMPARE(dest.image(), img);
+    }
+
+    void testLargeImage_data()
+    {
+        testRoundTrip_data();
+    }
+
+    void testLargeImage()
+    {
+        QFETCH(TransferImage::TileCodec, codec);
+
+        // enough tiles to be spread over multiple threads
+        QImage img(1000, 700, QImage::Format_ARGB32_Premultiplied);
+        for (int y = 0; y < img.height(); ++y) {
+            for (int x = 0; x < img.width(); ++x)
+                img.setPixel(x, y, qRgba(x % 256, y % 256, (x * y) % 256, 255));
+        }
+
+        TransferImage source(img);
+        source.setTileCodec(codec);
+        const TransferImage dest = deserialize(serialize(source));
+        QCOMPARE(dest.image(), img);
+    }
+
+    void testDelta_data()
+    {
+        testRoundTrip_data();
+    }
+
+    void testDelta()
+    {
+        QFETCH(TransferImage::TileCodec, codec);
+
+        const QImage first = createImage(Qt::red);
+        TransferImage source(first);
+        source.setTileCodec(codec);
+        TransferImage previous = deserialize(serialize(source));
+        QCOMPARE(previous.image(), first);
+
+        // a small change only transfers the tiles it touches
+        QImage second = first;
+        second.setPixel(299, 129, qRgb(0, 255, 0));
+        source.setImage(second);
+        source.setPreviousImage(first);
+        const QByteArray fullData = serialize(TransferImage(second));
+        const QByteArray deltaData = serialize(source);
+        QVERIFY(deltaData.size() < fullData.size() / 4);
+
+        TransferImage delta = deserialize(deltaData);
+        QVERIFY(delta.isDelta());
+        QVERIFY(delta.image().isNull());
+
+        // does not fit
+        TransferImage other(createImage(Qt::red).scaled(100, 100));
+        QVERIFY(!delta.applyDelta(other));
+        QVERIFY(!other.image().isNull());
+
+        QVERIFY(delta.applyDelta(previous));
+        QVERIFY(!delta.isDelta());
+        QVERIFY(previous.image().isNull());
+        QCOMPARE(delta.image(), second);
+
+        // nothing changed at all
+        source.setPreviousImage(second);
+        TransferImage empty = deserialize(serialize(source));
+        QVERIFY(empty.isDelta());
+        QVERIFY(empty.applyDelta(delta));
+        QCOMPARE(empty.image(), second);
+    }
+
+    void testIndexedImage()
+    {
+        QImage img(17, 5, QImage::Format_Mono);
+        img.setColorCount(2);
+        img.setColor(0, qRgb(0, 0, 0));
+        img.setColor(1, qRgb(255, 255, 255));
+        img.fill(1);
+        img.setPixel(3, 3, 0);
+        const TransferImage dest = deserialize(serialize(TransferImage(img)));
+        QCOMPARE(dest.image(), img.convertToFormat(QImage::Format_ARGB32));
+    }
+};
+
+QTEST_MAIN(TransferImageTest)
+
+#include "transferimagetest.moc"
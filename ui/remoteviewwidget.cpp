@@ -179,11 +179,19 @@ const RemoteViewFrame &RemoteViewWidget::frame() const
 
 void RemoteViewWidget::frameUpdated(const RemoteViewFrame &frame)
 {
+    RemoteViewFrame newFrame(frame);
+    if (newFrame.isDelta() && !newFrame.applyDelta(m_frame)) {
+        // we don't have the frame this is based on anymore, e.g. after a reset
+        QMetaObject::invokeMethod(m_interface, "requestCompleteFrame", Qt::QueuedConnection);
+        QMetaObject::invokeMethod(m_interface, "clientViewUpdated", Qt::QueuedConnection);
+        return;
+    }
+
     if (!m_frame.isValid()) {
-        m_frame = frame;
+        m_frame = newFrame;
         fitToView();
     } else {
-        m_frame = frame;
+        m_frame = newFrame;
         update();
     }
 